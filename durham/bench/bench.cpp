@@ -0,0 +1,254 @@
+// durham_bench: compiles and runs every program in the benchmark corpus,
+// recording compile time, binary size, run time and peak RSS, and compares
+// the numbers with a stored baseline. Exits non-zero on a regression.
+//
+//   durham_bench --compiler build/durham [--corpus bench/corpus]
+//                [--baseline bench/baseline.txt] [--update-baseline]
+//                [--runs N] [--tolerance PERCENT]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct Measurement {
+    double compile_ms = 0;
+    double binary_bytes = 0;
+    double run_ms = 0;
+    double peak_rss_kb = 0;
+};
+
+static const char* METRIC_NAMES[] = {"compile_ms", "binary_bytes", "run_ms", "peak_rss_kb"};
+
+static double metric(const Measurement& m, int index) {
+    switch (index) {
+        case 0: return m.compile_ms;
+        case 1: return m.binary_bytes;
+        case 2: return m.run_ms;
+        default: return m.peak_rss_kb;
+    }
+}
+
+struct ProcessResult {
+    bool exited;        // exited normally, rather than by a signal or not starting
+    int status;         // exit status when exited
+    double wall_ms;
+    long peak_rss_kb;
+};
+
+// Run program in directory with its output discarded
+static ProcessResult run_process(const std::string& program, const std::vector<std::string>& args,
+                                 const std::string& directory) {
+    std::vector<char*> argv = {const_cast<char*>(program.c_str())};
+    for (const auto& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_RDWR);
+        dup2(null_fd, STDIN_FILENO);
+        dup2(null_fd, STDOUT_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+        if (chdir(directory.c_str()) != 0) _exit(127);
+        execv(program.c_str(), argv.data());
+        _exit(127);
+    }
+
+    int status = 0;
+    rusage usage{};
+    if (pid < 0 || wait4(pid, &status, 0, &usage) < 0) {
+        return {false, 0, 0, 0};
+    }
+    auto end = std::chrono::steady_clock::now();
+    double wall_ms = std::chrono::duration<double, std::milli>(end - start).count();
+    bool exited = WIFEXITED(status) && WEXITSTATUS(status) != 127;
+    return {exited, exited ? WEXITSTATUS(status) : 0, wall_ms, usage.ru_maxrss};
+}
+
+// Best of several compiles and runs of one corpus program; the minimum is far
+// less sensitive to machine noise than the mean
+static bool measure(const std::string& compiler, const std::filesystem::path& source,
+                    const std::filesystem::path& work, int runs, Measurement& result) {
+    std::filesystem::copy_file(source, work / source.filename(),
+                               std::filesystem::copy_options::overwrite_existing);
+
+    // A failed compile must not leave the previous program's binary to measure
+    std::filesystem::path executable = work / "output";
+    std::vector<double> compile_times, run_times;
+    long peak_rss = 0;
+    for (int i = 0; i < runs; i++) {
+        std::filesystem::remove(executable);
+        ProcessResult compile = run_process(compiler,
+            {"--no-cache", "--autocorrect=off", "--no-run", source.filename().string()}, work.string());
+        if (!compile.exited || compile.status != 0 || !std::filesystem::exists(executable)) {
+            std::cerr << source.filename().string() << ": compile failed" << std::endl;
+            return false;
+        }
+        compile_times.push_back(compile.wall_ms);
+    }
+    result.binary_bytes = static_cast<double>(std::filesystem::file_size(executable));
+
+    for (int i = 0; i < runs; i++) {
+        ProcessResult run = run_process(executable.string(), {}, work.string());
+        if (!run.exited) {
+            std::cerr << source.filename().string() << ": program crashed" << std::endl;
+            return false;
+        }
+        run_times.push_back(run.wall_ms);
+        peak_rss = std::max(peak_rss, run.peak_rss_kb);
+    }
+
+    result.compile_ms = *std::min_element(compile_times.begin(), compile_times.end());
+    result.run_ms = *std::min_element(run_times.begin(), run_times.end());
+    result.peak_rss_kb = static_cast<double>(peak_rss);
+    return true;
+}
+
+// Baseline format: "name compile_ms binary_bytes run_ms peak_rss_kb" per line
+static std::map<std::string, Measurement> read_baseline(const std::string& path) {
+    std::map<std::string, Measurement> baseline;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string name;
+        Measurement m;
+        if (fields >> name >> m.compile_ms >> m.binary_bytes >> m.run_ms >> m.peak_rss_kb) {
+            baseline[name] = m;
+        }
+    }
+    return baseline;
+}
+
+static bool write_baseline(const std::string& path, const std::map<std::string, Measurement>& results) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) return false;
+    file << "# name compile_ms binary_bytes run_ms peak_rss_kb\n";
+    file << std::fixed << std::setprecision(3);
+    for (const auto& [name, m] : results) {
+        file << name << " " << m.compile_ms << " " << static_cast<long>(m.binary_bytes) << " "
+             << m.run_ms << " " << static_cast<long>(m.peak_rss_kb) << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+int main(int argc, char** argv) {
+    std::string compiler, corpus = "bench/corpus", baseline_path;
+    bool update_baseline = false;
+    int runs = 10;
+    double tolerance = 25;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string { return i + 1 < argc ? argv[++i] : ""; };
+        if (arg == "--compiler") {
+            compiler = value();
+        } else if (arg == "--corpus") {
+            corpus = value();
+        } else if (arg == "--baseline") {
+            baseline_path = value();
+        } else if (arg == "--update-baseline") {
+            update_baseline = true;
+        } else if (arg == "--runs") {
+            runs = std::max(1, std::atoi(value().c_str()));
+        } else if (arg == "--tolerance") {
+            tolerance = std::atof(value().c_str());
+        } else {
+            std::cerr << "Unknown option '" << arg << "'" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (compiler.empty()) {
+        std::cerr << "Usage: durham_bench --compiler PATH [--corpus DIR] [--baseline FILE] "
+                     "[--update-baseline] [--runs N] [--tolerance PERCENT]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    compiler = std::filesystem::absolute(compiler).string();
+
+    std::vector<std::filesystem::path> programs;
+    for (const auto& entry : std::filesystem::directory_iterator(corpus)) {
+        if (entry.path().extension() == ".dur") programs.push_back(entry.path());
+    }
+    std::sort(programs.begin(), programs.end());
+
+    std::filesystem::path work = std::filesystem::temp_directory_path()
+                               / ("durham-bench-" + std::to_string(getpid()));
+    std::filesystem::create_directories(work);
+
+    std::map<std::string, Measurement> results;
+    bool failed = false;
+    for (const auto& program : programs) {
+        Measurement m;
+        bool measured = false;
+        try {
+            measured = measure(compiler, program, work, runs, m);
+        } catch (const std::filesystem::filesystem_error& e) {
+            std::cerr << program.filename().string() << ": " << e.what() << std::endl;
+        }
+        if (measured) {
+            results[program.stem().string()] = m;
+        } else {
+            failed = true;
+        }
+    }
+    std::error_code ignored;
+    std::filesystem::remove_all(work, ignored);
+
+    std::map<std::string, Measurement> baseline;
+    if (!baseline_path.empty() && !update_baseline) {
+        baseline = read_baseline(baseline_path);
+    }
+
+    // Times within this many ms of the baseline are noise, whatever the ratio
+    const double noise_floor_ms = 3;
+    std::cout << std::left << std::setw(12) << "program" << std::setw(14) << "metric" << std::right
+              << std::setw(14) << "current" << std::setw(14) << "baseline" << std::setw(10) << "change" << "\n";
+    int regressions = 0;
+    for (const auto& [name, m] : results) {
+        auto base = baseline.find(name);
+        for (int i = 0; i < 4; i++) {
+            double current = metric(m, i);
+            std::cout << std::left << std::setw(12) << name << std::setw(14) << METRIC_NAMES[i] << std::right
+                      << std::fixed << std::setprecision(i == 0 || i == 2 ? 3 : 0) << std::setw(14) << current;
+            if (base == baseline.end()) {
+                std::cout << std::setw(14) << "-" << "\n";
+                continue;
+            }
+            double previous = metric(base->second, i);
+            double change = previous > 0 ? (current - previous) / previous * 100 : 0;
+            bool is_time = i == 0 || i == 2;
+            bool regressed = change > tolerance && !(is_time && current - previous < noise_floor_ms);
+            std::cout << std::setw(14) << previous << std::setw(9) << std::setprecision(1) << std::showpos
+                      << change << "%" << std::noshowpos << (regressed ? "  REGRESSION" : "") << "\n";
+            if (regressed) regressions++;
+        }
+    }
+
+    if (update_baseline && !baseline_path.empty()) {
+        if (!write_baseline(baseline_path, results)) {
+            std::cerr << "Could not write " << baseline_path << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << "Baseline written to " << baseline_path << std::endl;
+    }
+    if (regressions > 0) {
+        std::cout << regressions << " metric(s) regressed by more than " << tolerance << "%" << std::endl;
+    }
+    return failed || regressions > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
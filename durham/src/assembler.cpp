@@ -0,0 +1,1147 @@
+#include "assembler.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+// Register numbers follow the x86 encoding (rax=0 ... r15=15)
+struct RegisterInfo {
+    int number;
+    int size;   // operand size in bits
+};
+
+static const std::map<std::string, RegisterInfo>& register_table() {
+    static const std::map<std::string, RegisterInfo> table = [] {
+        std::map<std::string, RegisterInfo> regs;
+        const char* r64[] = {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi"};
+        const char* r32[] = {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi"};
+        const char* r16[] = {"ax", "cx", "dx", "bx", "sp", "bp", "si", "di"};
+        const char* r8[] = {"al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil"};
+        for (int i = 0; i < 8; i++) {
+            regs[r64[i]] = {i, 64};
+            regs[r32[i]] = {i, 32};
+            regs[r16[i]] = {i, 16};
+            regs[r8[i]] = {i, 8};
+        }
+        for (int i = 8; i < 16; i++) {
+            std::string name = "r" + std::to_string(i);
+            regs[name] = {i, 64};
+            regs[name + "d"] = {i, 32};
+            regs[name + "w"] = {i, 16};
+            regs[name + "b"] = {i, 8};
+        }
+        return regs;
+    }();
+    return table;
+}
+
+// Condition code suffixes for jcc/setcc/cmovcc
+static const std::map<std::string, int>& condition_table() {
+    static const std::map<std::string, int> table = {
+        {"o", 0x0}, {"no", 0x1}, {"b", 0x2}, {"c", 0x2}, {"nae", 0x2},
+        {"ae", 0x3}, {"nb", 0x3}, {"nc", 0x3}, {"e", 0x4}, {"z", 0x4},
+        {"ne", 0x5}, {"nz", 0x5}, {"be", 0x6}, {"na", 0x6}, {"a", 0x7},
+        {"nbe", 0x7}, {"s", 0x8}, {"ns", 0x9}, {"p", 0xA}, {"pe", 0xA},
+        {"np", 0xB}, {"po", 0xB}, {"l", 0xC}, {"nge", 0xC}, {"ge", 0xD},
+        {"nl", 0xD}, {"le", 0xE}, {"ng", 0xE}, {"g", 0xF}, {"nle", 0xF}
+    };
+    return table;
+}
+
+// ALU group: opcode base and /digit extension share the same index
+static const std::map<std::string, int>& alu_table() {
+    static const std::map<std::string, int> table = {
+        {"add", 0}, {"or", 1}, {"adc", 2}, {"sbb", 3},
+        {"and", 4}, {"sub", 5}, {"xor", 6}, {"cmp", 7}
+    };
+    return table;
+}
+
+enum class OperandKind {
+    Register,
+    Immediate,
+    Memory,
+    Symbol      // label reference used as a branch target
+};
+
+struct Operand {
+    OperandKind kind = OperandKind::Immediate;
+    int size = 0;               // explicit or register size in bits, 0 = unknown
+    int reg = -1;               // Register
+    int64_t imm = 0;            // Immediate, or displacement for Memory
+    int base = -1;              // Memory
+    int index = -1;
+    int scale = 1;
+    bool rip_relative = false;
+    std::string symbol;         // Symbol, or RIP-relative Memory target
+};
+
+struct Instruction {
+    std::string mnemonic;
+    std::vector<Operand> operands;
+    int line;
+};
+
+// A PC-relative field inside one encoded instruction
+struct Fixup {
+    size_t at;
+    int width;              // 1 or 4 bytes
+    std::string symbol;
+    int64_t addend;         // relative to the end of the instruction
+};
+
+struct Encoding {
+    std::vector<uint8_t> bytes;
+    std::vector<Fixup> fixups;
+};
+
+// Items in the text section, in source order
+struct TextItem {
+    bool is_label;
+    std::string label;
+    int label_line;         // where the label is defined, for errors
+    Instruction instruction;
+};
+
+[[noreturn]] static void asm_error(int line, const std::string& message) {
+    throw std::runtime_error("assembler: line " + std::to_string(line) + ": " + message);
+}
+
+static std::string trim(const std::string& s) {
+    size_t start = s.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t\r\n");
+    return s.substr(start, end - start + 1);
+}
+
+static std::string lowercase(std::string s) {
+    for (char& c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return s;
+}
+
+// Drop a trailing ';' comment, ignoring semicolons inside quotes
+static std::string strip_comment(const std::string& line) {
+    char quote = 0;
+    for (size_t i = 0; i < line.size(); i++) {
+        char c = line[i];
+        if (quote) {
+            if (c == quote) quote = 0;
+        } else if (c == '"' || c == '\'' || c == '`') {
+            quote = c;
+        } else if (c == ';') {
+            return line.substr(0, i);
+        }
+    }
+    return line;
+}
+
+// Split on commas that are not inside quotes or brackets
+static std::vector<std::string> split_operands(const std::string& text) {
+    std::vector<std::string> parts;
+    std::string current;
+    char quote = 0;
+    int depth = 0;
+    for (char c : text) {
+        if (quote) {
+            if (c == quote) quote = 0;
+        } else if (c == '"' || c == '\'' || c == '`') {
+            quote = c;
+        } else if (c == '[') {
+            depth++;
+        } else if (c == ']') {
+            depth--;
+        } else if (c == ',' && depth == 0) {
+            parts.push_back(trim(current));
+            current.clear();
+            continue;
+        }
+        current += c;
+    }
+    if (!trim(current).empty()) parts.push_back(trim(current));
+    return parts;
+}
+
+static bool parse_number(const std::string& text, int64_t& value) {
+    std::string s = trim(text);
+    if (s.empty()) return false;
+
+    // Character constant: 'a'
+    if (s.size() >= 3 && s.front() == '\'' && s.back() == '\'') {
+        int64_t result = 0;
+        for (size_t i = s.size() - 2; i >= 1; i--) {
+            result = (result << 8) | static_cast<unsigned char>(s[i]);
+        }
+        value = result;
+        return true;
+    }
+
+    bool negative = false;
+    size_t pos = 0;
+    if (s[0] == '-' || s[0] == '+') {
+        negative = s[0] == '-';
+        pos = 1;
+    }
+    if (pos >= s.size()) return false;
+
+    uint64_t result = 0;
+    if (s.size() > pos + 2 && s[pos] == '0' && (s[pos + 1] == 'x' || s[pos + 1] == 'X')) {
+        for (size_t i = pos + 2; i < s.size(); i++) {
+            if (!std::isxdigit(static_cast<unsigned char>(s[i]))) return false;
+            int digit = std::isdigit(static_cast<unsigned char>(s[i])) ? s[i] - '0'
+                      : std::tolower(static_cast<unsigned char>(s[i])) - 'a' + 10;
+            result = result * 16 + digit;
+        }
+    } else {
+        for (size_t i = pos; i < s.size(); i++) {
+            if (!std::isdigit(static_cast<unsigned char>(s[i]))) return false;
+            result = result * 10 + (s[i] - '0');
+        }
+    }
+    value = negative ? -static_cast<int64_t>(result) : static_cast<int64_t>(result);
+    return true;
+}
+
+static bool is_register(const std::string& name, RegisterInfo& info) {
+    auto it = register_table().find(lowercase(name));
+    if (it == register_table().end()) return false;
+    info = it->second;
+    return true;
+}
+
+static bool is_symbol_name(const std::string& s) {
+    if (s.empty()) return false;
+    if (!(std::isalpha(static_cast<unsigned char>(s[0])) || s[0] == '_' || s[0] == '.')) return false;
+    for (char c : s) {
+        if (!(std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.' || c == '$' || c == '@')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Resolve NASM local labels (".name") against the enclosing global label
+static std::string qualify(const std::string& name, const std::string& scope) {
+    if (!name.empty() && name[0] == '.' && (name.size() < 2 || name[1] != '.')) {
+        return scope + name;
+    }
+    return name;
+}
+
+static Operand parse_memory(const std::string& inner, const std::string& scope, int line) {
+    Operand op;
+    op.kind = OperandKind::Memory;
+    std::string text = trim(inner);
+
+    if (lowercase(text.substr(0, 4)) == "rel ") {
+        op.rip_relative = true;
+        text = trim(text.substr(4));
+    }
+
+    // Split into signed terms
+    std::vector<std::pair<int, std::string>> terms;
+    std::string current;
+    int sign = 1;
+    for (char c : text) {
+        if ((c == '+' || c == '-') && !trim(current).empty()) {
+            terms.push_back({sign, trim(current)});
+            current.clear();
+            sign = (c == '-') ? -1 : 1;
+        } else if ((c == '+' || c == '-') && trim(current).empty()) {
+            sign = (c == '-') ? -sign : sign;
+        } else {
+            current += c;
+        }
+    }
+    if (!trim(current).empty()) terms.push_back({sign, trim(current)});
+
+    for (auto& [term_sign, term] : terms) {
+        RegisterInfo info;
+        size_t star = term.find('*');
+        if (star != std::string::npos) {
+            std::string reg_name = trim(term.substr(0, star));
+            int64_t scale;
+            if (!is_register(reg_name, info) || !parse_number(term.substr(star + 1), scale)) {
+                asm_error(line, "bad scaled index '" + term + "'");
+            }
+            if (op.index >= 0 || term_sign < 0) asm_error(line, "bad index in '" + inner + "'");
+            op.index = info.number;
+            op.scale = static_cast<int>(scale);
+        } else if (is_register(term, info)) {
+            if (info.size != 64 || term_sign < 0) asm_error(line, "bad address register '" + term + "'");
+            if (op.base < 0) {
+                op.base = info.number;
+            } else if (op.index < 0) {
+                op.index = info.number;
+            } else {
+                asm_error(line, "too many registers in '" + inner + "'");
+            }
+        } else {
+            int64_t value;
+            if (parse_number(term, value)) {
+                op.imm += term_sign * value;
+            } else if (op.rip_relative && is_symbol_name(term) && op.symbol.empty() && term_sign > 0) {
+                op.symbol = qualify(term, scope);
+            } else {
+                asm_error(line, "unsupported address term '" + term + "'");
+            }
+        }
+    }
+
+    if (op.rip_relative && (op.symbol.empty() || op.base >= 0 || op.index >= 0)) {
+        asm_error(line, "unsupported RIP-relative operand '" + inner + "'");
+    }
+    if (!op.rip_relative && op.base < 0) {
+        asm_error(line, "memory operand needs a base register: '" + inner + "'");
+    }
+    if (op.index == 4) asm_error(line, "rsp cannot be an index register");
+    if (op.scale != 1 && op.scale != 2 && op.scale != 4 && op.scale != 8) {
+        asm_error(line, "bad scale in '" + inner + "'");
+    }
+    return op;
+}
+
+static Operand parse_operand(const std::string& raw, const std::string& scope, int line) {
+    std::string text = trim(raw);
+    int size = 0;
+
+    // Optional size keyword
+    static const std::map<std::string, int> sizes = {
+        {"byte", 8}, {"word", 16}, {"dword", 32}, {"qword", 64}
+    };
+    size_t space = text.find_first_of(" \t");
+    if (space != std::string::npos) {
+        auto it = sizes.find(lowercase(text.substr(0, space)));
+        if (it != sizes.end()) {
+            size = it->second;
+            text = trim(text.substr(space));
+        }
+    }
+
+    // "symbol wrt ..plt" is a plain reference once we link ourselves
+    size_t wrt = lowercase(text).find(" wrt ");
+    if (wrt != std::string::npos) {
+        text = trim(text.substr(0, wrt));
+    }
+
+    Operand op;
+    if (!text.empty() && text.front() == '[') {
+        if (text.back() != ']') asm_error(line, "unterminated memory operand '" + raw + "'");
+        op = parse_memory(text.substr(1, text.size() - 2), scope, line);
+        op.size = size;
+        return op;
+    }
+
+    RegisterInfo info;
+    if (is_register(text, info)) {
+        op.kind = OperandKind::Register;
+        op.reg = info.number;
+        op.size = info.size;
+        return op;
+    }
+
+    int64_t value;
+    if (parse_number(text, value)) {
+        op.kind = OperandKind::Immediate;
+        op.imm = value;
+        op.size = size;
+        return op;
+    }
+
+    if (is_symbol_name(text)) {
+        op.kind = OperandKind::Symbol;
+        op.symbol = qualify(text, scope);
+        return op;
+    }
+
+    asm_error(line, "unsupported operand '" + raw + "'");
+}
+
+static bool fits_int8(int64_t v) {
+    return v >= -128 && v <= 127;
+}
+
+static bool fits_int32(int64_t v) {
+    return v >= std::numeric_limits<int32_t>::min() && v <= std::numeric_limits<int32_t>::max();
+}
+
+static void put_le(std::vector<uint8_t>& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+// Byte registers spl/bpl/sil/dil are only reachable with a REX prefix
+static bool needs_rex_for_byte(const Operand& op) {
+    return op.kind == OperandKind::Register && op.size == 8 && op.reg >= 4 && op.reg <= 7;
+}
+
+// Emit [REX] opcode ModRM [SIB] [disp] for a reg-field/rm pair. The
+// immediate (if any) is appended by the caller.
+static void emit_modrm(Encoding& enc, const std::vector<uint8_t>& opcode, int reg_field,
+                       const Operand& rm, bool rex_w, bool force_rex, int line) {
+    uint8_t rex = 0x40;
+    if (rex_w) rex |= 0x08;
+    if (reg_field >= 8) rex |= 0x04;
+    if (rm.kind == OperandKind::Register && rm.reg >= 8) rex |= 0x01;
+    if (rm.kind == OperandKind::Memory) {
+        if (rm.index >= 8) rex |= 0x02;
+        if (rm.base >= 8) rex |= 0x01;
+    }
+    if (rex != 0x40 || force_rex) enc.bytes.push_back(rex);
+    enc.bytes.insert(enc.bytes.end(), opcode.begin(), opcode.end());
+
+    int reg_bits = (reg_field & 7) << 3;
+    if (rm.kind == OperandKind::Register) {
+        enc.bytes.push_back(static_cast<uint8_t>(0xC0 | reg_bits | (rm.reg & 7)));
+        return;
+    }
+    if (rm.kind != OperandKind::Memory) asm_error(line, "expected register or memory operand");
+
+    if (rm.rip_relative) {
+        enc.bytes.push_back(static_cast<uint8_t>(0x05 | reg_bits));
+        enc.fixups.push_back({enc.bytes.size(), 4, rm.symbol, rm.imm});
+        put_le(enc.bytes, 0, 4);
+        return;
+    }
+
+    int base = rm.base;
+    bool need_sib = rm.index >= 0 || (base & 7) == 4;
+    int mod;
+    if (rm.imm == 0 && (base & 7) != 5) {
+        mod = 0;
+    } else if (fits_int8(rm.imm)) {
+        mod = 1;
+    } else if (fits_int32(rm.imm)) {
+        mod = 2;
+    } else {
+        asm_error(line, "displacement out of range");
+    }
+
+    if (need_sib) {
+        enc.bytes.push_back(static_cast<uint8_t>((mod << 6) | reg_bits | 4));
+        int scale_bits = rm.scale == 8 ? 3 : rm.scale == 4 ? 2 : rm.scale == 2 ? 1 : 0;
+        int index = rm.index >= 0 ? (rm.index & 7) : 4;
+        enc.bytes.push_back(static_cast<uint8_t>((scale_bits << 6) | (index << 3) | (base & 7)));
+    } else {
+        enc.bytes.push_back(static_cast<uint8_t>((mod << 6) | reg_bits | (base & 7)));
+    }
+    if (mod == 1) put_le(enc.bytes, static_cast<uint64_t>(rm.imm), 1);
+    if (mod == 2) put_le(enc.bytes, static_cast<uint64_t>(rm.imm), 4);
+}
+
+// Operand size of a two-operand instruction, taken from whichever side knows it
+static int operand_size(const Instruction& inst) {
+    for (const auto& op : inst.operands) {
+        if (op.kind == OperandKind::Register) return op.size;
+    }
+    for (const auto& op : inst.operands) {
+        if (op.size) return op.size;
+    }
+    asm_error(inst.line, "operation size not specified for '" + inst.mnemonic + "'");
+}
+
+static void check_operand_count(const Instruction& inst, size_t count) {
+    if (inst.operands.size() != count) {
+        asm_error(inst.line, "'" + inst.mnemonic + "' expects " + std::to_string(count) + " operand(s)");
+    }
+}
+
+static bool is_kind(const Operand& op, OperandKind kind) {
+    return op.kind == kind;
+}
+
+// Branch to a label: jmp/jcc/call. long_form selects rel32 over rel8.
+static void encode_branch(Encoding& enc, const Instruction& inst, int condition, bool long_form) {
+    const Operand& target = inst.operands[0];
+    bool is_call = inst.mnemonic == "call";
+    if (condition < 0 && (is_kind(target, OperandKind::Register) || is_kind(target, OperandKind::Memory))) {
+        // Indirect jmp/call through a register or memory slot
+        emit_modrm(enc, {0xFF}, is_call ? 2 : 4, target, false, false, inst.line);
+        return;
+    }
+    if (!is_kind(target, OperandKind::Symbol)) {
+        asm_error(inst.line, "'" + inst.mnemonic + "' needs a label or register target");
+    }
+    if (is_call || long_form) {
+        if (is_call) {
+            enc.bytes.push_back(0xE8);
+        } else if (condition < 0) {
+            enc.bytes.push_back(0xE9);
+        } else {
+            enc.bytes.push_back(0x0F);
+            enc.bytes.push_back(static_cast<uint8_t>(0x80 + condition));
+        }
+        enc.fixups.push_back({enc.bytes.size(), 4, target.symbol, 0});
+        put_le(enc.bytes, 0, 4);
+    } else {
+        enc.bytes.push_back(static_cast<uint8_t>(condition < 0 ? 0xEB : 0x70 + condition));
+        enc.fixups.push_back({enc.bytes.size(), 1, target.symbol, 0});
+        enc.bytes.push_back(0);
+    }
+}
+
+static bool is_branch(const std::string& mnemonic, int& condition) {
+    condition = -1;
+    if (mnemonic == "jmp" || mnemonic == "call") return true;
+    if (mnemonic.size() > 1 && mnemonic[0] == 'j') {
+        auto it = condition_table().find(mnemonic.substr(1));
+        if (it != condition_table().end()) {
+            condition = it->second;
+            return true;
+        }
+    }
+    return false;
+}
+
+static Encoding encode(const Instruction& inst, bool long_form) {
+    Encoding enc;
+    const std::string& m = inst.mnemonic;
+    const auto& ops = inst.operands;
+
+    int condition;
+    if (is_branch(m, condition)) {
+        check_operand_count(inst, 1);
+        encode_branch(enc, inst, condition, long_form);
+    } else if (m == "ret") {
+        enc.bytes.push_back(0xC3);
+    } else if (m == "leave") {
+        enc.bytes.push_back(0xC9);
+    } else if (m == "nop") {
+        enc.bytes.push_back(0x90);
+    } else if (m == "syscall") {
+        enc.bytes = {0x0F, 0x05};
+    } else if (m == "cqo") {
+        enc.bytes = {0x48, 0x99};
+    } else if (m == "push" || m == "pop") {
+        check_operand_count(inst, 1);
+        const Operand& op = ops[0];
+        if (is_kind(op, OperandKind::Register) && op.size == 64) {
+            if (op.reg >= 8) enc.bytes.push_back(0x41);
+            enc.bytes.push_back(static_cast<uint8_t>((m == "push" ? 0x50 : 0x58) + (op.reg & 7)));
+        } else if (m == "push" && is_kind(op, OperandKind::Immediate)) {
+            if (fits_int8(op.imm)) {
+                enc.bytes = {0x6A, static_cast<uint8_t>(op.imm)};
+            } else if (fits_int32(op.imm)) {
+                enc.bytes.push_back(0x68);
+                put_le(enc.bytes, static_cast<uint64_t>(op.imm), 4);
+            } else {
+                asm_error(inst.line, "push immediate out of range");
+            }
+        } else if (is_kind(op, OperandKind::Memory)) {
+            emit_modrm(enc, {static_cast<uint8_t>(m == "push" ? 0xFF : 0x8F)}, m == "push" ? 6 : 0,
+                       op, false, false, inst.line);
+        } else {
+            asm_error(inst.line, "unsupported operand for '" + m + "'");
+        }
+    } else if (alu_table().count(m)) {
+        check_operand_count(inst, 2);
+        int n = alu_table().at(m);
+        const Operand& dst = ops[0];
+        const Operand& src = ops[1];
+        int size = operand_size(inst);
+        bool w = size == 64;
+        bool force = needs_rex_for_byte(dst) || needs_rex_for_byte(src);
+        if (size == 16) asm_error(inst.line, "16-bit operations are not supported");
+        if (is_kind(src, OperandKind::Register)) {
+            uint8_t opcode = static_cast<uint8_t>(8 * n + (size == 8 ? 0x00 : 0x01));
+            emit_modrm(enc, {opcode}, src.reg, dst, w, force, inst.line);
+        } else if (is_kind(src, OperandKind::Memory) && is_kind(dst, OperandKind::Register)) {
+            uint8_t opcode = static_cast<uint8_t>(8 * n + (size == 8 ? 0x02 : 0x03));
+            emit_modrm(enc, {opcode}, dst.reg, src, w, force, inst.line);
+        } else if (is_kind(src, OperandKind::Immediate)) {
+            if (size == 8) {
+                emit_modrm(enc, {0x80}, n, dst, false, force, inst.line);
+                put_le(enc.bytes, static_cast<uint64_t>(src.imm), 1);
+            } else if (fits_int8(src.imm)) {
+                emit_modrm(enc, {0x83}, n, dst, w, force, inst.line);
+                put_le(enc.bytes, static_cast<uint64_t>(src.imm), 1);
+            } else if (fits_int32(src.imm) && is_kind(dst, OperandKind::Register) && dst.reg == 0) {
+                // Short accumulator form: op rax, imm32
+                if (w) enc.bytes.push_back(0x48);
+                enc.bytes.push_back(static_cast<uint8_t>(8 * n + 0x05));
+                put_le(enc.bytes, static_cast<uint64_t>(src.imm), 4);
+            } else if (fits_int32(src.imm)) {
+                emit_modrm(enc, {0x81}, n, dst, w, force, inst.line);
+                put_le(enc.bytes, static_cast<uint64_t>(src.imm), 4);
+            } else {
+                asm_error(inst.line, "immediate out of range for '" + m + "'");
+            }
+        } else {
+            asm_error(inst.line, "unsupported operands for '" + m + "'");
+        }
+    } else if (m == "mov") {
+        check_operand_count(inst, 2);
+        const Operand& dst = ops[0];
+        const Operand& src = ops[1];
+        int size = operand_size(inst);
+        bool w = size == 64;
+        bool force = needs_rex_for_byte(dst) || needs_rex_for_byte(src);
+        if (size == 16) asm_error(inst.line, "16-bit operations are not supported");
+        if (is_kind(src, OperandKind::Register)) {
+            emit_modrm(enc, {static_cast<uint8_t>(size == 8 ? 0x88 : 0x89)}, src.reg, dst, w, force, inst.line);
+        } else if (is_kind(src, OperandKind::Memory) && is_kind(dst, OperandKind::Register)) {
+            emit_modrm(enc, {static_cast<uint8_t>(size == 8 ? 0x8A : 0x8B)}, dst.reg, src, w, force, inst.line);
+        } else if (is_kind(src, OperandKind::Immediate) && is_kind(dst, OperandKind::Register)) {
+            if (size == 8) {
+                if (dst.reg >= 8 || force) enc.bytes.push_back(static_cast<uint8_t>(0x40 | (dst.reg >= 8 ? 1 : 0)));
+                enc.bytes.push_back(static_cast<uint8_t>(0xB0 + (dst.reg & 7)));
+                put_le(enc.bytes, static_cast<uint64_t>(src.imm), 1);
+            } else if (size == 32 || (src.imm >= 0 && src.imm <= 0xFFFFFFFFLL)) {
+                // 32-bit move zero-extends into the full register
+                if (dst.reg >= 8) enc.bytes.push_back(0x41);
+                enc.bytes.push_back(static_cast<uint8_t>(0xB8 + (dst.reg & 7)));
+                put_le(enc.bytes, static_cast<uint64_t>(src.imm), 4);
+            } else if (fits_int32(src.imm)) {
+                emit_modrm(enc, {0xC7}, 0, dst, true, false, inst.line);
+                put_le(enc.bytes, static_cast<uint64_t>(src.imm), 4);
+            } else {
+                enc.bytes.push_back(static_cast<uint8_t>(0x48 | (dst.reg >= 8 ? 1 : 0)));
+                enc.bytes.push_back(static_cast<uint8_t>(0xB8 + (dst.reg & 7)));
+                put_le(enc.bytes, static_cast<uint64_t>(src.imm), 8);
+            }
+        } else if (is_kind(src, OperandKind::Immediate) && is_kind(dst, OperandKind::Memory)) {
+            if (size == 8) {
+                emit_modrm(enc, {0xC6}, 0, dst, false, false, inst.line);
+                put_le(enc.bytes, static_cast<uint64_t>(src.imm), 1);
+            } else if (fits_int32(src.imm)) {
+                emit_modrm(enc, {0xC7}, 0, dst, w, false, inst.line);
+                put_le(enc.bytes, static_cast<uint64_t>(src.imm), 4);
+            } else {
+                asm_error(inst.line, "immediate out of range for memory store");
+            }
+        } else {
+            asm_error(inst.line, "unsupported operands for 'mov'");
+        }
+    } else if (m == "movzx") {
+        check_operand_count(inst, 2);
+        const Operand& dst = ops[0];
+        const Operand& src = ops[1];
+        if (!is_kind(dst, OperandKind::Register)) asm_error(inst.line, "movzx needs a register destination");
+        int src_size = src.size;
+        if (src_size != 8 && src_size != 16) asm_error(inst.line, "movzx source must be byte or word");
+        emit_modrm(enc, {0x0F, static_cast<uint8_t>(src_size == 8 ? 0xB6 : 0xB7)}, dst.reg, src,
+                   dst.size == 64, needs_rex_for_byte(src), inst.line);
+    } else if (m == "lea") {
+        check_operand_count(inst, 2);
+        if (!is_kind(ops[0], OperandKind::Register) || !is_kind(ops[1], OperandKind::Memory)) {
+            asm_error(inst.line, "lea needs register, memory");
+        }
+        emit_modrm(enc, {0x8D}, ops[0].reg, ops[1], ops[0].size == 64, false, inst.line);
+    } else if (m == "test") {
+        check_operand_count(inst, 2);
+        const Operand& dst = ops[0];
+        const Operand& src = ops[1];
+        int size = operand_size(inst);
+        bool force = needs_rex_for_byte(dst) || needs_rex_for_byte(src);
+        if (is_kind(src, OperandKind::Register)) {
+            emit_modrm(enc, {static_cast<uint8_t>(size == 8 ? 0x84 : 0x85)}, src.reg, dst, size == 64, force, inst.line);
+        } else if (is_kind(src, OperandKind::Immediate)) {
+            if (!fits_int32(src.imm)) asm_error(inst.line, "immediate out of range for 'test'");
+            emit_modrm(enc, {static_cast<uint8_t>(size == 8 ? 0xF6 : 0xF7)}, 0, dst, size == 64, force, inst.line);
+            put_le(enc.bytes, static_cast<uint64_t>(src.imm), size == 8 ? 1 : 4);
+        } else {
+            asm_error(inst.line, "unsupported operands for 'test'");
+        }
+    } else if (m == "imul") {
+        const Operand& dst = ops[0];
+        if (ops.size() == 1) {
+            emit_modrm(enc, {0xF7}, 5, dst, operand_size(inst) == 64, false, inst.line);
+        } else if (ops.size() == 2 && is_kind(ops[1], OperandKind::Immediate)) {
+            // imul r, imm == imul r, r, imm
+            int64_t imm = ops[1].imm;
+            if (!fits_int32(imm)) asm_error(inst.line, "immediate out of range for 'imul'");
+            emit_modrm(enc, {static_cast<uint8_t>(fits_int8(imm) ? 0x6B : 0x69)}, dst.reg, dst,
+                       dst.size == 64, false, inst.line);
+            put_le(enc.bytes, static_cast<uint64_t>(imm), fits_int8(imm) ? 1 : 4);
+        } else if (ops.size() == 2) {
+            emit_modrm(enc, {0x0F, 0xAF}, dst.reg, ops[1], dst.size == 64, false, inst.line);
+        } else if (ops.size() == 3 && is_kind(ops[2], OperandKind::Immediate)) {
+            int64_t imm = ops[2].imm;
+            if (!fits_int32(imm)) asm_error(inst.line, "immediate out of range for 'imul'");
+            emit_modrm(enc, {static_cast<uint8_t>(fits_int8(imm) ? 0x6B : 0x69)}, dst.reg, ops[1],
+                       dst.size == 64, false, inst.line);
+            put_le(enc.bytes, static_cast<uint64_t>(imm), fits_int8(imm) ? 1 : 4);
+        } else {
+            asm_error(inst.line, "unsupported operands for 'imul'");
+        }
+    } else if (m == "div" || m == "idiv" || m == "mul" || m == "neg" || m == "not") {
+        check_operand_count(inst, 1);
+        static const std::map<std::string, int> ext = {
+            {"not", 2}, {"neg", 3}, {"mul", 4}, {"div", 6}, {"idiv", 7}
+        };
+        int size = operand_size(inst);
+        emit_modrm(enc, {static_cast<uint8_t>(size == 8 ? 0xF6 : 0xF7)}, ext.at(m), ops[0],
+                   size == 64, needs_rex_for_byte(ops[0]), inst.line);
+    } else if (m == "inc" || m == "dec") {
+        check_operand_count(inst, 1);
+        int size = operand_size(inst);
+        emit_modrm(enc, {static_cast<uint8_t>(size == 8 ? 0xFE : 0xFF)}, m == "inc" ? 0 : 1, ops[0],
+                   size == 64, needs_rex_for_byte(ops[0]), inst.line);
+    } else if (m == "shl" || m == "sal" || m == "shr" || m == "sar") {
+        check_operand_count(inst, 2);
+        int ext = m == "shr" ? 5 : m == "sar" ? 7 : 4;
+        int size = ops[0].size ? ops[0].size : 64;
+        if (is_kind(ops[1], OperandKind::Immediate) && ops[1].imm == 1) {
+            emit_modrm(enc, {static_cast<uint8_t>(size == 8 ? 0xD0 : 0xD1)}, ext, ops[0], size == 64, false, inst.line);
+        } else if (is_kind(ops[1], OperandKind::Immediate)) {
+            emit_modrm(enc, {static_cast<uint8_t>(size == 8 ? 0xC0 : 0xC1)}, ext, ops[0], size == 64, false, inst.line);
+            put_le(enc.bytes, static_cast<uint64_t>(ops[1].imm), 1);
+        } else if (is_kind(ops[1], OperandKind::Register) && ops[1].reg == 1 && ops[1].size == 8) {
+            emit_modrm(enc, {static_cast<uint8_t>(size == 8 ? 0xD2 : 0xD3)}, ext, ops[0], size == 64, false, inst.line);
+        } else {
+            asm_error(inst.line, "shift count must be an immediate or cl");
+        }
+    } else if (m.size() > 3 && m.compare(0, 3, "set") == 0 && condition_table().count(m.substr(3))) {
+        check_operand_count(inst, 1);
+        int cc = condition_table().at(m.substr(3));
+        emit_modrm(enc, {0x0F, static_cast<uint8_t>(0x90 + cc)}, 0, ops[0], false,
+                   needs_rex_for_byte(ops[0]), inst.line);
+    } else if (m.size() > 4 && m.compare(0, 4, "cmov") == 0 && condition_table().count(m.substr(4))) {
+        check_operand_count(inst, 2);
+        int cc = condition_table().at(m.substr(4));
+        emit_modrm(enc, {0x0F, static_cast<uint8_t>(0x40 + cc)}, ops[0].reg, ops[1], ops[0].size == 64,
+                   false, inst.line);
+    } else {
+        asm_error(inst.line, "unsupported instruction '" + m + "'");
+    }
+
+    // PC-relative fields are relative to the end of the instruction
+    for (auto& fixup : enc.fixups) {
+        fixup.addend -= static_cast<int64_t>(enc.bytes.size() - fixup.at);
+    }
+    return enc;
+}
+
+static bool is_data_directive(const std::string& word) {
+    static const std::vector<std::string> directives = {
+        "db", "dw", "dd", "dq", "resb", "resw", "resd", "resq", "times"
+    };
+    return std::find(directives.begin(), directives.end(), lowercase(word)) != directives.end();
+}
+
+// Append db/dw/dd/dq items (or reserve bss space) for one directive line
+static void emit_data(ObjectCode& object, SectionKind section, const std::string& text, int line) {
+    std::string rest = trim(text);
+    size_t space = rest.find_first_of(" \t");
+    std::string directive = lowercase(rest.substr(0, space));
+    std::string args = space == std::string::npos ? "" : trim(rest.substr(space));
+
+    if (directive == "times") {
+        size_t count_end = args.find_first_of(" \t");
+        int64_t count;
+        if (count_end == std::string::npos || !parse_number(args.substr(0, count_end), count) || count < 0) {
+            asm_error(line, "bad times count");
+        }
+        for (int64_t i = 0; i < count; i++) {
+            emit_data(object, section, args.substr(count_end), line);
+        }
+        return;
+    }
+
+    if (directive.compare(0, 3, "res") == 0) {
+        int64_t count;
+        if (!parse_number(args, count) || count < 0) asm_error(line, "bad reservation size");
+        int unit = directive == "resb" ? 1 : directive == "resw" ? 2 : directive == "resd" ? 4 : 8;
+        if (section == SectionKind::Bss) {
+            object.bss_size += static_cast<uint64_t>(count * unit);
+        } else {
+            object.data.insert(object.data.end(), static_cast<size_t>(count * unit), 0);
+        }
+        return;
+    }
+
+    if (section != SectionKind::Data) asm_error(line, "initialized data outside .data");
+    int unit = directive == "db" ? 1 : directive == "dw" ? 2 : directive == "dd" ? 4 : 8;
+    for (const auto& item : split_operands(args)) {
+        if (item.size() >= 2 && (item.front() == '"' || item.front() == '`') && item.back() == item.front()) {
+            for (size_t i = 1; i + 1 < item.size(); i++) {
+                object.data.push_back(static_cast<uint8_t>(item[i]));
+            }
+            // Strings are padded to a whole number of units
+            while ((object.data.size() % unit) != 0) object.data.push_back(0);
+            continue;
+        }
+        if (unit == 1 && item.size() > 3 && item.front() == '\'' && item.back() == '\'') {
+            for (size_t i = 1; i + 1 < item.size(); i++) {
+                object.data.push_back(static_cast<uint8_t>(item[i]));
+            }
+            continue;
+        }
+        int64_t value;
+        if (!parse_number(item, value)) asm_error(line, "unsupported data item '" + item + "'");
+        put_le(object.data, static_cast<uint64_t>(value), unit);
+    }
+}
+
+ObjectCode assemble(const std::string& source) {
+    ObjectCode object;
+    std::vector<TextItem> text_items;
+    std::vector<std::pair<std::string, int>> globals;   // name, line declared
+    std::map<std::string, size_t> data_labels;   // name -> index into object.symbols
+
+    SectionKind section = SectionKind::Text;
+    bool discard = false;          // inside a section we don't emit (e.g. .note.GNU-stack)
+    std::string scope;             // last non-local label, for ".local" names
+
+    auto define_label = [&](const std::string& raw_name, int line) {
+        std::string name = qualify(raw_name, scope);
+        if (raw_name.empty() || raw_name[0] != '.') scope = raw_name;
+        if (discard) return;
+        if (section == SectionKind::Text) {
+            text_items.push_back({true, name, line, {}});
+        } else {
+            uint64_t offset = section == SectionKind::Data ? object.data.size() : object.bss_size;
+            if (data_labels.count(name)) asm_error(line, "label '" + name + "' redefined");
+            data_labels[name] = object.symbols.size();
+            object.symbols.push_back({name, section, offset, false});
+        }
+    };
+
+    std::istringstream input(source);
+    std::string raw_line;
+    int line_number = 0;
+    while (std::getline(input, raw_line)) {
+        line_number++;
+        std::string line = trim(strip_comment(raw_line));
+        if (line.empty()) continue;
+
+        size_t space = line.find_first_of(" \t");
+        std::string first = line.substr(0, space);
+        std::string rest = space == std::string::npos ? "" : trim(line.substr(space));
+        std::string keyword = lowercase(first);
+
+        if (keyword == "section" || keyword == "segment") {
+            std::string name = rest.substr(0, rest.find_first_of(" \t"));
+            discard = false;
+            if (name == ".text") {
+                section = SectionKind::Text;
+            } else if (name == ".data" || name == ".rodata") {
+                section = SectionKind::Data;
+            } else if (name == ".bss") {
+                section = SectionKind::Bss;
+            } else {
+                discard = true;
+            }
+            continue;
+        }
+        if (keyword == "global") {
+            for (const auto& name : split_operands(rest)) globals.emplace_back(name, line_number);
+            continue;
+        }
+        if (keyword == "extern" || keyword == "default" || keyword == "bits") {
+            continue;
+        }
+
+        // "label:" possibly followed by more on the same line
+        if (!first.empty() && first.back() == ':') {
+            define_label(first.substr(0, first.size() - 1), line_number);
+            if (rest.empty()) continue;
+            line = rest;
+            space = line.find_first_of(" \t");
+            first = line.substr(0, space);
+            rest = space == std::string::npos ? "" : trim(line.substr(space));
+            keyword = lowercase(first);
+        }
+
+        // "name db ..." style data label
+        if (!is_data_directive(first) && !rest.empty()) {
+            std::string next = rest.substr(0, rest.find_first_of(" \t"));
+            if (is_data_directive(next)) {
+                define_label(first, line_number);
+                line = rest;
+                keyword = lowercase(next);
+            }
+        }
+
+        if (discard) continue;
+
+        if (is_data_directive(keyword)) {
+            if (section == SectionKind::Text) asm_error(line_number, "data directive in .text");
+            emit_data(object, section, line, line_number);
+            continue;
+        }
+
+        if (section != SectionKind::Text) asm_error(line_number, "instruction outside .text");
+
+        Instruction inst;
+        inst.line = line_number;
+        space = line.find_first_of(" \t");
+        inst.mnemonic = lowercase(line.substr(0, space));
+        std::string operand_text = space == std::string::npos ? "" : line.substr(space);
+        for (const auto& part : split_operands(operand_text)) {
+            inst.operands.push_back(parse_operand(part, scope, line_number));
+        }
+        text_items.push_back({false, "", 0, inst});
+    }
+
+    // Branch relaxation: start with every jump short and widen the ones whose
+    // target is out of rel8 range (or not in this section) until stable
+    std::vector<bool> long_form(text_items.size(), false);
+    std::vector<Encoding> encodings(text_items.size());
+    std::map<std::string, uint64_t> text_labels;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        text_labels.clear();
+        uint64_t offset = 0;
+        std::vector<uint64_t> offsets(text_items.size());
+        for (size_t i = 0; i < text_items.size(); i++) {
+            offsets[i] = offset;
+            if (text_items[i].is_label) {
+                if (text_labels.count(text_items[i].label)) {
+                    asm_error(text_items[i].label_line, "label '" + text_items[i].label + "' redefined");
+                }
+                text_labels[text_items[i].label] = offset;
+                continue;
+            }
+            encodings[i] = encode(text_items[i].instruction, long_form[i]);
+            offset += encodings[i].bytes.size();
+        }
+        for (size_t i = 0; i < text_items.size(); i++) {
+            if (text_items[i].is_label || long_form[i]) continue;
+            for (const auto& fixup : encodings[i].fixups) {
+                if (fixup.width != 1) continue;
+                auto target = text_labels.find(fixup.symbol);
+                int64_t field = static_cast<int64_t>(offsets[i] + fixup.at);
+                if (target == text_labels.end() ||
+                    !fits_int8(static_cast<int64_t>(target->second) + fixup.addend - field)) {
+                    long_form[i] = true;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // Final emission: same-section references are patched here, the rest
+    // become relocations for the linker
+    for (size_t i = 0; i < text_items.size(); i++) {
+        if (text_items[i].is_label) continue;
+        uint64_t start = object.text.size();
+        const Encoding& enc = encodings[i];
+        object.text.insert(object.text.end(), enc.bytes.begin(), enc.bytes.end());
+        for (const auto& fixup : enc.fixups) {
+            uint64_t field = start + fixup.at;
+            auto target = text_labels.find(fixup.symbol);
+            if (target != text_labels.end()) {
+                int64_t value = static_cast<int64_t>(target->second) + fixup.addend - static_cast<int64_t>(field);
+                for (int b = 0; b < fixup.width; b++) {
+                    object.text[field + b] = static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * b));
+                }
+            } else {
+                if (fixup.width != 4) asm_error(text_items[i].instruction.line, "short reference to '" + fixup.symbol + "'");
+                object.relocations.push_back({SectionKind::Text, field, fixup.symbol, fixup.addend});
+            }
+        }
+    }
+
+    for (const auto& [name, offset] : text_labels) {
+        object.symbols.push_back({name, SectionKind::Text, offset, false});
+    }
+    for (const auto& [name, line] : globals) {
+        bool found = false;
+        for (auto& symbol : object.symbols) {
+            if (symbol.name == name) {
+                symbol.global = true;
+                found = true;
+            }
+        }
+        if (!found) asm_error(line, "global '" + name + "' is never defined");
+    }
+    return object;
+}
+
+static const char OBJECT_MAGIC[8] = {'D', 'U', 'R', 'O', 'B', 'J', '1', 0};
+
+static void put_string(std::string& out, const std::string& value) {
+    uint64_t length = value.size();
+    out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    out.append(value);
+}
+
+static void put_u64(std::string& out, uint64_t value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+std::string serialize_object(const ObjectCode& object) {
+    std::string out(OBJECT_MAGIC, sizeof(OBJECT_MAGIC));
+    put_string(out, std::string(object.text.begin(), object.text.end()));
+    put_string(out, std::string(object.data.begin(), object.data.end()));
+    put_u64(out, object.bss_size);
+    put_u64(out, object.symbols.size());
+    for (const auto& symbol : object.symbols) {
+        put_string(out, symbol.name);
+        put_u64(out, static_cast<uint64_t>(symbol.section));
+        put_u64(out, symbol.offset);
+        put_u64(out, symbol.global ? 1 : 0);
+    }
+    put_u64(out, object.relocations.size());
+    for (const auto& relocation : object.relocations) {
+        put_u64(out, static_cast<uint64_t>(relocation.section));
+        put_u64(out, relocation.offset);
+        put_string(out, relocation.symbol);
+        put_u64(out, static_cast<uint64_t>(relocation.addend));
+    }
+    return out;
+}
+
+// Bounds-checked reader over serialized bytes
+struct ObjectReader {
+    const std::string& bytes;
+    size_t position = 0;
+
+    bool u64(uint64_t& value) {
+        if (bytes.size() - position < sizeof(value)) return false;
+        std::memcpy(&value, bytes.data() + position, sizeof(value));
+        position += sizeof(value);
+        return true;
+    }
+
+    bool string(std::string& value) {
+        uint64_t length;
+        if (!u64(length) || bytes.size() - position < length) return false;
+        value.assign(bytes, position, length);
+        position += length;
+        return true;
+    }
+
+    bool section(SectionKind& kind) {
+        uint64_t value;
+        if (!u64(value) || value > static_cast<uint64_t>(SectionKind::Bss)) return false;
+        kind = static_cast<SectionKind>(value);
+        return true;
+    }
+};
+
+bool deserialize_object(const std::string& bytes, ObjectCode& object) {
+    if (bytes.size() < sizeof(OBJECT_MAGIC) || bytes.compare(0, sizeof(OBJECT_MAGIC), OBJECT_MAGIC, sizeof(OBJECT_MAGIC)) != 0) {
+        return false;
+    }
+    ObjectReader reader{bytes, sizeof(OBJECT_MAGIC)};
+    ObjectCode result;
+    std::string text, data;
+    uint64_t symbol_count, relocation_count;
+    if (!reader.string(text) || !reader.string(data) || !reader.u64(result.bss_size) || !reader.u64(symbol_count)) {
+        return false;
+    }
+    result.text.assign(text.begin(), text.end());
+    result.data.assign(data.begin(), data.end());
+
+    for (uint64_t i = 0; i < symbol_count; i++) {
+        ObjectSymbol symbol;
+        uint64_t global;
+        if (!reader.string(symbol.name) || !reader.section(symbol.section)
+                || !reader.u64(symbol.offset) || !reader.u64(global)) {
+            return false;
+        }
+        symbol.global = global != 0;
+        result.symbols.push_back(std::move(symbol));
+    }
+
+    if (!reader.u64(relocation_count)) return false;
+    for (uint64_t i = 0; i < relocation_count; i++) {
+        ObjectRelocation relocation;
+        uint64_t addend;
+        if (!reader.section(relocation.section) || !reader.u64(relocation.offset)
+                || !reader.string(relocation.symbol) || !reader.u64(addend)) {
+            return false;
+        }
+        relocation.addend = static_cast<int64_t>(addend);
+        result.relocations.push_back(std::move(relocation));
+    }
+
+    if (reader.position != bytes.size()) return false;
+    object = std::move(result);
+    return true;
+}
+
+static uint64_t align_up(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+LinkedImage link_objects(const std::vector<ObjectCode>& objects,
+                         uint64_t text_address,
+                         const std::map<std::string, uint64_t>& externals) {
+    LinkedImage image;
+    image.text_address = text_address;
+
+    // Section placement per object
+    std::vector<uint64_t> text_base(objects.size()), data_base(objects.size()), bss_base(objects.size());
+    uint64_t text_size = 0;
+    for (size_t i = 0; i < objects.size(); i++) {
+        text_size = align_up(text_size, 16);
+        text_base[i] = text_size;
+        text_size += objects[i].text.size();
+    }
+    uint64_t data_size = 0;
+    for (size_t i = 0; i < objects.size(); i++) {
+        data_size = align_up(data_size, 16);
+        data_base[i] = data_size;
+        data_size += objects[i].data.size();
+    }
+    uint64_t bss_start = align_up(data_size, 16);
+    uint64_t bss_size = 0;
+    for (size_t i = 0; i < objects.size(); i++) {
+        bss_size = align_up(bss_size, 16);
+        bss_base[i] = bss_start + bss_size;
+        bss_size += objects[i].bss_size;
+    }
+
+    image.data_address = align_up(text_address + text_size, 0x1000);
+    image.text.assign(text_size, 0xCC);     // pad with int3
+    image.data.assign(bss_start, 0);
+    image.bss_size = bss_size;
+
+    auto address_of = [&](size_t i, const ObjectSymbol& symbol) {
+        switch (symbol.section) {
+            case SectionKind::Text: return image.text_address + text_base[i] + symbol.offset;
+            case SectionKind::Data: return image.data_address + data_base[i] + symbol.offset;
+            default:                return image.data_address + bss_base[i] + symbol.offset;
+        }
+    };
+
+    for (size_t i = 0; i < objects.size(); i++) {
+        std::copy(objects[i].text.begin(), objects[i].text.end(), image.text.begin() + text_base[i]);
+        std::copy(objects[i].data.begin(), objects[i].data.end(), image.data.begin() + data_base[i]);
+        for (const auto& symbol : objects[i].symbols) {
+            if (!symbol.global) continue;
+            if (image.symbols.count(symbol.name)) {
+                throw std::runtime_error("linker: duplicate symbol '" + symbol.name + "'");
+            }
+            image.symbols[symbol.name] = address_of(i, symbol);
+        }
+    }
+
+    for (size_t i = 0; i < objects.size(); i++) {
+        std::map<std::string, uint64_t> locals;
+        for (const auto& symbol : objects[i].symbols) {
+            locals[symbol.name] = address_of(i, symbol);
+        }
+        for (const auto& reloc : objects[i].relocations) {
+            uint64_t target;
+            if (locals.count(reloc.symbol)) {
+                target = locals[reloc.symbol];
+            } else if (image.symbols.count(reloc.symbol)) {
+                target = image.symbols[reloc.symbol];
+            } else if (externals.count(reloc.symbol)) {
+                target = externals.at(reloc.symbol);
+            } else {
+                throw std::runtime_error("linker: undefined symbol '" + reloc.symbol + "'");
+            }
+
+            std::vector<uint8_t>& bytes = reloc.section == SectionKind::Text ? image.text : image.data;
+            uint64_t base = reloc.section == SectionKind::Text ? image.text_address + text_base[i]
+                                                               : image.data_address + data_base[i];
+            uint64_t field = (reloc.section == SectionKind::Text ? text_base[i] : data_base[i]) + reloc.offset;
+            int64_t value = static_cast<int64_t>(target) + reloc.addend - static_cast<int64_t>(base + reloc.offset);
+            if (!fits_int32(value)) {
+                throw std::runtime_error("linker: reference to '" + reloc.symbol + "' out of range");
+            }
+            for (int b = 0; b < 4; b++) {
+                bytes[field + b] = static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * b));
+            }
+        }
+    }
+    return image;
+}
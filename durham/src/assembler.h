@@ -0,0 +1,67 @@
+#ifndef ASSEMBLER_H
+#define ASSEMBLER_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// In-process assembler for the NASM subset produced by gen_asm.cpp, so the
+// compiler doesn't have to shell out to nasm/gcc on the hot path.
+
+enum class SectionKind {
+    Text,
+    Data,
+    Bss
+};
+
+struct ObjectSymbol {
+    std::string name;       // local labels are stored as "parent.local"
+    SectionKind section;
+    uint64_t offset;
+    bool global;
+};
+
+// 32-bit PC-relative reference: value = S + addend - P, where P is the
+// address of the patched field
+struct ObjectRelocation {
+    SectionKind section;
+    uint64_t offset;
+    std::string symbol;
+    int64_t addend;
+};
+
+struct ObjectCode {
+    std::vector<uint8_t> text;
+    std::vector<uint8_t> data;
+    uint64_t bss_size = 0;
+    std::vector<ObjectSymbol> symbols;
+    std::vector<ObjectRelocation> relocations;
+};
+
+// Assemble NASM source; throws std::runtime_error on unsupported input
+ObjectCode assemble(const std::string& source);
+
+// Flat byte encoding of an object, for on-disk caches. deserialize_object
+// returns false if the bytes aren't a complete object from this format.
+std::string serialize_object(const ObjectCode& object);
+bool deserialize_object(const std::string& bytes, ObjectCode& object);
+
+// Objects placed at fixed addresses with every relocation applied
+struct LinkedImage {
+    std::vector<uint8_t> text;
+    std::vector<uint8_t> data;      // followed by bss_size zero bytes in memory
+    uint64_t bss_size = 0;
+    uint64_t text_address = 0;
+    uint64_t data_address = 0;      // first page boundary after the text
+    std::map<std::string, uint64_t> symbols;   // global symbol -> address
+};
+
+// Lay out the objects starting at text_address and resolve references between
+// them. Symbols no object defines are looked up in externals; throws if a
+// reference is still unresolved or out of rel32 range.
+LinkedImage link_objects(const std::vector<ObjectCode>& objects,
+                         uint64_t text_address,
+                         const std::map<std::string, uint64_t>& externals = {});
+
+#endif //ASSEMBLER_H
@@ -0,0 +1,26 @@
+#include "ast_arena.h"
+#include <algorithm>
+#include <cstdint>
+
+// Big enough that a typical program fits in one or two blocks
+static constexpr size_t ARENA_BLOCK_SIZE = 64 << 10;
+
+AstArena::~AstArena() {
+    // Nodes only own their own members, so any order would do
+    for (auto it = destructors.rbegin(); it != destructors.rend(); ++it) {
+        it->destroy(it->object);
+    }
+}
+
+void* AstArena::allocate(size_t size, size_t alignment) {
+    uintptr_t aligned = (reinterpret_cast<uintptr_t>(next) + alignment - 1) & ~(alignment - 1);
+    if (!next || aligned + size > reinterpret_cast<uintptr_t>(end)) {
+        size_t block_size = std::max(ARENA_BLOCK_SIZE, size + alignment);
+        blocks.emplace_back(new char[block_size]);
+        next = blocks.back().get();
+        end = next + block_size;
+        aligned = (reinterpret_cast<uintptr_t>(next) + alignment - 1) & ~(alignment - 1);
+    }
+    next = reinterpret_cast<char*>(aligned + size);
+    return reinterpret_cast<void*>(aligned);
+}
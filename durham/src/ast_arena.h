@@ -0,0 +1,45 @@
+#ifndef AST_ARENA_H
+#define AST_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator for the nodes of one compilation's AST. Nodes are carved out
+// of large blocks and the whole tree goes at once with the arena, so nodes
+// point at each other with plain pointers and visiting one costs nothing.
+class AstArena {
+    public:
+        AstArena() = default;
+        ~AstArena();
+        AstArena(const AstArena&) = delete;
+        AstArena& operator=(const AstArena&) = delete;
+
+        template <typename T, typename... Args>
+        T* make(Args&&... args) {
+            T* node = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+            if constexpr (!std::is_trivially_destructible_v<T>) {
+                destructors.push_back({node, [](void* object) { static_cast<T*>(object)->~T(); }});
+            }
+            return node;
+        }
+
+    private:
+        // Members of a node (names, child lists) still own heap memory
+        struct Destructor {
+            void* object;
+            void (*destroy)(void*);
+        };
+
+        void* allocate(size_t size, size_t alignment);
+
+        std::vector<std::unique_ptr<char[]>> blocks;
+        char* next = nullptr;       // free space in the newest block
+        char* end = nullptr;
+        std::vector<Destructor> destructors;
+};
+
+#endif //AST_ARENA_H
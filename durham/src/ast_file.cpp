@@ -0,0 +1,452 @@
+#include "main.h"
+#include "ast_file.h"
+#include "compile_cache.h"
+#include "source_file.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <unordered_map>
+
+static const char AST_MAGIC[8] = {'D', 'U', 'R', 'A', 'S', 'T', '2', 0};
+static constexpr uint32_t NO_INDEX = UINT32_MAX;
+
+// Sections follow the header in this order: node records, string table,
+// symbol names (string indices), list pool, string bytes. Every field is
+// native-endian; a file from another byte order fails the magic check.
+struct AstFileHeader {
+    char magic[8];
+    char key[40];               // CompileCache::ast_key_for(source)
+    uint32_t root;
+    uint32_t node_count;
+    uint32_t symbol_count;
+    uint32_t string_count;
+    uint32_t list_count;        // uint32 entries in the list pool
+    uint32_t checksum;          // payload_checksum of everything after the header
+    uint64_t string_bytes;
+};
+
+// One node. Nodes refer to each other by index; a child always comes after
+// its parent, so a file can't describe a cycle.
+struct AstFileNode {
+    uint8_t type;               // NodeType
+    uint8_t op;                 // TokenType of a BinaryOp or UnaryOp
+    uint16_t reserved;
+    uint32_t symbol;            // ASTNode::symbol, as an index into the file's symbols
+    uint32_t name;              // varName, arrayName or functionName, likewise
+    uint32_t value;             // string index of ASTNode::value
+    uint32_t var_type;          // string index of AssignmentNode::varType
+    uint32_t left;
+    uint32_t right;
+    uint32_t fields[4];         // the subclass's child pointers, see named_children
+    uint32_t children;          // list pool offset: a count, then node indices
+    uint32_t parameters;        // list pool offset: a count, then symbols
+    uint32_t reserved2;
+    int64_t literal;
+};
+
+struct AstFileString {
+    uint32_t offset;
+    uint32_t length;
+};
+
+static_assert(sizeof(AstFileHeader) == 80, "header layout is part of the format");
+static_assert(sizeof(AstFileNode) == 64, "node layout is part of the format");
+
+// The child pointers a subclass keeps in named fields, in file order
+static std::array<ASTNode**, 4> named_children(ASTNode* node) {
+    switch (node->type) {
+        case NodeType::IfStatement: {
+            auto ifNode = static_cast<IfNode*>(node);
+            return {&ifNode->condition, &ifNode->thenBranch, &ifNode->elseBranch, nullptr};
+        }
+        case NodeType::WhileLoop: {
+            auto whileNode = static_cast<WhileNode*>(node);
+            return {&whileNode->condition, &whileNode->body, nullptr, nullptr};
+        }
+        case NodeType::ForLoop: {
+            auto forNode = static_cast<ForNode*>(node);
+            return {&forNode->init, &forNode->condition, &forNode->increment, &forNode->body};
+        }
+        case NodeType::VectorAlloc:
+            return {&static_cast<VectorAllocNode*>(node)->size, nullptr, nullptr, nullptr};
+        case NodeType::ArrayAccess:
+            return {&static_cast<ArrayAccessNode*>(node)->index, nullptr, nullptr, nullptr};
+        case NodeType::FunctionDecl:
+            return {&static_cast<FunctionDeclNode*>(node)->body, nullptr, nullptr, nullptr};
+        case NodeType::Return:
+            return {&static_cast<ReturnNode*>(node)->returnValue, nullptr, nullptr, nullptr};
+        default:
+            return {};
+    }
+}
+
+// The name a subclass keeps besides ASTNode::symbol, if any
+static Symbol* name_field(ASTNode* node) {
+    switch (node->type) {
+        case NodeType::Assignment:
+            return &static_cast<AssignmentNode*>(node)->varName;
+        case NodeType::ArrayAccess:
+            return &static_cast<ArrayAccessNode*>(node)->arrayName;
+        case NodeType::FunctionDecl:
+            return &static_cast<FunctionDeclNode*>(node)->functionName;
+        default:
+            return nullptr;
+    }
+}
+
+// 32-bit FNV-1a, so a damaged file is rejected rather than half loaded
+static uint32_t payload_checksum(std::string_view payload) {
+    uint32_t hash = 0x811c9dc5u;
+    for (unsigned char c : payload) {
+        hash ^= c;
+        hash *= 0x01000193u;
+    }
+    return hash;
+}
+
+std::string ast_file_path(const std::string& source_path) {
+    return std::filesystem::path(source_path).replace_extension(".durast").string();
+}
+
+// Strings deduplicated into one pool
+struct StringPool {
+    std::vector<AstFileString> table;
+    std::string bytes;
+    std::unordered_map<std::string, uint32_t> indices;
+
+    uint32_t add(std::string_view text) {
+        auto [it, inserted] = indices.try_emplace(std::string(text), static_cast<uint32_t>(table.size()));
+        if (inserted) {
+            table.push_back({static_cast<uint32_t>(bytes.size()), static_cast<uint32_t>(text.size())});
+            bytes.append(text);
+        }
+        return it->second;
+    }
+};
+
+template <typename T>
+static void append_raw(std::string& out, const T* items, size_t count) {
+    out.append(reinterpret_cast<const char*>(items), count * sizeof(T));
+}
+
+void write_ast_file(const std::string& path, const ASTNode* ast, const SymbolTable& symbols,
+                    std::string_view source) {
+    if (!ast) return;
+
+    // Nodes are numbered as they are first reached while walking the list as
+    // it grows, so a child comes after its parent and deep operator chains
+    // need no recursion
+    std::vector<ASTNode*> nodes;
+    std::unordered_map<const ASTNode*, uint32_t> indices;
+    auto index_of = [&](ASTNode* node) -> uint32_t {
+        if (!node) return NO_INDEX;
+        auto [it, inserted] = indices.try_emplace(node, static_cast<uint32_t>(nodes.size()));
+        if (inserted) nodes.push_back(node);
+        return it->second;
+    };
+    index_of(const_cast<ASTNode*>(ast));
+
+    StringPool strings;
+    std::vector<uint32_t> symbol_names;
+    for (size_t symbol = 0; symbol < symbols.size(); symbol++) {
+        symbol_names.push_back(strings.add(symbols.name(static_cast<Symbol>(symbol))));
+    }
+
+    std::vector<AstFileNode> records;
+    std::vector<uint32_t> lists;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        ASTNode* node = nodes[i];
+        AstFileNode record{};
+        record.type = static_cast<uint8_t>(node->type);
+        if (node->type == NodeType::BinaryOp) {
+            record.op = static_cast<uint8_t>(static_cast<BinaryOpNode*>(node)->op);
+        } else if (node->type == NodeType::UnaryOp) {
+            record.op = static_cast<uint8_t>(static_cast<UnaryOpNode*>(node)->op);
+        }
+        record.symbol = node->symbol;
+        Symbol* name = name_field(node);
+        record.name = name ? *name : NO_SYMBOL;
+        record.value = node->value ? strings.add(*node->value) : NO_INDEX;
+        record.var_type = node->type == NodeType::Assignment
+            ? strings.add(static_cast<AssignmentNode*>(node)->varType) : NO_INDEX;
+        if (node->type == NodeType::Literal) {
+            record.literal = static_cast<LiteralNode*>(node)->literalValue;
+        }
+
+        record.left = index_of(node->left);
+        record.right = index_of(node->right);
+        std::array<ASTNode**, 4> fields = named_children(node);
+        for (size_t f = 0; f < fields.size(); f++) {
+            record.fields[f] = fields[f] ? index_of(*fields[f]) : NO_INDEX;
+        }
+
+        record.children = NO_INDEX;
+        if (!node->children.empty()) {
+            record.children = static_cast<uint32_t>(lists.size());
+            lists.push_back(static_cast<uint32_t>(node->children.size()));
+            for (ASTNode* child : node->children) {
+                lists.push_back(index_of(child));
+            }
+        }
+        record.parameters = NO_INDEX;
+        if (node->type == NodeType::FunctionDecl) {
+            const auto& parameters = static_cast<FunctionDeclNode*>(node)->parameters;
+            record.parameters = static_cast<uint32_t>(lists.size());
+            lists.push_back(static_cast<uint32_t>(parameters.size()));
+            lists.insert(lists.end(), parameters.begin(), parameters.end());
+        }
+        records.push_back(record);
+    }
+
+    AstFileHeader header{};
+    std::memcpy(header.magic, AST_MAGIC, sizeof(AST_MAGIC));
+    std::string key = CompileCache::ast_key_for(source);
+    std::memcpy(header.key, key.data(), std::min(key.size(), sizeof(header.key)));
+    header.root = 0;
+    header.node_count = static_cast<uint32_t>(records.size());
+    header.symbol_count = static_cast<uint32_t>(symbol_names.size());
+    header.string_count = static_cast<uint32_t>(strings.table.size());
+    header.list_count = static_cast<uint32_t>(lists.size());
+    header.string_bytes = strings.bytes.size();
+
+    std::string out;
+    append_raw(out, &header, 1);
+    append_raw(out, records.data(), records.size());
+    append_raw(out, strings.table.data(), strings.table.size());
+    append_raw(out, symbol_names.data(), symbol_names.size());
+    append_raw(out, lists.data(), lists.size());
+    out.append(strings.bytes);
+    header.checksum = payload_checksum(std::string_view(out).substr(sizeof(header)));
+    std::memcpy(out.data(), &header, sizeof(header));
+    write_file_atomically(path, out);
+}
+
+// Bounds-checked view of a mapped .durast
+struct AstFileReader {
+    std::string_view bytes;
+    AstFileHeader header;
+    size_t nodes_at = 0, strings_at = 0, symbols_at = 0, lists_at = 0, bytes_at = 0;
+
+    // Section offsets; false unless the sizes in the header add up to the file
+    bool open() {
+        if (bytes.size() < sizeof(header)) return false;
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        if (std::memcmp(header.magic, AST_MAGIC, sizeof(AST_MAGIC)) != 0) return false;
+        nodes_at = sizeof(header);
+        strings_at = nodes_at + uint64_t(header.node_count) * sizeof(AstFileNode);
+        symbols_at = strings_at + uint64_t(header.string_count) * sizeof(AstFileString);
+        lists_at = symbols_at + uint64_t(header.symbol_count) * sizeof(uint32_t);
+        bytes_at = lists_at + uint64_t(header.list_count) * sizeof(uint32_t);
+        return header.string_bytes <= bytes.size() && bytes_at == bytes.size() - header.string_bytes
+            && header.checksum == payload_checksum(bytes.substr(sizeof(header)));
+    }
+
+    template <typename T>
+    T at(size_t section, size_t index) const {
+        T item;
+        std::memcpy(&item, bytes.data() + section + index * sizeof(T), sizeof(T));
+        return item;
+    }
+
+    bool string(uint32_t index, std::string_view& text) const {
+        if (index >= header.string_count) return false;
+        auto entry = at<AstFileString>(strings_at, index);
+        if (uint64_t(entry.offset) + entry.length > header.string_bytes) return false;
+        text = bytes.substr(bytes_at + entry.offset, entry.length);
+        return true;
+    }
+
+    // The count and first entry of a list; false if it runs off the pool
+    bool list(uint32_t offset, uint32_t& count, size_t& first) const {
+        if (offset >= header.list_count) return false;
+        count = at<uint32_t>(lists_at, offset);
+        first = size_t(offset) + 1;
+        return count <= header.list_count - first;
+    }
+};
+
+static bool valid_symbol(const AstFileReader& reader, uint32_t symbol) {
+    return symbol == NO_SYMBOL || symbol < reader.header.symbol_count;
+}
+
+// A node index may be absent, but otherwise has to come after its parent
+static bool valid_child(const AstFileReader& reader, uint32_t child, uint32_t parent) {
+    return child == NO_INDEX || (child > parent && child < reader.header.node_count);
+}
+
+// The parts the parser always fills in, which the code generators use
+// without checking
+static bool has_required_parts(const AstFileNode& record) {
+    switch (static_cast<NodeType>(record.type)) {
+        case NodeType::BinaryOp:
+            return record.left != NO_INDEX && record.right != NO_INDEX;
+        case NodeType::UnaryOp:
+            return record.left != NO_INDEX;
+        case NodeType::Assignment:
+            return record.right != NO_INDEX;
+        case NodeType::IfStatement:
+        case NodeType::WhileLoop:
+            return record.fields[0] != NO_INDEX && record.fields[1] != NO_INDEX;
+        case NodeType::ForLoop:
+            return std::all_of(std::begin(record.fields), std::end(record.fields),
+                               [](uint32_t field) { return field != NO_INDEX; });
+        case NodeType::VectorAlloc:
+        case NodeType::ArrayAccess:
+        case NodeType::FunctionDecl:
+        case NodeType::Return:
+            return record.fields[0] != NO_INDEX;
+        case NodeType::Print:
+            return record.left != NO_INDEX || record.value != NO_INDEX;
+        case NodeType::StringLiteral:
+            return record.value != NO_INDEX;
+        case NodeType::Identifier:
+        case NodeType::FunctionCall:
+        case NodeType::Import:
+            return record.symbol != NO_SYMBOL;
+        default:
+            return true;
+    }
+}
+
+static bool valid_node(const AstFileReader& reader, const AstFileNode& record, uint32_t index) {
+    std::string_view text;
+    if (record.type > static_cast<uint8_t>(NodeType::Import)) return false;
+    if (record.op >= TOKEN_TYPE_COUNT) return false;
+    if (!has_required_parts(record)) return false;
+    if (!valid_symbol(reader, record.symbol) || !valid_symbol(reader, record.name)) return false;
+    if (record.value != NO_INDEX && !reader.string(record.value, text)) return false;
+    if (record.var_type != NO_INDEX && !reader.string(record.var_type, text)) return false;
+    if (!valid_child(reader, record.left, index) || !valid_child(reader, record.right, index)) return false;
+    for (uint32_t field : record.fields) {
+        if (!valid_child(reader, field, index)) return false;
+    }
+
+    uint32_t count;
+    size_t first;
+    if (record.children != NO_INDEX) {
+        if (!reader.list(record.children, count, first)) return false;
+        for (size_t i = first; i < first + count; i++) {
+            uint32_t child = reader.at<uint32_t>(reader.lists_at, i);
+            if (child == NO_INDEX || !valid_child(reader, child, index)) return false;
+        }
+    }
+    if (record.parameters != NO_INDEX) {
+        if (!reader.list(record.parameters, count, first)) return false;
+        for (size_t i = first; i < first + count; i++) {
+            uint32_t symbol = reader.at<uint32_t>(reader.lists_at, i);
+            if (symbol == NO_SYMBOL || !valid_symbol(reader, symbol)) return false;
+        }
+    }
+    return true;
+}
+
+// A node of the recorded type, with only the scalars its constructor takes
+static ASTNode* make_node(AstArena& arena, const AstFileNode& record) {
+    switch (static_cast<NodeType>(record.type)) {
+        case NodeType::Literal:
+            return arena.make<LiteralNode>(record.literal);
+        case NodeType::BinaryOp:
+            return arena.make<BinaryOpNode>(static_cast<TokenType>(record.op));
+        case NodeType::UnaryOp:
+            return arena.make<UnaryOpNode>(static_cast<TokenType>(record.op));
+        case NodeType::Assignment:
+            return arena.make<AssignmentNode>(NO_SYMBOL);
+        case NodeType::IfStatement:
+            return arena.make<IfNode>();
+        case NodeType::WhileLoop:
+            return arena.make<WhileNode>();
+        case NodeType::ForLoop:
+            return arena.make<ForNode>();
+        case NodeType::VectorAlloc:
+            return arena.make<VectorAllocNode>();
+        case NodeType::ArrayAccess:
+            return arena.make<ArrayAccessNode>(NO_SYMBOL);
+        case NodeType::FunctionDecl:
+            return arena.make<FunctionDeclNode>(NO_SYMBOL);
+        case NodeType::Return:
+            return arena.make<ReturnNode>();
+        default:
+            return arena.make<ASTNode>(static_cast<NodeType>(record.type));
+    }
+}
+
+ASTNode* load_ast_file(const std::string& path, std::string_view source, SymbolTable& symbols,
+                       AstArena& arena) {
+    SourceFile file;
+    if (!file.open(path)) return nullptr;
+    AstFileReader reader{file.text(), {}};
+    if (!reader.open() || reader.header.node_count == 0 || reader.header.root != 0) return nullptr;
+
+    char key[sizeof(reader.header.key)] = {};
+    std::string expected = CompileCache::ast_key_for(source);
+    std::memcpy(key, expected.data(), std::min(expected.size(), sizeof(key)));
+    if (std::memcmp(key, reader.header.key, sizeof(key)) != 0) return nullptr;
+
+    // Check everything before touching symbols or arena, so a bad file leaves
+    // nothing behind for the parse that replaces it
+    for (uint32_t i = 0; i < reader.header.node_count; i++) {
+        if (!valid_node(reader, reader.at<AstFileNode>(reader.nodes_at, i), i)) return nullptr;
+    }
+    std::vector<std::string_view> names(reader.header.symbol_count);
+    for (uint32_t i = 0; i < reader.header.symbol_count; i++) {
+        if (!reader.string(reader.at<uint32_t>(reader.symbols_at, i), names[i])) return nullptr;
+    }
+
+    // The file's symbol ids are its compilation's; map them onto this one's
+    std::vector<Symbol> symbol_ids;
+    symbol_ids.reserve(names.size());
+    for (std::string_view name : names) {
+        symbol_ids.push_back(symbols.intern(name));
+    }
+    auto symbol_of = [&](uint32_t symbol) {
+        return symbol == NO_SYMBOL ? NO_SYMBOL : symbol_ids[symbol];
+    };
+
+    // Children come after their parents, so building from the back links
+    // each node to ones that already exist
+    std::vector<ASTNode*> nodes(reader.header.node_count);
+    auto node_at = [&](uint32_t index) {
+        return index == NO_INDEX ? nullptr : nodes[index];
+    };
+    for (uint32_t i = reader.header.node_count; i-- > 0;) {
+        auto record = reader.at<AstFileNode>(reader.nodes_at, i);
+        ASTNode* node = make_node(arena, record);
+        std::string_view text;
+
+        node->symbol = symbol_of(record.symbol);
+        if (Symbol* name = name_field(node)) *name = symbol_of(record.name);
+        if (record.value != NO_INDEX && reader.string(record.value, text)) {
+            node->value = std::string(text);
+        }
+        if (node->type == NodeType::Assignment && record.var_type != NO_INDEX && reader.string(record.var_type, text)) {
+            static_cast<AssignmentNode*>(node)->varType = std::string(text);
+        }
+
+        node->left = node_at(record.left);
+        node->right = node_at(record.right);
+        std::array<ASTNode**, 4> fields = named_children(node);
+        for (size_t f = 0; f < fields.size(); f++) {
+            if (fields[f]) *fields[f] = node_at(record.fields[f]);
+        }
+
+        uint32_t count;
+        size_t first;
+        if (record.children != NO_INDEX && reader.list(record.children, count, first)) {
+            node->children.reserve(count);
+            for (size_t c = first; c < first + count; c++) {
+                node->children.push_back(nodes[reader.at<uint32_t>(reader.lists_at, c)]);
+            }
+        }
+        if (node->type == NodeType::FunctionDecl && record.parameters != NO_INDEX
+                && reader.list(record.parameters, count, first)) {
+            auto& parameters = static_cast<FunctionDeclNode*>(node)->parameters;
+            for (size_t p = first; p < first + count; p++) {
+                parameters.push_back(symbol_ids[reader.at<uint32_t>(reader.lists_at, p)]);
+            }
+        }
+        nodes[i] = node;
+    }
+    return nodes[reader.header.root];
+}
@@ -0,0 +1,31 @@
+#ifndef AST_FILE_H
+#define AST_FILE_H
+
+#include <string>
+#include <string_view>
+#include "symbols.h"
+
+struct ASTNode;
+class AstArena;
+
+// Precompiled ASTs (.durast), kept next to a source so a compile of unchanged
+// code skips lexing and parsing. The file holds fixed-size node records that
+// refer to each other by index, a symbol table and a pool of strings, all
+// position independent, plus a key for the source text and compiler build it
+// was made from. It is read through a read-only mapping.
+
+// foo.dur -> foo.durast
+std::string ast_file_path(const std::string& source_path);
+
+// Write ast (parsed from source, with names in symbols) to path. Failures are
+// ignored: the file is only an accelerator.
+void write_ast_file(const std::string& path, const ASTNode* ast, const SymbolTable& symbols,
+                    std::string_view source);
+
+// The tree stored at path, with its nodes made in arena and its names interned
+// into symbols. Null if there is no file, or it was made from other source
+// text or by another compiler build, or it is malformed.
+ASTNode* load_ast_file(const std::string& path, std::string_view source, SymbolTable& symbols,
+                       AstArena& arena);
+
+#endif //AST_FILE_H
@@ -0,0 +1,136 @@
+#include "char_scan.h"
+#include <cstdint>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CHAR_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+// What a scan skips over
+enum class Run {
+    Whitespace,     // ' ', \t \n \v \f \r
+    Letters,        // A-Z a-z
+    NotQuote        // anything up to the next '"'
+};
+
+template <Run run>
+static bool continues(unsigned char c) {
+    switch (run) {
+        case Run::Whitespace: return c == ' ' || static_cast<unsigned char>(c - '\t') <= '\r' - '\t';
+        case Run::Letters: return static_cast<unsigned char>((c | 0x20) - 'a') <= 'z' - 'a';
+        default: return c != '"';
+    }
+}
+
+template <Run run>
+static size_t scan_scalar(const char* data, size_t pos, size_t size) {
+    while (pos < size && continues<run>(static_cast<unsigned char>(data[pos]))) pos++;
+    return pos;
+}
+
+#ifdef CHAR_SCAN_X86
+// Bytes are classified with wrapping subtraction and an unsigned saturating
+// range check: (c - low) <= span becomes subs(c - low, span) == 0.
+
+// Bit i set where byte i ends the run
+template <Run run>
+__attribute__((target("sse2")))
+static unsigned stop_mask_sse2(__m128i c) {
+    const __m128i zero = _mm_setzero_si128();
+    switch (run) {
+        case Run::Whitespace: {
+            __m128i space = _mm_cmpeq_epi8(c, _mm_set1_epi8(' '));
+            __m128i control = _mm_cmpeq_epi8(
+                _mm_subs_epu8(_mm_sub_epi8(c, _mm_set1_epi8('\t')), _mm_set1_epi8('\r' - '\t')), zero);
+            return ~static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(space, control))) & 0xFFFF;
+        }
+        case Run::Letters: {
+            __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+            __m128i letter = _mm_cmpeq_epi8(
+                _mm_subs_epu8(_mm_sub_epi8(lower, _mm_set1_epi8('a')), _mm_set1_epi8('z' - 'a')), zero);
+            return ~static_cast<unsigned>(_mm_movemask_epi8(letter)) & 0xFFFF;
+        }
+        default:
+            return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8('"'))));
+    }
+}
+
+template <Run run>
+__attribute__((target("sse2")))
+static size_t scan_sse2(const char* data, size_t pos, size_t size) {
+    for (; pos + 16 <= size; pos += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        if (unsigned stop = stop_mask_sse2<run>(block)) return pos + __builtin_ctz(stop);
+    }
+    return scan_scalar<run>(data, pos, size);
+}
+
+template <Run run>
+__attribute__((target("avx2")))
+static uint32_t stop_mask_avx2(__m256i c) {
+    const __m256i zero = _mm256_setzero_si256();
+    switch (run) {
+        case Run::Whitespace: {
+            __m256i space = _mm256_cmpeq_epi8(c, _mm256_set1_epi8(' '));
+            __m256i control = _mm256_cmpeq_epi8(
+                _mm256_subs_epu8(_mm256_sub_epi8(c, _mm256_set1_epi8('\t')), _mm256_set1_epi8('\r' - '\t')), zero);
+            return ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(space, control)));
+        }
+        case Run::Letters: {
+            __m256i lower = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+            __m256i letter = _mm256_cmpeq_epi8(
+                _mm256_subs_epu8(_mm256_sub_epi8(lower, _mm256_set1_epi8('a')), _mm256_set1_epi8('z' - 'a')), zero);
+            return ~static_cast<uint32_t>(_mm256_movemask_epi8(letter));
+        }
+        default:
+            return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('"'))));
+    }
+}
+
+template <Run run>
+__attribute__((target("avx2")))
+static size_t scan_avx2(const char* data, size_t pos, size_t size) {
+    for (; pos + 32 <= size; pos += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        if (uint32_t stop = stop_mask_avx2<run>(block)) return pos + __builtin_ctz(stop);
+    }
+    // The remainder still gets one 16-byte step
+    return scan_sse2<run>(data, pos, size);
+}
+#endif
+
+using ScanFunction = size_t (*)(const char*, size_t, size_t);
+
+struct Scanners {
+    ScanFunction whitespace;
+    ScanFunction letters;
+    ScanFunction quote;
+};
+
+// Chosen on first use; SSE2 is part of x86-64 so it is the floor there
+static const Scanners& scanners() {
+    static const Scanners chosen = [] {
+#ifdef CHAR_SCAN_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return Scanners{scan_avx2<Run::Whitespace>, scan_avx2<Run::Letters>, scan_avx2<Run::NotQuote>};
+        }
+        return Scanners{scan_sse2<Run::Whitespace>, scan_sse2<Run::Letters>, scan_sse2<Run::NotQuote>};
+#else
+        return Scanners{scan_scalar<Run::Whitespace>, scan_scalar<Run::Letters>, scan_scalar<Run::NotQuote>};
+#endif
+    }();
+    return chosen;
+}
+
+size_t skip_whitespace(const char* data, size_t pos, size_t size) {
+    return scanners().whitespace(data, pos, size);
+}
+
+size_t skip_letters(const char* data, size_t pos, size_t size) {
+    return scanners().letters(data, pos, size);
+}
+
+size_t find_quote(const char* data, size_t pos, size_t size) {
+    return scanners().quote(data, pos, size);
+}
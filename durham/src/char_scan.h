@@ -0,0 +1,18 @@
+#ifndef CHAR_SCAN_H
+#define CHAR_SCAN_H
+
+#include <cstddef>
+
+// Character-run scanning for the tokenizer. Each function returns the index of
+// the first byte at or after pos that ends the run, or size if the run reaches
+// the end. Classification matches std::isspace/std::isalpha in the C locale.
+//
+// On x86-64 these look at 32 bytes at a time with AVX2 or 16 with SSE2,
+// picked once by CPUID; elsewhere they fall back to a byte loop.
+size_t skip_whitespace(const char* data, size_t pos, size_t size);
+// End of a run of ASCII letters
+size_t skip_letters(const char* data, size_t pos, size_t size);
+// Next '"', or size if the string is unterminated
+size_t find_quote(const char* data, size_t pos, size_t size);
+
+#endif //CHAR_SCAN_H
@@ -0,0 +1,82 @@
+// durhamc: thin client for a running `durham --serve`. Takes the same
+// arguments as durham, has the server compile, and runs the result locally.
+#include "serve_protocol.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#ifndef _WIN32
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+int main(int argc, char** argv) {
+#ifdef _WIN32
+    std::cerr << "durhamc needs a POSIX system" << std::endl;
+    return EXIT_FAILURE;
+#else
+    std::string socket_path = default_socket_path();
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: Socket path too long: " << socket_path << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::strcpy(address.sun_path, socket_path.c_str());
+
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0 || connect(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        std::cerr << "Error: No durham server on " << socket_path << " (start one with durham --serve)" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // The reply names a program to run, so only a server run by this user
+    // may answer
+    if (!peer_is_current_user(server)) {
+        std::cerr << "Error: The durham server on " << socket_path << " belongs to another user" << std::endl;
+        close(server);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> request = {std::filesystem::current_path().string()};
+    for (int i = 1; i < argc; i++) {
+        request.push_back(argv[i]);
+    }
+
+    std::vector<std::string> reply;
+    if (!send_strings(server, request) || !receive_strings(server, reply) || reply.size() != 4) {
+        std::cerr << "Error: Lost connection to the durham server" << std::endl;
+        close(server);
+        return EXIT_FAILURE;
+    }
+    close(server);
+
+    std::cout << reply[1] << std::flush;
+    std::cerr << reply[2] << std::flush;
+    if (reply[3].empty()) {
+        return std::atoi(reply[0].c_str());
+    }
+
+    // Run the program here so it gets this terminal. No shell: the path holds
+    // the client's directory, which may contain anything.
+    std::string program = reply[3];
+    char* program_argv[] = {program.data(), nullptr};
+    pid_t child;
+    int error = posix_spawn(&child, program.c_str(), nullptr, nullptr, program_argv, environ);
+    if (error != 0) {
+        std::cerr << "Error: Could not run " << program << ": " << std::strerror(error) << std::endl;
+        return EXIT_FAILURE;
+    }
+    int status = 0;
+    while (waitpid(child, &status, 0) < 0) {
+        if (errno != EINTR) return EXIT_FAILURE;
+    }
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
+#endif
+}
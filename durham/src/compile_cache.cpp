@@ -0,0 +1,196 @@
+#include "compile_cache.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef DURHAM_VERSION
+#define DURHAM_VERSION "dev"
+#endif
+
+// 64-bit FNV-1a
+static uint64_t fnv1a(std::string_view bytes, uint64_t hash = 0xcbf29ce484222325ULL) {
+    for (unsigned char c : bytes) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Identifies the compiler that produced an entry. The version alone misses
+// rebuilds during development, so the size and mtime of the running binary
+// are mixed in where they can be found.
+static const std::string& compiler_identity() {
+    static const std::string identity = []() {
+        std::string id = DURHAM_VERSION;
+#ifdef __linux__
+        struct stat info;
+        if (stat("/proc/self/exe", &info) == 0) {
+            id += "-" + std::to_string(info.st_size) + "-" + std::to_string(info.st_mtime);
+        }
+#endif
+        return id;
+    }();
+    return identity;
+}
+
+std::string CompileCache::key_for(std::string_view source, const Options& options, ModuleKind kind) {
+    uint64_t hash = fnv1a(compiler_identity());
+    hash = fnv1a(options.target == Target::Win64 ? "|win64|" : "|linux-x86_64|", hash);
+    if (options.backend == Backend::Ir) hash = fnv1a("ir|", hash);
+    if (kind == ModuleKind::Library) hash = fnv1a("library|", hash);
+    hash = fnv1a(source, hash);
+
+    char key[40];
+    std::snprintf(key, sizeof(key), "%016llx-%zx", static_cast<unsigned long long>(hash), source.size());
+    return key;
+}
+
+std::string CompileCache::ast_key_for(std::string_view source) {
+    uint64_t hash = fnv1a(compiler_identity());
+    hash = fnv1a("|ast|", hash);
+    hash = fnv1a(source, hash);
+
+    char key[40];
+    std::snprintf(key, sizeof(key), "%016llx-%zx", static_cast<unsigned long long>(hash), source.size());
+    return key;
+}
+
+std::string default_cache_directory() {
+    if (const char* directory = std::getenv("DURHAM_CACHE_DIR")) {
+        return directory;
+    }
+    if (const char* cache_home = std::getenv("XDG_CACHE_HOME")) {
+        return (std::filesystem::path(cache_home) / "durham").string();
+    }
+    if (const char* home = std::getenv("HOME")) {
+        return (std::filesystem::path(home) / ".cache" / "durham").string();
+    }
+    return "";
+}
+
+CompileCache::CompileCache(const std::string& directory, size_t capacity)
+    : directory(directory), capacity(capacity) {
+    if (this->directory.empty()) return;
+    std::error_code error;
+    std::filesystem::create_directories(this->directory, error);
+    if (error) {
+        this->directory.clear();    // no disk cache, but compiles still work
+    }
+}
+
+std::shared_ptr<const CachedModule> CompileCache::find(const std::string& key) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = modules.find(key);
+        if (it != modules.end()) return it->second;
+    }
+    std::shared_ptr<CachedModule> module = load(key);
+    if (module) remember(key, module);
+    return module;
+}
+
+void CompileCache::store(const std::string& key, std::shared_ptr<const CachedModule> module) {
+    save(key, *module);
+    remember(key, std::move(module));
+}
+
+void CompileCache::remember(const std::string& key, std::shared_ptr<const CachedModule> module) {
+    std::lock_guard<std::mutex> lock(mutex);
+    bool inserted = modules.insert_or_assign(key, std::move(module)).second;
+    if (!inserted) return;
+
+    insertion_order.push_back(key);
+    while (modules.size() > capacity) {
+        modules.erase(insertion_order.front());
+        insertion_order.pop_front();
+    }
+}
+
+static bool read_file(const std::filesystem::path& path, std::string& contents) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
+void write_file_atomically(const std::string& path, std::string_view contents) {
+    static std::atomic<unsigned> counter{0};
+    std::filesystem::path temporary = path;
+#ifdef _WIN32
+    temporary += ".tmp" + std::to_string(counter++);
+#else
+    temporary += ".tmp" + std::to_string(getpid()) + "-" + std::to_string(counter++);
+#endif
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return;
+        file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        if (!file) {
+            file.close();
+            std::filesystem::remove(temporary);
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) std::filesystem::remove(temporary, error);
+}
+
+// key.asm holds the listing; key.o the assembled program when there is one,
+// and key.imports the names of the modules it imports, one per line
+std::shared_ptr<CachedModule> CompileCache::load(const std::string& key) const {
+    if (directory.empty()) return nullptr;
+    std::filesystem::path base = std::filesystem::path(directory) / key;
+
+    auto module = std::make_shared<CachedModule>();
+    std::string imports;
+    if (read_file(std::filesystem::path(base).replace_extension(".imports"), imports)) {
+        std::istringstream lines(imports);
+        for (std::string name; std::getline(lines, name);) {
+            module->imports.push_back(name);
+        }
+    }
+    if (!read_file(std::filesystem::path(base).replace_extension(".asm"), module->assembly)) {
+        return nullptr;
+    }
+    std::string object_bytes;
+    ObjectCode object;
+    if (read_file(std::filesystem::path(base).replace_extension(".o"), object_bytes)
+            && deserialize_object(object_bytes, object)) {
+        module->object = std::move(object);
+    }
+    return module;
+}
+
+void CompileCache::save(const std::string& key, const CachedModule& module) const {
+    if (directory.empty()) return;
+    std::filesystem::path base = std::filesystem::path(directory) / key;
+
+    // The listing goes last: a reader that finds key.asm may look for the rest
+    if (!module.imports.empty()) {
+        std::string imports;
+        for (const auto& name : module.imports) {
+            imports += name + "\n";
+        }
+        write_file_atomically(std::filesystem::path(base).replace_extension(".imports").string(), imports);
+    }
+    if (module.object) {
+        write_file_atomically(std::filesystem::path(base).replace_extension(".o").string(), serialize_object(*module.object));
+    }
+    std::filesystem::path assembly = std::filesystem::path(base).replace_extension(".asm");
+    std::error_code error;
+    if (!std::filesystem::exists(assembly, error)) {
+        write_file_atomically(assembly.string(), module.assembly);
+    }
+}
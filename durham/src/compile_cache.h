@@ -0,0 +1,60 @@
+#ifndef COMPILE_CACHE_H
+#define COMPILE_CACHE_H
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "assembler.h"
+#include "main.h"
+
+// Everything the pipeline produces for one source text, so a repeat compile
+// can skip tokenizing, parsing, code generation and (once done) assembly
+struct CachedModule {
+    std::string assembly;
+    std::optional<ObjectCode> object;   // assembled lazily, linux-x86_64 only
+    std::vector<std::string> imports;   // names of the modules it imports
+};
+
+// Module cache keyed by source content. Entries live in memory (shared by the
+// requests of a compile server) and, when a directory is given, on disk so
+// separate compiler runs reuse each other's work.
+class CompileCache {
+    public:
+        explicit CompileCache(const std::string& directory = "", size_t capacity = 256);
+
+        // Hash of the source, the compiler build and the options that affect
+        // the generated code
+        static std::string key_for(std::string_view source, const Options& options,
+                                   ModuleKind kind = ModuleKind::Program);
+        // Hash of the source and the compiler build only: what its AST
+        // depends on
+        static std::string ast_key_for(std::string_view source);
+
+        std::shared_ptr<const CachedModule> find(const std::string& key);
+        void store(const std::string& key, std::shared_ptr<const CachedModule> module);
+
+    private:
+        std::shared_ptr<CachedModule> load(const std::string& key) const;
+        void save(const std::string& key, const CachedModule& module) const;
+        void remember(const std::string& key, std::shared_ptr<const CachedModule> module);
+
+        std::string directory;      // empty: memory only
+        size_t capacity;
+        std::mutex mutex;
+        std::unordered_map<std::string, std::shared_ptr<const CachedModule>> modules;
+        std::deque<std::string> insertion_order;    // oldest entry is evicted first
+};
+
+// Write to a private temporary name and rename over path, so readers in other
+// processes see either nothing or a complete file. Failures are ignored.
+void write_file_atomically(const std::string& path, std::string_view contents);
+
+// $DURHAM_CACHE_DIR, else $XDG_CACHE_HOME/durham, else ~/.cache/durham
+std::string default_cache_directory();
+
+#endif //COMPILE_CACHE_H
@@ -0,0 +1,87 @@
+#include "elf_writer.h"
+#include <fstream>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+// The first PT_LOAD maps the file from offset 0 (headers + text) here
+static const uint64_t IMAGE_BASE = ELF_TEXT_ADDRESS - 0x1000;
+
+static void put(std::vector<uint8_t>& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+static void put_program_header(std::vector<uint8_t>& out, uint32_t type, uint32_t flags,
+                               uint64_t offset, uint64_t address,
+                               uint64_t file_size, uint64_t memory_size) {
+    put(out, type, 4);
+    put(out, flags, 4);
+    put(out, offset, 8);
+    put(out, address, 8);           // p_vaddr
+    put(out, address, 8);           // p_paddr
+    put(out, file_size, 8);
+    put(out, memory_size, 8);
+    put(out, 0x1000, 8);            // p_align
+}
+
+std::vector<uint8_t> build_elf_executable(const LinkedImage& image, uint64_t entry) {
+    const uint32_t PT_LOAD = 1;
+    const uint32_t PT_GNU_STACK = 0x6474e551;
+    const uint32_t PF_X = 1, PF_W = 2, PF_R = 4;
+
+    bool has_data = !image.data.empty() || image.bss_size > 0;
+    uint16_t header_count = has_data ? 3 : 2;
+
+    // ELF header, starting from e_ident (constructed rather than inserted
+    // into an empty vector, which GCC 12 misreports as an overflow)
+    const uint8_t ident[16] = {0x7F, 'E', 'L', 'F', 2 /*64-bit*/, 1 /*LE*/, 1 /*version*/, 0 /*SysV*/};
+    std::vector<uint8_t> out(ident, ident + sizeof(ident));
+    put(out, 2, 2);                 // e_type: ET_EXEC
+    put(out, 0x3E, 2);              // e_machine: x86-64
+    put(out, 1, 4);                 // e_version
+    put(out, entry, 8);
+    put(out, 64, 8);                // e_phoff
+    put(out, 0, 8);                 // e_shoff
+    put(out, 0, 4);                 // e_flags
+    put(out, 64, 2);                // e_ehsize
+    put(out, 56, 2);                // e_phentsize
+    put(out, header_count, 2);
+    put(out, 64, 2);                // e_shentsize
+    put(out, 0, 2);                 // e_shnum
+    put(out, 0, 2);                 // e_shstrndx
+
+    // Headers and text share the first, read/execute segment
+    uint64_t text_end = (image.text_address - IMAGE_BASE) + image.text.size();
+    put_program_header(out, PT_LOAD, PF_R | PF_X, 0, IMAGE_BASE, text_end, text_end);
+
+    // Data and bss: file offsets mirror addresses so pages line up
+    uint64_t data_offset = image.data_address - IMAGE_BASE;
+    if (has_data) {
+        put_program_header(out, PT_LOAD, PF_R | PF_W, data_offset, image.data_address,
+                           image.data.size(), image.data.size() + image.bss_size);
+    }
+    put_program_header(out, PT_GNU_STACK, PF_R | PF_W, 0, 0, 0, 0);
+
+    out.resize(image.text_address - IMAGE_BASE, 0);
+    out.insert(out.end(), image.text.begin(), image.text.end());
+    if (has_data) {
+        out.resize(data_offset, 0);
+        out.insert(out.end(), image.data.begin(), image.data.end());
+    }
+    return out;
+}
+
+bool write_executable(const std::string& path, const std::vector<uint8_t>& bytes) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    file.close();
+    if (!file) return false;
+#ifndef _WIN32
+    chmod(path.c_str(), 0755);
+#endif
+    return true;
+}
@@ -0,0 +1,20 @@
+#ifndef ELF_WRITER_H
+#define ELF_WRITER_H
+
+#include "assembler.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Address link_objects must place the text at for build_elf_executable: the
+// first page of the file holds the ELF and program headers.
+constexpr uint64_t ELF_TEXT_ADDRESS = 0x401000;
+
+// Static x86-64 Linux executable (no interpreter, no section headers) for an
+// image linked at ELF_TEXT_ADDRESS
+std::vector<uint8_t> build_elf_executable(const LinkedImage& image, uint64_t entry);
+
+// Write an executable image to disk and mark it executable
+bool write_executable(const std::string& path, const std::vector<uint8_t>& bytes);
+
+#endif //ELF_WRITER_H
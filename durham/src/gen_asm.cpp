@@ -1,993 +1,232 @@
 #include "main.h"
 #include "gen_asm.h"
+#include <algorithm>
+
+// Frame offset of each variable, indexed by Symbol; 0 until it is assigned
+using VarOffsets = std::vector<int>;
 
 // Forward declarations for AST-based code generation
-void generate_node(std::shared_ptr<ASTNode> node, 
+void generate_node(ASTNode* node, 
                    std::stringstream& asm_code,
-                   std::map<std::string, int>& var_offsets,
+                   VarOffsets& var_offsets,
                    int& stack_offset,
                    int& label_counter);
 
-void generate_expression(std::shared_ptr<ASTNode> node,
+void generate_expression(ASTNode* node,
                         std::stringstream& asm_code,
-                        std::map<std::string, int>& var_offsets);
+                        VarOffsets& var_offsets);
 
-void generate_condition(std::shared_ptr<ASTNode> node,
+void generate_condition(ASTNode* node,
                        std::stringstream& asm_code,
-                       std::map<std::string, int>& var_offsets,
+                       VarOffsets& var_offsets,
                        int label,
                        const std::string& label_prefix = "while");
 
-// Helper function to check if an expression is a string type
-bool is_string_expression(std::shared_ptr<ASTNode> node, const std::map<std::string, std::string>& string_vars);
+static void generate_scratch(ASTNode* node, int k,
+                             std::stringstream& asm_code,
+                             VarOffsets& var_offsets);
 
 // Helper function to generate string concatenation
-void generate_string_concat(std::shared_ptr<ASTNode> left, std::shared_ptr<ASTNode> right,
+void generate_string_concat(ASTNode* left, ASTNode* right,
                            std::stringstream& asm_code,
-                           std::map<std::string, int>& var_offsets,
-                           const std::map<std::string, std::string>& string_vars,
+                           VarOffsets& var_offsets,
+                           const std::vector<bool>& string_vars,
                            const std::map<std::string, int>& string_lits);
 
-// Helper function to convert decimal string to integer
-// Now that we use decimal (not base-17), this is just a wrapper around stoi
-int base17_to_decimal(const std::string& decimal_str) {
-    return std::stoi(decimal_str);
-}
-
 // Helper function to generate unique labels
-static int label_counter = 0;
+// Code generation state is per thread so batch compiles can run in parallel
+static thread_local int label_counter = 0;
 std::string generate_label(const std::string& prefix) {
     return prefix + std::to_string(label_counter++);
 }
 
-// Helper function to evaluate a condition and generate comparison code at runtime (token-based)
-std::string generate_condition_from_tokens(const std::vector<Token>& condition_tokens, 
-                                           const std::map<std::string, int>& scalars,
-                                           std::stringstream& assembly_code) {
-    // Handle compound conditions with OR: cond1 or cond2
-    // For OR: if either condition is true, don't jump (continue)
-    if (condition_tokens.size() == 7 && condition_tokens[3].type == TokenType::_or) {
-        std::string or_success = generate_label("or_success_");
-        
-        // Evaluate first condition (tokens 0-2)
-        if (condition_tokens[0].type == TokenType::int_lit) {
-            int left_val = base17_to_decimal(condition_tokens[0].value.value());
-            assembly_code << "    mov rax, " << left_val << "\n";
-        } else if (condition_tokens[0].type == TokenType::identifier) {
-            std::string var_name = condition_tokens[0].value.value();
-            if (scalars.find(var_name) != scalars.end()) {
-                int offset = scalars.at(var_name);
-                assembly_code << "    mov rax, [rbp" << offset << "]\n";
-            }
-        }
-        
-        if (condition_tokens[2].type == TokenType::int_lit) {
-            int right_val = base17_to_decimal(condition_tokens[2].value.value());
-            assembly_code << "    mov rbx, " << right_val << "\n";
-        } else if (condition_tokens[2].type == TokenType::identifier) {
-            std::string var_name = condition_tokens[2].value.value();
-            if (scalars.find(var_name) != scalars.end()) {
-                int offset = scalars.at(var_name);
-                assembly_code << "    mov rbx, [rbp" << offset << "]\n";
-            }
-        }
-        
-        assembly_code << "    cmp rax, rbx\n";
-        
-        // If first condition is true, jump to success (don't skip body)
-        if (condition_tokens[1].type == TokenType::_equals) {
-            assembly_code << "    je " << or_success << "\n";
-        } else if (condition_tokens[1].type == TokenType::_greater) {
-            assembly_code << "    jg " << or_success << "\n";
-        } else if (condition_tokens[1].type == TokenType::_lesser) {
-            assembly_code << "    jl " << or_success << "\n";
-        }
-        
-        // Evaluate second condition (tokens 4-6)
-        if (condition_tokens[4].type == TokenType::int_lit) {
-            int left_val = base17_to_decimal(condition_tokens[4].value.value());
-            assembly_code << "    mov rax, " << left_val << "\n";
-        } else if (condition_tokens[4].type == TokenType::identifier) {
-            std::string var_name = condition_tokens[4].value.value();
-            if (scalars.find(var_name) != scalars.end()) {
-                int offset = scalars.at(var_name);
-                assembly_code << "    mov rax, [rbp" << offset << "]\n";
-            }
-        }
-        
-        if (condition_tokens[6].type == TokenType::int_lit) {
-            int right_val = base17_to_decimal(condition_tokens[6].value.value());
-            assembly_code << "    mov rbx, " << right_val << "\n";
-        } else if (condition_tokens[6].type == TokenType::identifier) {
-            std::string var_name = condition_tokens[6].value.value();
-            if (scalars.find(var_name) != scalars.end()) {
-                int offset = scalars.at(var_name);
-                assembly_code << "    mov rbx, [rbp" << offset << "]\n";
-            }
-        }
-        
-        assembly_code << "    cmp rax, rbx\n";
-        
-        // Return jump instruction for second condition (if false, skip body)
-        std::string jump_instr;
-        if (condition_tokens[5].type == TokenType::_equals) {
-            jump_instr = "jne";
-        } else if (condition_tokens[5].type == TokenType::_greater) {
-            jump_instr = "jle";
-        } else if (condition_tokens[5].type == TokenType::_lesser) {
-            jump_instr = "jge";
-        }
-        
-        assembly_code << or_success << ":\n";
-        return jump_instr;
+// Add this new function at the top after the includes
+// Helper to collect string literals from AST
+static thread_local std::map<std::string, int> string_literals;
+static thread_local int string_counter = 0;
+static thread_local std::vector<bool> string_variables; // by Symbol: declared as text
+static thread_local std::vector<bool> called_functions; // by Symbol
+
+// Names of the symbols in the AST being generated
+static thread_local const SymbolTable* symbol_table = nullptr;
+
+static std::string symbol_name(Symbol symbol) {
+    return std::string(symbol_table->name(symbol));
+}
+
+// ABI selected for the current generate_assembly_from_ast call
+static thread_local Target target_abi = Target::Win64;
+
+const std::vector<std::string>& argument_registers(Target target) {
+    static const std::vector<std::string> win64 = {"rcx", "rdx", "r8", "r9"};
+    static const std::vector<std::string> sysv = {"rdi", "rsi", "rdx", "rcx", "r8", "r9"};
+    return target == Target::LinuxX86_64 ? sysv : win64;
+}
+
+int shadow_space_size(Target target) {
+    return target == Target::Win64 ? 32 : 0;
+}
+
+static const std::vector<std::string>& arg_registers() {
+    return argument_registers(target_abi);
+}
+
+static int shadow_space() {
+    return shadow_space_size(target_abi);
+}
+
+// Scratch registers for expression temporaries, handed out in order by
+// generate_scratch. All are caller-saved and none is used by the code around
+// an expression (register arguments are only popped into place right before
+// a call), so only the ones in use across a call have to be saved.
+static const char* const SCRATCH_REGISTERS[] = {"r10", "r11", "r8", "r9"};
+static constexpr int SCRATCH_COUNT = 4;
+
+// Runtime thunk around putchar: realigns rsp to 16 bytes (and reserves shadow
+// space on Win64) so call sites don't have to track their own push depth.
+// The character is passed in the first argument register.
+static void emit_putchar_thunk(std::stringstream& asm_code) {
+    asm_code << "durham_putchar:\n";
+    asm_code << "    push rbp\n";
+    asm_code << "    mov rbp, rsp\n";
+    asm_code << "    and rsp, -16\n";
+    if (shadow_space() > 0) {
+        asm_code << "    sub rsp, " << shadow_space() << "\n";
     }
-    // Handle simple comparisons: var1 > var2, var1 < var2, etc.
-    else if (condition_tokens.size() == 3) {
-        // Load left operand into rax
-        if (condition_tokens[0].type == TokenType::int_lit) {
-            int left_val = base17_to_decimal(condition_tokens[0].value.value());
-            assembly_code << "    mov rax, " << left_val << "\n";
-        } else if (condition_tokens[0].type == TokenType::identifier) {
-            std::string var_name = condition_tokens[0].value.value();
-            if (scalars.find(var_name) != scalars.end()) {
-                int offset = scalars.at(var_name);
-                assembly_code << "    mov rax, [rbp" << offset << "]\n";
-            } else {
-                assembly_code << "    mov rax, 0  ; undefined variable\n";
-            }
-        }
-        
-        // Load right operand into rbx
-        if (condition_tokens[2].type == TokenType::int_lit) {
-            int right_val = base17_to_decimal(condition_tokens[2].value.value());
-            assembly_code << "    mov rbx, " << right_val << "\n";
-        } else if (condition_tokens[2].type == TokenType::identifier) {
-            std::string var_name = condition_tokens[2].value.value();
-            if (scalars.find(var_name) != scalars.end()) {
-                int offset = scalars.at(var_name);
-                assembly_code << "    mov rbx, [rbp" << offset << "]\n";
-            } else {
-                assembly_code << "    mov rbx, 0  ; undefined variable\n";
-            }
-        }
-        
-        assembly_code << "    cmp rax, rbx\n";
-        
-        // Return the jump instruction based on operator
-        if (condition_tokens[1].type == TokenType::_greater) {
-            return "jle";  // Jump if less or equal (opposite of >)
-        } else if (condition_tokens[1].type == TokenType::_lesser) {
-            return "jge";  // Jump if greater or equal (opposite of <)
-        } else if (condition_tokens[1].type == TokenType::_equals) {
-            return "jne";  // Jump if not equal
-        } else if (condition_tokens[1].type == TokenType::_not_equals) {
-            return "je";   // Jump if equal (opposite of !=)
-        }
+    if (target_abi == Target::LinuxX86_64) {
+        asm_code << "    call putchar wrt ..plt\n";
+    } else {
+        asm_code << "    call putchar\n";
     }
-    return "jmp";  // Default: unconditional jump
+    asm_code << "    mov rsp, rbp\n";
+    asm_code << "    pop rbp\n";
+    asm_code << "    ret\n\n";
 }
 
-std::string generate_assembly(const std::vector<Token>& tokens) {
-    std::stringstream assembly_code; 
-    
-    std::map<std::string, int> variables;  // For vectors (stores offset to size)
-    std::map<std::string, int> scalars;    // For scalar variables (stores stack offset)
-    int stack_offset = 0;
+std::string generate_runtime_asm(Target target) {
+    if (target != Target::LinuxX86_64) {
+        throw std::runtime_error("Freestanding runtime is only available for linux-x86_64");
+    }
+    std::stringstream asm_code;
+    asm_code << "section .bss\n";
+    asm_code << "    durham_out_buffer resb 4096\n";
+    asm_code << "    durham_out_length resq 1\n\n";
+    asm_code << "section .text\n";
+    asm_code << "    global _start\n";
+    asm_code << "    global putchar\n\n";
 
-    assembly_code << "section .data\n";
-    assembly_code << "    digit db '0', 10\n";
-    assembly_code << "    array times 1000 dq 0\n\n";
-    assembly_code << "section .bss\n";
-    assembly_code << "    temp_buffer resb 32\n\n";
-    assembly_code << "section .text\n";
-    assembly_code << "    global main\n";
-    assembly_code << "    extern putchar\n\n";
-    assembly_code << "main:\n";
-    assembly_code << "    push rbp\n";
-    assembly_code << "    mov rbp, rsp\n";
-    assembly_code << "    sub rsp, 1024\n\n";
+    // Process entry: run main, flush stdout, exit with main's result
+    asm_code << "_start:\n";
+    asm_code << "    xor ebp, ebp\n";
+    asm_code << "    and rsp, -16\n";
+    asm_code << "    call main\n";
+    asm_code << "    mov rbx, rax\n";
+    asm_code << "    call durham_flush\n";
+    asm_code << "    mov rdi, rbx\n";
+    asm_code << "    mov eax, 60\n";     // exit
+    asm_code << "    syscall\n\n";
 
-    for (size_t i = 0; i < tokens.size(); i++) {
-        // Handle vector assignment: name = (num, num, num);
-        if (i + 2 < tokens.size() &&
-            tokens[i].type == TokenType::identifier &&
-            tokens[i + 1].type == TokenType::equals &&
-            tokens[i + 2].type == TokenType::open_paren) {
-            
-            std::string var_name = tokens[i].value.value();
-            i += 3; // Skip name, =, (
-            
-            std::vector<int> numbers;
-            
-            // Collect numbers
-            while (i < tokens.size() && tokens[i].type != TokenType::close_paren) {
-                if (tokens[i].type == TokenType::int_lit) {
-                    numbers.push_back(base17_to_decimal(tokens[i].value.value()));
-                }
-                i++;
-            }
-            
-            // Allocate stack space
-            stack_offset -= 8;
-            variables[var_name] = stack_offset;
-            
-            assembly_code << "    ; Variable '" << var_name << "' size=" << numbers.size() << " at [rbp" << stack_offset << "]\n";
-            assembly_code << "    mov qword [rbp" << stack_offset << "], " << numbers.size() << "\n";
-            
-            for (size_t j = 0; j < numbers.size(); j++) {
-                stack_offset -= 8;
-                assembly_code << "    mov qword [rbp" << stack_offset << "], " << numbers[j] << "\n";
-            }
-            assembly_code << "\n";
-        }
-        // Handle scalar assignment with expression: name = var1 op var2 (CHECK THIS FIRST before simple assignment)
-        else if (i + 4 < tokens.size() &&
-                 tokens[i].type == TokenType::identifier &&
-                 tokens[i + 1].type == TokenType::equals &&
-                 (tokens[i + 3].type == TokenType::_durham ||
-                  tokens[i + 3].type == TokenType::_newcastle ||
-                  tokens[i + 3].type == TokenType::_york ||
-                  tokens[i + 3].type == TokenType::_edinburgh)) {
-            
-            std::string var_name = tokens[i].value.value();
-            
-            // Allocate stack space if variable doesn't exist
-            if (scalars.find(var_name) == scalars.end()) {
-                stack_offset -= 8;
-                scalars[var_name] = stack_offset;
-            }
-            
-            // Load left operand
-            if (tokens[i + 2].type == TokenType::int_lit) {
-                int left_val = base17_to_decimal(tokens[i + 2].value.value());
-                assembly_code << "    mov rax, " << left_val << "\n";
-            } else if (tokens[i + 2].type == TokenType::identifier) {
-                std::string left_var = tokens[i + 2].value.value();
-                if (scalars.find(left_var) != scalars.end()) {
-                    assembly_code << "    mov rax, [rbp" << scalars[left_var] << "]\n";
-                }
-            }
-            
-            // Load right operand
-            if (tokens[i + 4].type == TokenType::int_lit) {
-                int right_val = base17_to_decimal(tokens[i + 4].value.value());
-                assembly_code << "    mov rbx, " << right_val << "\n";
-            } else if (tokens[i + 4].type == TokenType::identifier) {
-                std::string right_var = tokens[i + 4].value.value();
-                if (scalars.find(right_var) != scalars.end()) {
-                    assembly_code << "    mov rbx, [rbp" << scalars[right_var] << "]\n";
-                }
-            }
-            
-            // Perform operation
-            if (tokens[i + 3].type == TokenType::_durham) {
-                assembly_code << "    add rax, rbx\n";
-            } else if (tokens[i + 3].type == TokenType::_newcastle) {
-                assembly_code << "    sub rax, rbx\n";
-            } else if (tokens[i + 3].type == TokenType::_york) {
-                assembly_code << "    imul rax, rbx\n";
-            } else if (tokens[i + 3].type == TokenType::_edinburgh) {
-                assembly_code << "    xor rdx, rdx\n";
-                assembly_code << "    idiv rbx\n";
-            }
-            
-            int offset = scalars[var_name];
-            assembly_code << "    mov [rbp" << offset << "], rax\n\n";
-            
-            i += 4; // Skip name, =, var1, op, var2
-        }
-        // Handle scalar assignment: name = number; (only if followed by semicolon or end)
-        else if (i + 2 < tokens.size() &&
-                 tokens[i].type == TokenType::identifier &&
-                 tokens[i + 1].type == TokenType::equals &&
-                 tokens[i + 2].type == TokenType::int_lit &&
-                 (i + 3 >= tokens.size() || 
-                  tokens[i + 3].type == TokenType::semi ||
-                  tokens[i + 3].type == TokenType::close_paren ||
-                  tokens[i + 3].type == TokenType::close_brace)) {
-            
-            std::string var_name = tokens[i].value.value();
-            int value = base17_to_decimal(tokens[i + 2].value.value());
-            
-            // Allocate stack space if variable doesn't exist
-            if (scalars.find(var_name) == scalars.end()) {
-                stack_offset -= 8;
-                scalars[var_name] = stack_offset;
-            }
-            
-            int offset = scalars[var_name];
-            assembly_code << "    ; Scalar variable '" << var_name << "' = " << value << "\n";
-            assembly_code << "    mov qword [rbp" << offset << "], " << value << "\n\n";
-            
-            i += 2; // Skip name, =, number (semicolon handled by main loop)
-        }
-        // Handle while loop: while begin condition end front body back
-        else if (tokens[i].type == TokenType::_while &&
-                 i + 2 < tokens.size() &&
-                 tokens[i + 1].type == TokenType::open_paren) {
-            
-            std::string loop_start = generate_label("while_start_");
-            std::string loop_end = generate_label("while_end_");
-            
-            i += 2; // Skip 'while' and 'begin'
-            
-            // Collect condition tokens
-            std::vector<Token> condition_tokens;
-            while (i < tokens.size() && tokens[i].type != TokenType::close_paren) {
-                condition_tokens.push_back(tokens[i]);
-                i++;
-            }
-            i++; // Skip 'end'
-            
-            if (i < tokens.size() && tokens[i].type == TokenType::open_brace) {
-                i++; // Skip 'front'
-                
-                assembly_code << loop_start << ":\n";
-                
-                // Generate condition check
-                std::string jump_instr = generate_condition_from_tokens(condition_tokens, scalars, assembly_code);
-                assembly_code << "    " << jump_instr << " " << loop_end << "\n\n";
-                
-                // Process loop body - collect body tokens and recursively process
-                std::vector<Token> body_tokens;
-                int brace_depth = 1;
-                while (i < tokens.size() && brace_depth > 0) {
-                    if (tokens[i].type == TokenType::open_brace) brace_depth++;
-                    if (tokens[i].type == TokenType::close_brace) {
-                        brace_depth--;
-                        if (brace_depth == 0) break;
-                    }
-                    body_tokens.push_back(tokens[i]);
-                    i++;
-                }
-                
-                // Process body tokens inline
-                for (size_t j = 0; j < body_tokens.size(); j++) {
-                    // Handle scalar assignment in loop
-                    if (j + 2 < body_tokens.size() &&
-                        body_tokens[j].type == TokenType::identifier &&
-                        body_tokens[j + 1].type == TokenType::equals &&
-                        body_tokens[j + 2].type == TokenType::int_lit) {
-                        
-                        std::string var_name = body_tokens[j].value.value();
-                        int value = base17_to_decimal(body_tokens[j + 2].value.value());
-                        
-                        if (scalars.find(var_name) != scalars.end()) {
-                            int offset = scalars[var_name];
-                            assembly_code << "    mov qword [rbp" << offset << "], " << value << "\n";
-                        }
-                        j += 2;
-                    }
-                    // Handle expressions in loop
-                    else if (j + 4 < body_tokens.size() &&
-                             body_tokens[j].type == TokenType::identifier &&
-                             body_tokens[j + 1].type == TokenType::equals &&
-                             (body_tokens[j + 3].type == TokenType::_durham ||
-                              body_tokens[j + 3].type == TokenType::_newcastle)) {
-                        
-                        std::string var_name = body_tokens[j].value.value();
-                        
-                        // Load left operand
-                        if (body_tokens[j + 2].type == TokenType::identifier) {
-                            std::string left_var = body_tokens[j + 2].value.value();
-                            if (scalars.find(left_var) != scalars.end()) {
-                                assembly_code << "    mov rax, [rbp" << scalars[left_var] << "]\n";
-                            }
-                        } else if (body_tokens[j + 2].type == TokenType::int_lit) {
-                            int val = base17_to_decimal(body_tokens[j + 2].value.value());
-                            assembly_code << "    mov rax, " << val << "\n";
-                        }
-                        
-                        // Load right operand
-                        if (body_tokens[j + 4].type == TokenType::identifier) {
-                            std::string right_var = body_tokens[j + 4].value.value();
-                            if (scalars.find(right_var) != scalars.end()) {
-                                assembly_code << "    mov rbx, [rbp" << scalars[right_var] << "]\n";
-                            }
-                        } else if (body_tokens[j + 4].type == TokenType::int_lit) {
-                            int val = base17_to_decimal(body_tokens[j + 4].value.value());
-                            assembly_code << "    mov rbx, " << val << "\n";
-                        }
-                        
-                        // Perform operation
-                        if (body_tokens[j + 3].type == TokenType::_durham) {
-                            assembly_code << "    add rax, rbx\n";
-                        } else if (body_tokens[j + 3].type == TokenType::_newcastle) {
-                            assembly_code << "    sub rax, rbx\n";
-                        }
-                        
-                        if (scalars.find(var_name) != scalars.end()) {
-                            int offset = scalars[var_name];
-                            assembly_code << "    mov [rbp" << offset << "], rax\n";
-                        }
-                        j += 4;
-                    }
-                    // Handle tlc() in loop
-                    else if (j + 3 < body_tokens.size() &&
-                             body_tokens[j].type == TokenType::_tlc &&
-                             body_tokens[j + 1].type == TokenType::open_paren &&
-                             body_tokens[j + 2].type == TokenType::identifier &&
-                             body_tokens[j + 3].type == TokenType::close_paren) {
-                        
-                        std::string var_name = body_tokens[j + 2].value.value();
-                        if (scalars.find(var_name) != scalars.end()) {
-                            int offset = scalars[var_name];
-                            assembly_code << "    ; Print variable " << var_name << "\n";
-                            assembly_code << "    mov rax, [rbp" << offset << "]\n";
-                            
-                            // Special case for zero
-                            assembly_code << "    test rax, rax\n";
-                            assembly_code << "    jnz .not_zero_" << label_counter << "\n";
-                            assembly_code << "    mov rcx, '0'\n";
-                            assembly_code << "    call putchar\n";
-                            assembly_code << "    jmp .done_print_" << label_counter << "\n";
-                            assembly_code << ".not_zero_" << label_counter << ":\n";
-                            
-                            // Convert to string and print (store in buffer)
-                            assembly_code << "    lea r13, [rel temp_buffer]\n";
-                            assembly_code << "    mov rbx, 10\n";
-                            assembly_code << "    xor r12, r12\n";
-                            assembly_code << ".digit_loop_" << label_counter << ":\n";
-                            assembly_code << "    xor rdx, rdx\n";
-                            assembly_code << "    div rbx\n";
-                            assembly_code << "    add dl, '0'\n";
-                            assembly_code << "    mov [r13 + r12], dl\n";
-                            assembly_code << "    inc r12\n";
-                            assembly_code << "    test rax, rax\n";
-                            assembly_code << "    jnz .digit_loop_" << label_counter << "\n";
-                            assembly_code << ".print_loop_" << label_counter << ":\n";
-                            assembly_code << "    dec r12\n";
-                            assembly_code << "    movzx rcx, byte [r13 + r12]\n";
-                            assembly_code << "    call putchar\n";
-                            assembly_code << "    test r12, r12\n";
-                            assembly_code << "    jnz .print_loop_" << label_counter << "\n";
-                            assembly_code << ".done_print_" << label_counter << ":\n";
-                            assembly_code << "    mov rcx, 10\n";
-                            assembly_code << "    call putchar\n";
-                            label_counter++;
-                        }
-                        j += 3;
-                    }
-                }
-                
-                assembly_code << "    jmp " << loop_start << "\n";
-                assembly_code << loop_end << ":\n\n";
-            }
-        }
-        // Handle if statement: if begin condition end front body back
-        else if (tokens[i].type == TokenType::_if &&
-                 i + 2 < tokens.size() &&
-                 tokens[i + 1].type == TokenType::open_paren) {
-            
-            std::string if_end = generate_label("if_end_");
-            
-            i += 2; // Skip 'if' and 'begin'
-            
-            // Collect condition tokens
-            std::vector<Token> condition_tokens;
-            while (i < tokens.size() && tokens[i].type != TokenType::close_paren) {
-                condition_tokens.push_back(tokens[i]);
-                i++;
-            }
-            i++; // Skip 'end'
-            
-            if (i < tokens.size() && tokens[i].type == TokenType::open_brace) {
-                i++; // Skip 'front'
-                
-                // Generate condition check
-                std::string jump_instr = generate_condition_from_tokens(condition_tokens, scalars, assembly_code);
-                assembly_code << "    " << jump_instr << " " << if_end << "\n\n";
-                
-                // Process if body - collect body tokens
-                std::vector<Token> body_tokens;
-                int brace_depth = 1;
-                while (i < tokens.size() && brace_depth > 0) {
-                    if (tokens[i].type == TokenType::open_brace) brace_depth++;
-                    if (tokens[i].type == TokenType::close_brace) {
-                        brace_depth--;
-                        if (brace_depth == 0) break;
-                    }
-                    body_tokens.push_back(tokens[i]);
-                    i++;
-                }
-                
-                // Process body tokens inline
-                for (size_t j = 0; j < body_tokens.size(); j++) {
-                    // Handle scalar assignment in if body
-                    if (j + 2 < body_tokens.size() &&
-                        body_tokens[j].type == TokenType::identifier &&
-                        body_tokens[j + 1].type == TokenType::equals &&
-                        body_tokens[j + 2].type == TokenType::int_lit) {
-                        
-                        std::string var_name = body_tokens[j].value.value();
-                        int value = base17_to_decimal(body_tokens[j + 2].value.value());
-                        
-                        if (scalars.find(var_name) != scalars.end()) {
-                            int offset = scalars[var_name];
-                            assembly_code << "    mov qword [rbp" << offset << "], " << value << "\n";
-                        }
-                        j += 2;
-                    }
-                    // Handle tlc() in if body
-                    else if (j + 3 < body_tokens.size() &&
-                             body_tokens[j].type == TokenType::_tlc &&
-                             body_tokens[j + 1].type == TokenType::open_paren &&
-                             body_tokens[j + 2].type == TokenType::identifier &&
-                             body_tokens[j + 3].type == TokenType::close_paren) {
-                        
-                        std::string var_name = body_tokens[j + 2].value.value();
-                        if (scalars.find(var_name) != scalars.end()) {
-                            int offset = scalars[var_name];
-                            assembly_code << "    ; Print variable " << var_name << "\n";
-                            assembly_code << "    mov rax, [rbp" << offset << "]\n";
-                            
-                            // Special case for zero
-                            assembly_code << "    test rax, rax\n";
-                            assembly_code << "    jnz .not_zero_" << label_counter << "\n";
-                            assembly_code << "    mov rcx, '0'\n";
-                            assembly_code << "    call putchar\n";
-                            assembly_code << "    jmp .done_print_" << label_counter << "\n";
-                            assembly_code << ".not_zero_" << label_counter << ":\n";
-                            
-                            // Convert to string and print (store in buffer)
-                            assembly_code << "    lea r13, [rel temp_buffer]\n";
-                            assembly_code << "    mov rbx, 10\n";
-                            assembly_code << "    xor r12, r12\n";
-                            assembly_code << ".digit_loop_" << label_counter << ":\n";
-                            assembly_code << "    xor rdx, rdx\n";
-                            assembly_code << "    div rbx\n";
-                            assembly_code << "    add dl, '0'\n";
-                            assembly_code << "    mov [r13 + r12], dl\n";
-                            assembly_code << "    inc r12\n";
-                            assembly_code << "    test rax, rax\n";
-                            assembly_code << "    jnz .digit_loop_" << label_counter << "\n";
-                            assembly_code << ".print_loop_" << label_counter << ":\n";
-                            assembly_code << "    dec r12\n";
-                            assembly_code << "    movzx rcx, byte [r13 + r12]\n";
-                            assembly_code << "    call putchar\n";
-                            assembly_code << "    test r12, r12\n";
-                            assembly_code << "    jnz .print_loop_" << label_counter << "\n";
-                            assembly_code << ".done_print_" << label_counter << ":\n";
-                            assembly_code << "    mov rcx, 10\n";
-                            assembly_code << "    call putchar\n";
-                            label_counter++;
-                        }
-                        j += 3;
-                    }
-                }
-                
-                assembly_code << if_end << ":\n\n";
-            }
-        }
-        // Handle for loop: for begin init. condition. increment end front body back
-        else if (tokens[i].type == TokenType::_for &&
-                 i + 2 < tokens.size() &&
-                 tokens[i + 1].type == TokenType::open_paren) {
-            
-            std::string loop_start = generate_label("for_start_");
-            std::string loop_end = generate_label("for_end_");
-            
-            i += 2; // Skip 'for' and 'begin'
-            
-            // Parse initialization (until first semicolon)
-            std::vector<Token> init_tokens;
-            while (i < tokens.size() && tokens[i].type != TokenType::semi) {
-                init_tokens.push_back(tokens[i]);
-                i++;
-            }
-            i++; // Skip semicolon
-            
-            // Parse condition (until second semicolon)
-            std::vector<Token> condition_tokens;
-            while (i < tokens.size() && tokens[i].type != TokenType::semi) {
-                condition_tokens.push_back(tokens[i]);
-                i++;
-            }
-            i++; // Skip semicolon
-            
-            // Parse increment (until 'end')
-            std::vector<Token> increment_tokens;
-            while (i < tokens.size() && tokens[i].type != TokenType::close_paren) {
-                increment_tokens.push_back(tokens[i]);
-                i++;
-            }
-            i++; // Skip 'end'
-            
-            // Process initialization
-            if (init_tokens.size() >= 3 &&
-                init_tokens[0].type == TokenType::identifier &&
-                init_tokens[1].type == TokenType::equals &&
-                init_tokens[2].type == TokenType::int_lit) {
-                
-                std::string var_name = init_tokens[0].value.value();
-                int value = base17_to_decimal(init_tokens[2].value.value());
-                
-                if (scalars.find(var_name) == scalars.end()) {
-                    stack_offset -= 8;
-                    scalars[var_name] = stack_offset;
-                }
-                
-                int offset = scalars[var_name];
-                assembly_code << "    ; Initialize " << var_name << " = " << value << "\n";
-                assembly_code << "    mov qword [rbp" << offset << "], " << value << "\n\n";
-            }
-            
-            if (i < tokens.size() && tokens[i].type == TokenType::open_brace) {
-                i++; // Skip 'front'
-                
-                assembly_code << loop_start << ":\n";
-                
-                // Generate condition check
-                std::string jump_instr = generate_condition_from_tokens(condition_tokens, scalars, assembly_code);
-                assembly_code << "    " << jump_instr << " " << loop_end << "\n\n";
-                
-                // Process loop body - collect body tokens
-                std::vector<Token> body_tokens;
-                int brace_depth = 1;
-                while (i < tokens.size() && brace_depth > 0) {
-                    if (tokens[i].type == TokenType::open_brace) brace_depth++;
-                    if (tokens[i].type == TokenType::close_brace) {
-                        brace_depth--;
-                        if (brace_depth == 0) break;
-                    }
-                    body_tokens.push_back(tokens[i]);
-                    i++;
-                }
-                
-                // Process body tokens (similar to while loop)
-                for (size_t j = 0; j < body_tokens.size(); j++) {
-                    // Handle if statement in for loop body
-                    if (body_tokens[j].type == TokenType::_if &&
-                        j + 2 < body_tokens.size() &&
-                        body_tokens[j + 1].type == TokenType::open_paren) {
-                        
-                        std::string if_end = generate_label("if_end_");
-                        
-                        j += 2; // Skip 'if' and 'begin'
-                        
-                        // Collect condition tokens
-                        std::vector<Token> if_condition_tokens;
-                        while (j < body_tokens.size() && body_tokens[j].type != TokenType::close_paren) {
-                            if_condition_tokens.push_back(body_tokens[j]);
-                            j++;
-                        }
-                        j++; // Skip 'end'
-                        
-                        if (j < body_tokens.size() && body_tokens[j].type == TokenType::open_brace) {
-                            j++; // Skip 'front'
-                            
-                            // Generate condition check
-                            std::string jump_instr = generate_condition_from_tokens(if_condition_tokens, scalars, assembly_code);
-                            assembly_code << "    " << jump_instr << " " << if_end << "\n\n";
-                            
-                            // Collect if body tokens
-                            std::vector<Token> if_body_tokens;
-                            int if_brace_depth = 1;
-                            while (j < body_tokens.size() && if_brace_depth > 0) {
-                                if (body_tokens[j].type == TokenType::open_brace) if_brace_depth++;
-                                if (body_tokens[j].type == TokenType::close_brace) {
-                                    if_brace_depth--;
-                                    if (if_brace_depth == 0) break;
-                                }
-                                if_body_tokens.push_back(body_tokens[j]);
-                                j++;
-                            }
-                            
-                            // Process if body (handle tlc statements)
-                            for (size_t k = 0; k < if_body_tokens.size(); k++) {
-                                if (k + 3 < if_body_tokens.size() &&
-                                    if_body_tokens[k].type == TokenType::_tlc &&
-                                    if_body_tokens[k + 1].type == TokenType::open_paren &&
-                                    if_body_tokens[k + 2].type == TokenType::identifier &&
-                                    if_body_tokens[k + 3].type == TokenType::close_paren) {
-                                    
-                                    std::string var_name = if_body_tokens[k + 2].value.value();
-                                    if (scalars.find(var_name) != scalars.end()) {
-                                        int offset = scalars[var_name];
-                                        assembly_code << "    ; Print variable " << var_name << "\n";
-                                        assembly_code << "    mov rax, [rbp" << offset << "]\n";
-                                        
-                                        // Special case for zero
-                                        assembly_code << "    test rax, rax\n";
-                                        assembly_code << "    jnz .not_zero_" << label_counter << "\n";
-                                        assembly_code << "    mov rcx, '0'\n";
-                                        assembly_code << "    call putchar\n";
-                                        assembly_code << "    jmp .done_print_" << label_counter << "\n";
-                                        assembly_code << ".not_zero_" << label_counter << ":\n";
-                                        
-                                        // Convert to string and print (store in buffer)
-                                        assembly_code << "    lea r13, [rel temp_buffer]\n";
-                                        assembly_code << "    mov rbx, 10\n";
-                                        assembly_code << "    xor r12, r12\n";
-                                        assembly_code << ".digit_loop_" << label_counter << ":\n";
-                                        assembly_code << "    xor rdx, rdx\n";
-                                        assembly_code << "    div rbx\n";
-                                        assembly_code << "    add dl, '0'\n";
-                                        assembly_code << "    mov [r13 + r12], dl\n";
-                                        assembly_code << "    inc r12\n";
-                                        assembly_code << "    test rax, rax\n";
-                                        assembly_code << "    jnz .digit_loop_" << label_counter << "\n";
-                                        assembly_code << ".print_loop_" << label_counter << ":\n";
-                                        assembly_code << "    dec r12\n";
-                                        assembly_code << "    movzx rcx, byte [r13 + r12]\n";
-                                        assembly_code << "    call putchar\n";
-                                        assembly_code << "    test r12, r12\n";
-                                        assembly_code << "    jnz .print_loop_" << label_counter << "\n";
-                                        assembly_code << ".done_print_" << label_counter << ":\n";
-                                        assembly_code << "    mov rcx, 10\n";
-                                        assembly_code << "    call putchar\n";
-                                        label_counter++;
-                                    }
-                                    k += 3;
-                                }
-                            }
-                            
-                            assembly_code << if_end << ":\n";
-                        }
-                    }
-                    // Handle tlc() in loop
-                    else if (j + 3 < body_tokens.size() &&
-                        body_tokens[j].type == TokenType::_tlc &&
-                        body_tokens[j + 1].type == TokenType::open_paren &&
-                        body_tokens[j + 2].type == TokenType::identifier &&
-                        body_tokens[j + 3].type == TokenType::close_paren) {
-                        
-                        std::string var_name = body_tokens[j + 2].value.value();
-                        if (scalars.find(var_name) != scalars.end()) {
-                            int offset = scalars[var_name];
-                            assembly_code << "    ; Print variable " << var_name << "\n";
-                            assembly_code << "    mov rax, [rbp" << offset << "]\n";
-                            
-                            // Special case for zero
-                            assembly_code << "    test rax, rax\n";
-                            assembly_code << "    jnz .not_zero_" << label_counter << "\n";
-                            assembly_code << "    mov rcx, '0'\n";
-                            assembly_code << "    call putchar\n";
-                            assembly_code << "    jmp .done_print_" << label_counter << "\n";
-                            assembly_code << ".not_zero_" << label_counter << ":\n";
-                            
-                            // Convert to string and print (store in buffer to avoid stack issues)
-                            assembly_code << "    lea r13, [rel temp_buffer]\n";
-                            assembly_code << "    mov rbx, 10\n";
-                            assembly_code << "    xor r12, r12\n";
-                            assembly_code << ".digit_loop_" << label_counter << ":\n";
-                            assembly_code << "    xor rdx, rdx\n";
-                            assembly_code << "    div rbx\n";
-                            assembly_code << "    add dl, '0'\n";
-                            assembly_code << "    mov [r13 + r12], dl\n";
-                            assembly_code << "    inc r12\n";
-                            assembly_code << "    test rax, rax\n";
-                            assembly_code << "    jnz .digit_loop_" << label_counter << "\n";
-                            assembly_code << ".print_loop_" << label_counter << ":\n";
-                            assembly_code << "    dec r12\n";
-                            assembly_code << "    movzx rcx, byte [r13 + r12]\n";
-                            assembly_code << "    call putchar\n";
-                            assembly_code << "    test r12, r12\n";
-                            assembly_code << "    jnz .print_loop_" << label_counter << "\n";
-                            assembly_code << ".done_print_" << label_counter << ":\n";
-                            assembly_code << "    mov rcx, 10\n";
-                            assembly_code << "    call putchar\n";
-                            label_counter++;
-                        }
-                        j += 3;
-                    }
-                }
-                
-                // Process increment
-                if (increment_tokens.size() >= 5 &&
-                    increment_tokens[0].type == TokenType::identifier &&
-                    increment_tokens[1].type == TokenType::equals &&
-                    (increment_tokens[3].type == TokenType::_durham ||
-                     increment_tokens[3].type == TokenType::_newcastle)) {
-                    
-                    std::string var_name = increment_tokens[0].value.value();
-                    
-                    // Load left operand
-                    if (increment_tokens[2].type == TokenType::identifier) {
-                        std::string left_var = increment_tokens[2].value.value();
-                        if (scalars.find(left_var) != scalars.end()) {
-                            assembly_code << "    mov rax, [rbp" << scalars[left_var] << "]\n";
-                        }
-                    }
-                    
-                    // Load right operand
-                    if (increment_tokens[4].type == TokenType::int_lit) {
-                        int val = base17_to_decimal(increment_tokens[4].value.value());
-                        assembly_code << "    mov rbx, " << val << "\n";
-                    }
-                    
-                    // Perform operation
-                    if (increment_tokens[3].type == TokenType::_durham) {
-                        assembly_code << "    add rax, rbx\n";
-                    } else if (increment_tokens[3].type == TokenType::_newcastle) {
-                        assembly_code << "    sub rax, rbx\n";
-                    }
-                    
-                    if (scalars.find(var_name) != scalars.end()) {
-                        int offset = scalars[var_name];
-                        assembly_code << "    mov [rbp" << offset << "], rax\n";
-                    }
-                }
-                
-                assembly_code << "    jmp " << loop_start << "\n";
-                assembly_code << loop_end << ":\n\n";
-            }
-        }
-        // Handle tlc(identifier) for vectors
-        else if (i + 3 < tokens.size() &&
-                 tokens[i].type == TokenType::_tlc &&
-                 tokens[i + 1].type == TokenType::open_paren &&
-                 tokens[i + 2].type == TokenType::identifier &&
-                 tokens[i + 3].type == TokenType::close_paren) {
-            
-            std::string var_name = tokens[i + 2].value.value();
-            
-            // Check if it's a vector
-            if (variables.find(var_name) != variables.end()) {
-                int var_offset = variables[var_name];
-                
-                assembly_code << "    ; Print vector '" << var_name << "'\n";
-                assembly_code << "    mov r10, [rbp" << var_offset << "]  ; load size\n";
-                assembly_code << "    lea r11, [rbp" << (var_offset - 8) << "]  ; array start\n";
-                
-                // Print '('
-                assembly_code << "    mov rcx, 40\n";
-                assembly_code << "    call putchar\n";
-                
-                // Print elements
-                assembly_code << "    xor r12, r12\n";
-                assembly_code << ".print_loop_" << var_name << ":\n";
-                assembly_code << "    cmp r12, r10\n";
-                assembly_code << "    jge .print_done_" << var_name << "\n";
-                
-                assembly_code << "    mov rax, [r11 + r12*8]\n";
-                assembly_code << "    add rax, 48\n";
-                assembly_code << "    mov rcx, rax\n";
-                assembly_code << "    call putchar\n";
-                
-                assembly_code << "    inc r12\n";
-                assembly_code << "    cmp r12, r10\n";
-                assembly_code << "    jge .print_done_" << var_name << "\n";
-                assembly_code << "    mov rcx, 44\n";
-                assembly_code << "    call putchar\n";
-                assembly_code << "    jmp .print_loop_" << var_name << "\n";
-                
-                assembly_code << ".print_done_" << var_name << ":\n";
-                assembly_code << "    mov rcx, 41\n";
-                assembly_code << "    call putchar\n";
-                assembly_code << "    mov rcx, 10\n";
-                assembly_code << "    call putchar\n\n";
-            }
-            // Check if it's a scalar
-            else if (scalars.find(var_name) != scalars.end()) {
-                int offset = scalars[var_name];
-                
-                assembly_code << "    ; Print scalar '" << var_name << "'\n";
-                assembly_code << "    mov rax, [rbp" << offset << "]\n";
-                
-                // Special case for zero
-                assembly_code << "    test rax, rax\n";
-                assembly_code << "    jnz .not_zero_" << label_counter << "\n";
-                assembly_code << "    mov rcx, '0'\n";
-                assembly_code << "    call putchar\n";
-                assembly_code << "    jmp .done_print_" << label_counter << "\n";
-                assembly_code << ".not_zero_" << label_counter << ":\n";
-                
-                // Convert number to string and print (store in buffer)
-                assembly_code << "    lea r13, [rel temp_buffer]\n";
-                assembly_code << "    mov rbx, 10\n";
-                assembly_code << "    xor r12, r12\n";
-                assembly_code << ".digit_loop_" << label_counter << ":\n";
-                assembly_code << "    xor rdx, rdx\n";
-                assembly_code << "    div rbx\n";
-                assembly_code << "    add dl, '0'\n";
-                assembly_code << "    mov [r13 + r12], dl\n";
-                assembly_code << "    inc r12\n";
-                assembly_code << "    test rax, rax\n";
-                assembly_code << "    jnz .digit_loop_" << label_counter << "\n";
-                assembly_code << ".print_loop_" << label_counter << ":\n";
-                assembly_code << "    dec r12\n";
-                assembly_code << "    movzx rcx, byte [r13 + r12]\n";
-                assembly_code << "    call putchar\n";
-                assembly_code << "    test r12, r12\n";
-                assembly_code << "    jnz .print_loop_" << label_counter << "\n";
-                assembly_code << ".done_print_" << label_counter << ":\n";
-                assembly_code << "    mov rcx, 10\n";
-                assembly_code << "    call putchar\n\n";
-                label_counter++;
-            }
-            else {
-                std::cerr << "Error: Variable '" << var_name << "' not defined" << std::endl;
-            }
-            
-            i += 3; // Skip tlc, (, identifier, )
-        }
-        // Handle tlc(expression) for direct calculations
-        else if (tokens[i].type == TokenType::_tlc && 
-                 i + 1 < tokens.size() &&
-                 tokens[i + 1].type == TokenType::open_paren) {
-            
-            i += 2; // Skip tlc and (
-            
-            std::vector<Token> expr_tokens;
-            while (i < tokens.size() && tokens[i].type != TokenType::close_paren) {
-                expr_tokens.push_back(tokens[i]);
-                i++;
-            }
-            
-            // Evaluate expression
-            if (expr_tokens.size() == 3 &&
-                expr_tokens[0].type == TokenType::int_lit &&
-                expr_tokens[2].type == TokenType::int_lit) {
-                
-                int left = base17_to_decimal(expr_tokens[0].value.value());
-                int right = base17_to_decimal(expr_tokens[2].value.value());
-                int result = 0;
-                
-                if (expr_tokens[1].type == TokenType::_durham) {
-                    result = left + right;  // +
-                } else if (expr_tokens[1].type == TokenType::_newcastle) {
-                    result = left - right;  // -
-                } else if (expr_tokens[1].type == TokenType::_york) {
-                    result = left * right;  // *
-                } else if (expr_tokens[1].type == TokenType::_edinburgh) {
-                    result = left / right;  // /
-                }
-                
-                std::string result_str = std::to_string(result);
-                for (char digit_char : result_str) {
-                    assembly_code << "    mov rcx, " << static_cast<int>(digit_char) << "\n";
-                    assembly_code << "    call putchar\n";
-                }
-                assembly_code << "    mov rcx, 10\n";
-                assembly_code << "    call putchar\n\n";
-                
-            } else if (expr_tokens.size() == 1 && expr_tokens[0].type == TokenType::int_lit) {
-                // Convert base-17 string to decimal
-                int decimal_value = base17_to_decimal(expr_tokens[0].value.value());
-                
-                // Print decimal value
-                std::string result_str = std::to_string(decimal_value);
-                for (char digit_char : result_str) {
-                    assembly_code << "    mov rcx, " << static_cast<int>(digit_char) << "\n";
-                    assembly_code << "    call putchar\n";
-                }
-                assembly_code << "    mov rcx, 10\n";
-                assembly_code << "    call putchar\n\n";
-            }
-        }
-    }
+    // int putchar(int c): append to the stdout buffer, flushing when full
+    asm_code << "putchar:\n";
+    asm_code << "    mov rax, [rel durham_out_length]\n";
+    asm_code << "    lea rdx, [rel durham_out_buffer]\n";
+    asm_code << "    mov [rdx + rax], dil\n";
+    asm_code << "    inc rax\n";
+    asm_code << "    mov [rel durham_out_length], rax\n";
+    asm_code << "    cmp rax, 4096\n";
+    asm_code << "    jb .done\n";
+    asm_code << "    push rdi\n";
+    asm_code << "    call durham_flush\n";
+    asm_code << "    pop rdi\n";
+    asm_code << ".done:\n";
+    asm_code << "    movzx rax, dil\n";
+    asm_code << "    ret\n\n";
 
-    assembly_code << "    xor rax, rax\n";
-    assembly_code << "    add rsp, 1024\n";
-    assembly_code << "    pop rbp\n";
-    assembly_code << "    ret\n";
+    // write(1, buffer, length), retrying short writes
+    asm_code << "durham_flush:\n";
+    asm_code << "    lea rsi, [rel durham_out_buffer]\n";
+    asm_code << "    mov rdx, [rel durham_out_length]\n";
+    asm_code << ".write_loop:\n";
+    asm_code << "    test rdx, rdx\n";
+    asm_code << "    jz .flushed\n";
+    asm_code << "    mov edi, 1\n";
+    asm_code << "    mov eax, 1\n";      // write
+    asm_code << "    syscall\n";
+    asm_code << "    test rax, rax\n";
+    asm_code << "    jle .flushed\n";
+    asm_code << "    add rsi, rax\n";
+    asm_code << "    sub rdx, rax\n";
+    asm_code << "    jmp .write_loop\n";
+    asm_code << ".flushed:\n";
+    asm_code << "    mov qword [rel durham_out_length], 0\n";
+    asm_code << "    ret\n";
+    return asm_code.str();
+}
 
-    return assembly_code.str(); 
+// Print the NUL-terminated string addressed by rbx, followed by a newline
+static void emit_print_string(std::stringstream& asm_code, int label) {
+    const std::string& arg = arg_registers()[0];
+    asm_code << ".print_str_" << label << ":\n";
+    asm_code << "    movzx " << arg << ", byte [rbx]\n";
+    asm_code << "    test " << arg << ", " << arg << "\n";
+    asm_code << "    jz .done_str_" << label << "\n";
+    asm_code << "    call durham_putchar\n";
+    asm_code << "    inc rbx\n";
+    asm_code << "    jmp .print_str_" << label << "\n";
+    asm_code << ".done_str_" << label << ":\n";
+    asm_code << "    mov " << arg << ", 10\n";  // Print newline
+    asm_code << "    call durham_putchar\n";
 }
 
-// Add this new function at the top after the includes
-// Helper to collect string literals from AST
-static std::map<std::string, int> string_literals;
-static int string_counter = 0;
-static std::map<std::string, std::string> string_variables; // varname -> string label
+// Print the value in rax as an unsigned decimal, followed by a newline
+static void emit_print_number(std::stringstream& asm_code, int label) {
+    const std::string& arg = arg_registers()[0];
+    asm_code << "    ; Print value in rax\n";
+    asm_code << "    test rax, rax\n";
+    asm_code << "    jnz .not_zero_" << label << "\n";
+    asm_code << "    mov " << arg << ", '0'\n";
+    asm_code << "    call durham_putchar\n";
+    asm_code << "    jmp .done_print_" << label << "\n";
+    asm_code << ".not_zero_" << label << ":\n";
+    asm_code << "    mov rbx, 10\n";
+    asm_code << "    xor r12, r12\n";
+    asm_code << "    lea r13, [rel temp_buffer]\n";
+    asm_code << ".digit_loop_" << label << ":\n";
+    asm_code << "    xor rdx, rdx\n";
+    asm_code << "    div rbx\n";
+    asm_code << "    add dl, '0'\n";
+    asm_code << "    mov [r13 + r12], dl\n";
+    asm_code << "    inc r12\n";
+    asm_code << "    test rax, rax\n";
+    asm_code << "    jnz .digit_loop_" << label << "\n";
+    asm_code << ".print_loop_" << label << ":\n";
+    asm_code << "    dec r12\n";
+    asm_code << "    movzx " << arg << ", byte [r13 + r12]\n";
+    asm_code << "    call durham_putchar\n";
+    asm_code << "    test r12, r12\n";
+    asm_code << "    jnz .print_loop_" << label << "\n";
+    asm_code << ".done_print_" << label << ":\n";
+    asm_code << "    mov " << arg << ", 10\n";
+    asm_code << "    call durham_putchar\n";
+}
 
 // Helper function to check if an expression is a string type
-bool is_string_expression(std::shared_ptr<ASTNode> node, const std::map<std::string, std::string>& string_vars) {
+bool is_string_expression(ASTNode* node, const std::vector<bool>& string_vars) {
     if (!node) return false;
     
     if (node->type == NodeType::StringLiteral) return true;
     
     if (node->type == NodeType::Identifier) {
-        std::string var_name = node->value.value();
-        return string_vars.find(var_name) != string_vars.end();
+        return string_vars[node->symbol];
     }
     
     if (node->type == NodeType::BinaryOp) {
-        auto binOp = std::static_pointer_cast<BinaryOpNode>(node);
-        if (binOp->op == TokenType::_durham) {
-            return is_string_expression(binOp->left, string_vars) || 
-                   is_string_expression(binOp->right, string_vars);
+        // Down the left of a chain of durhams without recursing
+        auto binOp = static_cast<BinaryOpNode*>(node);
+        while (binOp->op == TokenType::_durham) {
+            if (is_string_expression(binOp->right, string_vars)) return true;
+            if (binOp->left->type != NodeType::BinaryOp) return is_string_expression(binOp->left, string_vars);
+            binOp = static_cast<BinaryOpNode*>(binOp->left);
         }
     }
     
@@ -996,12 +235,12 @@ bool is_string_expression(std::shared_ptr<ASTNode> node, const std::map<std::str
 
 // Helper function to generate string concatenation
 // This allocates heap memory for the concatenated result
-void generate_string_concat(std::shared_ptr<ASTNode> left, std::shared_ptr<ASTNode> right,
+void generate_string_concat(ASTNode* left, ASTNode* right,
                            std::stringstream& asm_code,
-                           std::map<std::string, int>& var_offsets,
-                           const std::map<std::string, std::string>& string_vars,
+                           VarOffsets& var_offsets,
+                           const std::vector<bool>& string_vars,
                            const std::map<std::string, int>& string_lits) {
-    static int concat_counter = 0;
+    static thread_local int concat_counter = 0;
     int current_concat = concat_counter++;
     
     asm_code << "    ; String concatenation\n";
@@ -1012,11 +251,10 @@ void generate_string_concat(std::shared_ptr<ASTNode> left, std::shared_ptr<ASTNo
         int str_id = string_lits.at(str);
         asm_code << "    lea r12, [rel str_" << str_id << "]\n";
     } else if (left->type == NodeType::Identifier) {
-        std::string var_name = left->value.value();
-        asm_code << "    mov r12, [rbp-" << var_offsets.at(var_name) << "]\n";
+        asm_code << "    mov r12, [rbp-" << var_offsets[left->symbol] << "]\n";
     } else if (left->type == NodeType::BinaryOp) {
         // Recursively handle nested concatenation
-        auto leftBinOp = std::static_pointer_cast<BinaryOpNode>(left);
+        auto leftBinOp = static_cast<BinaryOpNode*>(left);
         if (leftBinOp->op == TokenType::_durham) {
             generate_string_concat(leftBinOp->left, leftBinOp->right, asm_code, 
                                  var_offsets, string_vars, string_lits);
@@ -1030,11 +268,10 @@ void generate_string_concat(std::shared_ptr<ASTNode> left, std::shared_ptr<ASTNo
         int str_id = string_lits.at(str);
         asm_code << "    lea r13, [rel str_" << str_id << "]\n";
     } else if (right->type == NodeType::Identifier) {
-        std::string var_name = right->value.value();
-        asm_code << "    mov r13, [rbp-" << var_offsets.at(var_name) << "]\n";
+        asm_code << "    mov r13, [rbp-" << var_offsets[right->symbol] << "]\n";
     } else if (right->type == NodeType::BinaryOp) {
         // Recursively handle nested concatenation
-        auto rightBinOp = std::static_pointer_cast<BinaryOpNode>(right);
+        auto rightBinOp = static_cast<BinaryOpNode*>(right);
         if (rightBinOp->op == TokenType::_durham) {
             generate_string_concat(rightBinOp->left, rightBinOp->right, asm_code, 
                                  var_offsets, string_vars, string_lits);
@@ -1104,70 +341,111 @@ void generate_string_concat(std::shared_ptr<ASTNode> left, std::shared_ptr<ASTNo
     asm_code << "    mov rax, r14\n";
 }
 
-void collect_strings(std::shared_ptr<ASTNode> node) {
-    if (!node) return;
+// String literals and called functions, anywhere in the AST
+void collect_references(ASTNode* node) {
+    // Operator chains lean left, so the left child is visited by looping
+    for (; node; node = node->left) {
     
-    if (node->type == NodeType::Print && node->value.has_value()) {
-        // This is a string print
-        std::string str = node->value.value();
-        if (string_literals.find(str) == string_literals.end()) {
-            string_literals[str] = string_counter++;
+        if (node->type == NodeType::Print && node->value.has_value()) {
+            // This is a string print
+            std::string str = node->value.value();
+            if (string_literals.find(str) == string_literals.end()) {
+                string_literals[str] = string_counter++;
+            }
         }
-    }
     
-    // Collect string literals from StringLiteral nodes
-    if (node->type == NodeType::StringLiteral && node->value.has_value()) {
-        std::string str = node->value.value();
-        if (string_literals.find(str) == string_literals.end()) {
-            string_literals[str] = string_counter++;
+        // Collect string literals from StringLiteral nodes
+        if (node->type == NodeType::StringLiteral && node->value.has_value()) {
+            std::string str = node->value.value();
+            if (string_literals.find(str) == string_literals.end()) {
+                string_literals[str] = string_counter++;
+            }
         }
-    }
     
-    // Handle ForLoop nodes specially (they have init, condition, increment, body)
-    if (node->type == NodeType::ForLoop) {
-        auto forNode = std::static_pointer_cast<ForNode>(node);
-        collect_strings(forNode->init);
-        collect_strings(forNode->condition);
-        collect_strings(forNode->increment);
-        collect_strings(forNode->body);
-    }
+        // Handle ForLoop nodes specially (they have init, condition, increment, body)
+        if (node->type == NodeType::ForLoop) {
+            auto forNode = static_cast<ForNode*>(node);
+            collect_references(forNode->init);
+            collect_references(forNode->condition);
+            collect_references(forNode->increment);
+            collect_references(forNode->body);
+        }
     
-    // Handle IfStatement nodes (they have condition, thenBranch, elseBranch)
-    if (node->type == NodeType::IfStatement) {
-        auto ifNode = std::static_pointer_cast<IfNode>(node);
-        collect_strings(ifNode->condition);
-        collect_strings(ifNode->thenBranch);
-        collect_strings(ifNode->elseBranch);
-    }
+        // Handle IfStatement nodes (they have condition, thenBranch, elseBranch)
+        if (node->type == NodeType::IfStatement) {
+            auto ifNode = static_cast<IfNode*>(node);
+            collect_references(ifNode->condition);
+            collect_references(ifNode->thenBranch);
+            collect_references(ifNode->elseBranch);
+        }
     
-    // Handle WhileLoop nodes (they have condition and body)
-    if (node->type == NodeType::WhileLoop) {
-        auto whileNode = std::static_pointer_cast<WhileNode>(node);
-        collect_strings(whileNode->condition);
-        collect_strings(whileNode->body);
-    }
+        // Handle WhileLoop nodes (they have condition and body)
+        if (node->type == NodeType::WhileLoop) {
+            auto whileNode = static_cast<WhileNode*>(node);
+            collect_references(whileNode->condition);
+            collect_references(whileNode->body);
+        }
     
-    // Handle FunctionDecl nodes (they have parameters and body)
-    if (node->type == NodeType::FunctionDecl) {
-        auto funcNode = std::static_pointer_cast<FunctionDeclNode>(node);
-        collect_strings(funcNode->body);
-    }
+        // Handle FunctionDecl nodes (they have parameters and body)
+        if (node->type == NodeType::FunctionDecl) {
+            auto funcNode = static_cast<FunctionDeclNode*>(node);
+            collect_references(funcNode->body);
+        }
     
-    // Recursively check standard children
-    if (node->left) collect_strings(node->left);
-    if (node->right) collect_strings(node->right);
-    for (auto& child : node->children) {
-        collect_strings(child);
+        // Nodes holding a single expression
+        if (node->type == NodeType::Return) {
+            collect_references(static_cast<ReturnNode*>(node)->returnValue);
+        }
+        if (node->type == NodeType::VectorAlloc) {
+            collect_references(static_cast<VectorAllocNode*>(node)->size);
+        }
+        if (node->type == NodeType::ArrayAccess) {
+            collect_references(static_cast<ArrayAccessNode*>(node)->index);
+        }
+    
+        if (node->type == NodeType::FunctionCall) {
+            called_functions[node->symbol] = true;
+        }
+    
+        // Recursively check the other standard children
+        if (node->right) collect_references(node->right);
+        for (auto& child : node->children) {
+            collect_references(child);
+        }
     }
 }
 
-std::string generate_assembly_from_ast(std::shared_ptr<ASTNode> ast) {
+std::string generate_assembly_from_ast(ASTNode* ast, const SymbolTable& symbols, Target target,
+                                       ModuleKind kind) {
     std::stringstream asm_code;
-    
+    target_abi = target;
+    symbol_table = &symbols;
+
     // Reset and collect string literals
+    ::label_counter = 0;
     string_literals.clear();
+    string_variables.assign(symbols.size(), false);
+    called_functions.assign(symbols.size(), false);
     string_counter = 0;
-    collect_strings(ast);
+    collect_references(ast);
+
+    // Top-level functions and imports. A program that imports links with
+    // other modules: its functions and heap are shared with them, and calls
+    // to functions it doesn't define are resolved by the linker.
+    std::vector<FunctionDeclNode*> functions;
+    bool imports = false;
+    if (ast->type == NodeType::Program) {
+        for (auto& child : ast->children) {
+            if (child->type == NodeType::FunctionDecl) {
+                functions.push_back(static_cast<FunctionDeclNode*>(child));
+            } else if (child->type == NodeType::Import) {
+                imports = true;
+            } else if (kind == ModuleKind::Library) {
+                throw std::runtime_error("An imported module may only contain functions and imports");
+            }
+        }
+    }
+    bool linked = imports || kind == ModuleKind::Library;
     
     // Header
     asm_code << "section .data\n";
@@ -1182,63 +460,86 @@ std::string generate_assembly_from_ast(std::shared_ptr<ASTNode> ast) {
     
     asm_code << "section .bss\n";
     asm_code << "    temp_buffer resb 32\n";
-    asm_code << "    heap_space resb 8192\n";  // 8KB heap for vectors
-    asm_code << "    heap_ptr resq 1\n\n";     // Pointer to next free space
+    if (kind == ModuleKind::Program) {
+        asm_code << "    heap_space resb 8192\n";  // 8KB heap for vectors
+        asm_code << "    heap_ptr resq 1\n";       // Pointer to next free space
+    }
+    asm_code << "\n";
     
     asm_code << "section .text\n";
-    asm_code << "    global main\n";
-    asm_code << "    extern putchar\n\n";
-    
-    // First pass: Generate function declarations
-    if (ast->type == NodeType::Program) {
-        for (auto& child : ast->children) {
-            if (child->type == NodeType::FunctionDecl) {
-                std::map<std::string, int> dummy_vars;
-                int dummy_stack = 0;
-                int dummy_label = 0;
-                generate_node(child, asm_code, dummy_vars, dummy_stack, dummy_label);
+    if (kind == ModuleKind::Program) {
+        asm_code << "    global main\n";
+    }
+    asm_code << "    extern putchar\n";
+    if (linked) {
+        asm_code << (kind == ModuleKind::Program ? "    global heap_ptr\n" : "    extern heap_ptr\n");
+        std::vector<bool> defined(symbols.size(), false);
+        for (FunctionDeclNode* function : functions) {
+            asm_code << "    global " << symbol_name(function->functionName) << "\n";
+            defined[function->functionName] = true;
+        }
+        for (Symbol symbol = 0; symbol < symbols.size(); symbol++) {
+            if (called_functions[symbol] && !defined[symbol]) {
+                asm_code << "    extern " << symbol_name(symbol) << "\n";
             }
         }
     }
+    asm_code << "\n";
+    emit_putchar_thunk(asm_code);
+
+    // First pass: Generate function declarations
+    for (FunctionDeclNode* function : functions) {
+        VarOffsets dummy_vars;
+        int dummy_stack = 0;
+        int dummy_label = 0;
+        generate_node(function, asm_code, dummy_vars, dummy_stack, dummy_label);
+    }
     
-    asm_code << "main:\n";
-    asm_code << "    push rbp\n";
-    asm_code << "    mov rbp, rsp\n";
-    asm_code << "    sub rsp, 1024\n\n";
-    asm_code << "    ; Initialize heap pointer\n";
-    asm_code << "    lea rax, [rel heap_space]\n";
-    asm_code << "    mov [rel heap_ptr], rax\n\n";
-    
-    // State for code generation
-    std::map<std::string, int> var_offsets;
-    int stack_offset = 0;
-    int label_counter = 0;
-    
-    // Second pass: Generate non-function statements for main
-    if (ast->type == NodeType::Program) {
-        for (auto& child : ast->children) {
-            if (child->type != NodeType::FunctionDecl) {
-                generate_node(child, asm_code, var_offsets, stack_offset, label_counter);
+    if (kind == ModuleKind::Program) {
+        asm_code << "main:\n";
+        asm_code << "    push rbp\n";
+        asm_code << "    mov rbp, rsp\n";
+        asm_code << "    sub rsp, 1024\n\n";
+        asm_code << "    ; Initialize heap pointer\n";
+        asm_code << "    lea rax, [rel heap_space]\n";
+        asm_code << "    mov [rel heap_ptr], rax\n\n";
+        
+        // State for code generation
+        VarOffsets var_offsets(symbols.size(), 0);
+        int stack_offset = 0;
+        int label_counter = 0;
+        
+        // Second pass: Generate non-function statements for main
+        if (ast->type == NodeType::Program) {
+            for (auto& child : ast->children) {
+                if (child->type != NodeType::FunctionDecl) {
+                    generate_node(child, asm_code, var_offsets, stack_offset, label_counter);
+                }
             }
+        } else {
+            // Not a program node, generate directly
+            generate_node(ast, asm_code, var_offsets, stack_offset, label_counter);
         }
-    } else {
-        // Not a program node, generate directly
-        generate_node(ast, asm_code, var_offsets, stack_offset, label_counter);
+        
+        // Footer
+        asm_code << "\n    xor eax, eax\n";
+        asm_code << "    add rsp, 1024\n";
+        asm_code << "    pop rbp\n";
+        asm_code << "    ret\n";
     }
-    
-    // Footer
-    asm_code << "\n    xor eax, eax\n";
-    asm_code << "    add rsp, 1024\n";
-    asm_code << "    pop rbp\n";
-    asm_code << "    ret\n";
-    
+
+    // ELF: mark the stack non-executable so the linker doesn't warn
+    if (target_abi == Target::LinuxX86_64) {
+        asm_code << "\nsection .note.GNU-stack noalloc noexec nowrite progbits\n";
+    }
+
     return asm_code.str();
 }
 
 // Helper function to generate code for a single node
-void generate_node(std::shared_ptr<ASTNode> node, 
+void generate_node(ASTNode* node, 
                    std::stringstream& asm_code,
-                   std::map<std::string, int>& var_offsets,
+                   VarOffsets& var_offsets,
                    int& stack_offset,
                    int& label_counter) {
     if (!node) return;
@@ -1261,41 +562,33 @@ void generate_node(std::shared_ptr<ASTNode> node,
         }
         
         case NodeType::Assignment: {
-            auto assignNode = std::static_pointer_cast<AssignmentNode>(node);
-            std::string var_name = assignNode->varName;
+            auto assignNode = static_cast<AssignmentNode*>(node);
+            Symbol var_name = assignNode->varName;
             std::string var_type = assignNode->varType;
             
             // Check if this is array element assignment (left side is ArrayAccess)
             if (assignNode->left && assignNode->left->type == NodeType::ArrayAccess) {
-                auto accessNode = std::static_pointer_cast<ArrayAccessNode>(assignNode->left);
+                auto accessNode = static_cast<ArrayAccessNode*>(assignNode->left);
                 
-                // Get the array pointer
-                asm_code << "    mov rbx, [rbp-" << var_offsets[accessNode->arrayName] << "]\n";
+                // Index into the first scratch register, then the value
+                // into the second
+                generate_scratch(accessNode->index, 0, asm_code, var_offsets);
+                generate_scratch(assignNode->right, 1, asm_code, var_offsets);
                 
-                // Evaluate index and save it
-                generate_expression(accessNode->index, asm_code, var_offsets);
-                asm_code << "    push rax\n";
-                
-                // Evaluate the value to assign
-                generate_expression(assignNode->right, asm_code, var_offsets);
-                asm_code << "    mov rcx, rax\n";  // Save value in rcx
-                
-                // Calculate offset
-                asm_code << "    pop rax\n";  // Get index back
-                asm_code << "    imul rax, 8\n";  // index * 8
-                asm_code << "    add rbx, rax\n";  // array + offset
-                asm_code << "    mov [rbx], rcx\n";  // Store value
+                // Store through the array pointer
+                asm_code << "    mov rcx, [rbp-" << var_offsets[accessNode->arrayName] << "]\n";
+                asm_code << "    mov [rcx + " << SCRATCH_REGISTERS[0] << "*8], " << SCRATCH_REGISTERS[1] << "\n";
             } else if (var_type == "text") {
                 // String variable assignment
                 
                 // Allocate space on stack for the pointer
-                if (var_offsets.find(var_name) == var_offsets.end()) {
+                if (var_offsets[var_name] == 0) {
                     stack_offset += 8;
                     var_offsets[var_name] = stack_offset;
                 }
                 
                 // Track this as a string variable (mark it before generating expression)
-                string_variables[var_name] = var_name;  // Mark as string variable
+                string_variables[var_name] = true;
                 
                 // Generate the expression (could be literal, variable, or concatenation)
                 // Result will be a pointer in rax
@@ -1314,7 +607,7 @@ void generate_node(std::shared_ptr<ASTNode> node,
                 // Regular numeric variable assignment
                 
                 // Allocate space on stack if new variable
-                if (var_offsets.find(var_name) == var_offsets.end()) {
+                if (var_offsets[var_name] == 0) {
                     stack_offset += 8;
                     var_offsets[var_name] = stack_offset;
                 }
@@ -1336,71 +629,19 @@ void generate_node(std::shared_ptr<ASTNode> node,
                 
                 asm_code << "    ; Print string\n";
                 asm_code << "    lea rbx, [rel str_" << str_id << "]\n";
-                asm_code << ".print_str_" << label_counter << ":\n";
-                asm_code << "    movzx rcx, byte [rbx]\n";
-                asm_code << "    test rcx, rcx\n";
-                asm_code << "    jz .done_str_" << label_counter << "\n";
-                asm_code << "    call putchar\n";
-                asm_code << "    inc rbx\n";
-                asm_code << "    jmp .print_str_" << label_counter << "\n";
-                asm_code << ".done_str_" << label_counter << ":\n";
-                asm_code << "    mov rcx, 10\n";  // Print newline
-                asm_code << "    call putchar\n";
-                
-                label_counter++;
+                emit_print_string(asm_code, label_counter++);
             } else if (node->left && node->left->type == NodeType::Identifier) {
                 // Check if this is a string variable
-                std::string var_name = node->left->value.value();
-                if (string_variables.find(var_name) != string_variables.end()) {
+                Symbol var_name = node->left->symbol;
+                if (string_variables[var_name]) {
                     // Print string variable
                     asm_code << "    ; Print string variable\n";
                     asm_code << "    mov rbx, [rbp-" << var_offsets[var_name] << "]\n";
-                    asm_code << ".print_str_" << label_counter << ":\n";
-                    asm_code << "    movzx rcx, byte [rbx]\n";
-                    asm_code << "    test rcx, rcx\n";
-                    asm_code << "    jz .done_str_" << label_counter << "\n";
-                    asm_code << "    call putchar\n";
-                    asm_code << "    inc rbx\n";
-                    asm_code << "    jmp .print_str_" << label_counter << "\n";
-                    asm_code << ".done_str_" << label_counter << ":\n";
-                    asm_code << "    mov rcx, 10\n";  // Print newline
-                    asm_code << "    call putchar\n";
-                    
-                    label_counter++;
+                    emit_print_string(asm_code, label_counter++);
                 } else {
                     // Print numeric variable
                     generate_expression(node->left, asm_code, var_offsets);
-                    
-                    // Print the value in rax
-                    asm_code << "    ; Print value in rax\n";
-                    asm_code << "    test rax, rax\n";
-                    asm_code << "    jnz .not_zero_" << label_counter << "\n";
-                    asm_code << "    mov rcx, '0'\n";
-                    asm_code << "    call putchar\n";
-                    asm_code << "    jmp .done_print_" << label_counter << "\n";
-                    asm_code << ".not_zero_" << label_counter << ":\n";
-                    asm_code << "    mov rbx, 10\n";
-                    asm_code << "    xor r12, r12\n";
-                    asm_code << "    lea r13, [rel temp_buffer]\n";
-                    asm_code << ".digit_loop_" << label_counter << ":\n";
-                    asm_code << "    xor rdx, rdx\n";
-                    asm_code << "    div rbx\n";
-                    asm_code << "    add dl, '0'\n";
-                    asm_code << "    mov [r13 + r12], dl\n";
-                    asm_code << "    inc r12\n";
-                    asm_code << "    test rax, rax\n";
-                    asm_code << "    jnz .digit_loop_" << label_counter << "\n";
-                    asm_code << ".print_loop_" << label_counter << ":\n";
-                    asm_code << "    dec r12\n";
-                    asm_code << "    movzx rcx, byte [r13 + r12]\n";
-                    asm_code << "    call putchar\n";
-                    asm_code << "    test r12, r12\n";
-                    asm_code << "    jnz .print_loop_" << label_counter << "\n";
-                    asm_code << ".done_print_" << label_counter << ":\n";
-                    asm_code << "    mov rcx, 10\n";
-                    asm_code << "    call putchar\n";
-                    
-                    label_counter++;
+                    emit_print_number(asm_code, label_counter++);
                 }
             } else {
                 // Check if this is a string expression (concatenation or string literal)
@@ -1411,59 +652,18 @@ void generate_node(std::shared_ptr<ASTNode> node,
                     // rax now contains pointer to string
                     asm_code << "    ; Print string from expression\n";
                     asm_code << "    mov rbx, rax\n";
-                    asm_code << ".print_str_" << label_counter << ":\n";
-                    asm_code << "    movzx rcx, byte [rbx]\n";
-                    asm_code << "    test rcx, rcx\n";
-                    asm_code << "    jz .done_str_" << label_counter << "\n";
-                    asm_code << "    call putchar\n";
-                    asm_code << "    inc rbx\n";
-                    asm_code << "    jmp .print_str_" << label_counter << "\n";
-                    asm_code << ".done_str_" << label_counter << ":\n";
-                    asm_code << "    mov rcx, 10\n";  // Print newline
-                    asm_code << "    call putchar\n";
-                    
-                    label_counter++;
+                    emit_print_string(asm_code, label_counter++);
                 } else {
                     // Generate code for the numeric expression to print
                     generate_expression(node->left, asm_code, var_offsets);
-                    
-                    // Print the value in rax
-                    asm_code << "    ; Print value in rax\n";
-                    asm_code << "    test rax, rax\n";
-                    asm_code << "    jnz .not_zero_" << label_counter << "\n";
-                    asm_code << "    mov rcx, '0'\n";
-                    asm_code << "    call putchar\n";
-                    asm_code << "    jmp .done_print_" << label_counter << "\n";
-                    asm_code << ".not_zero_" << label_counter << ":\n";
-                    asm_code << "    mov rbx, 10\n";
-                    asm_code << "    xor r12, r12\n";
-                    asm_code << "    lea r13, [rel temp_buffer]\n";
-                    asm_code << ".digit_loop_" << label_counter << ":\n";
-                    asm_code << "    xor rdx, rdx\n";
-                    asm_code << "    div rbx\n";
-                    asm_code << "    add dl, '0'\n";
-                    asm_code << "    mov [r13 + r12], dl\n";
-                    asm_code << "    inc r12\n";
-                    asm_code << "    test rax, rax\n";
-                    asm_code << "    jnz .digit_loop_" << label_counter << "\n";
-                    asm_code << ".print_loop_" << label_counter << ":\n";
-                    asm_code << "    dec r12\n";
-                    asm_code << "    movzx rcx, byte [r13 + r12]\n";
-                    asm_code << "    call putchar\n";
-                    asm_code << "    test r12, r12\n";
-                    asm_code << "    jnz .print_loop_" << label_counter << "\n";
-                    asm_code << ".done_print_" << label_counter << ":\n";
-                    asm_code << "    mov rcx, 10\n";
-                    asm_code << "    call putchar\n";
-                    
-                    label_counter++;
+                    emit_print_number(asm_code, label_counter++);
                 }
             }
             break;
         }
         
         case NodeType::IfStatement: {
-            auto ifNode = std::static_pointer_cast<IfNode>(node);
+            auto ifNode = static_cast<IfNode*>(node);
             int if_label = label_counter++;
             
             // Generate condition code - jumps to else (or end if no else) when false
@@ -1492,7 +692,7 @@ void generate_node(std::shared_ptr<ASTNode> node,
         }
         
         case NodeType::WhileLoop: {
-            auto whileNode = std::static_pointer_cast<WhileNode>(node);
+            auto whileNode = static_cast<WhileNode*>(node);
             int while_label = label_counter++;
             
             asm_code << ".while_start_" << while_label << ":\n";
@@ -1509,7 +709,7 @@ void generate_node(std::shared_ptr<ASTNode> node,
         }
         
         case NodeType::ForLoop: {
-            auto forNode = std::static_pointer_cast<ForNode>(node);
+            auto forNode = static_cast<ForNode*>(node);
             int for_label = label_counter++;
             
             // Generate initialization
@@ -1545,34 +745,31 @@ void generate_node(std::shared_ptr<ASTNode> node,
         
         case NodeType::FunctionDecl: {
             // function name begin params end front body back
-            auto funcNode = std::static_pointer_cast<FunctionDeclNode>(node);
+            auto funcNode = static_cast<FunctionDeclNode*>(node);
             
-            asm_code << "\n; Function: " << funcNode->functionName << "\n";
-            asm_code << funcNode->functionName << ":\n";
+            std::string function_name = symbol_name(funcNode->functionName);
+            asm_code << "\n; Function: " << function_name << "\n";
+            asm_code << function_name << ":\n";
             asm_code << "    push rbp\n";
             asm_code << "    mov rbp, rsp\n";
             asm_code << "    sub rsp, 256\n";  // Local variable space
             
             // Create local variable map for parameters
-            // Windows x64: first 4 params in rcx, rdx, r8, r9
-            std::map<std::string, int> func_vars;
+            // Register parameters are spilled to the frame; the rest were
+            // stored by the caller above the return address (and shadow space)
+            const auto& regs = arg_registers();
+            VarOffsets func_vars(symbol_table->size(), 0);
             int param_offset = 0;
             for (size_t i = 0; i < funcNode->parameters.size(); i++) {
                 param_offset += 8;
                 func_vars[funcNode->parameters[i]] = param_offset;
                 
                 // Store parameter on stack
-                if (i == 0) {
-                    asm_code << "    mov [rbp-" << param_offset << "], rcx\n";
-                } else if (i == 1) {
-                    asm_code << "    mov [rbp-" << param_offset << "], rdx\n";
-                } else if (i == 2) {
-                    asm_code << "    mov [rbp-" << param_offset << "], r8\n";
-                } else if (i == 3) {
-                    asm_code << "    mov [rbp-" << param_offset << "], r9\n";
+                if (i < regs.size()) {
+                    asm_code << "    mov [rbp-" << param_offset << "], " << regs[i] << "\n";
                 } else {
-                    // Additional parameters on stack (passed by caller)
-                    asm_code << "    mov rax, [rbp+" << (16 + (i-4)*8) << "]\n";
+                    int caller_slot = 16 + shadow_space() + static_cast<int>(i - regs.size()) * 8;
+                    asm_code << "    mov rax, [rbp+" << caller_slot << "]\n";
                     asm_code << "    mov [rbp-" << param_offset << "], rax\n";
                 }
             }
@@ -1593,7 +790,7 @@ void generate_node(std::shared_ptr<ASTNode> node,
         
         case NodeType::Return: {
             // mcs expression.
-            auto returnNode = std::static_pointer_cast<ReturnNode>(node);
+            auto returnNode = static_cast<ReturnNode*>(node);
             
             // Evaluate return expression
             generate_expression(returnNode->returnValue, asm_code, var_offsets);
@@ -1617,18 +814,276 @@ void generate_node(std::shared_ptr<ASTNode> node,
     }
 }
 
+// Numeric expressions are evaluated into scratch registers with Sethi-Ullman
+// numbering: each subtree is labelled with the registers it needs, and of two
+// operands the one needing more is evaluated first so the other fits in what
+// is left. A variable or 32-bit literal on the right is used in place. Past
+// the last scratch register the left operand waits on the stack.
+
+// A binary operator on numbers: anything but a concatenation. One that
+// doesn't compute (a comparison outside a condition, ...) gives its left
+// operand.
+static bool is_numeric_operation(ASTNode* node) {
+    if (node->type != NodeType::BinaryOp) return false;
+    auto binOp = static_cast<BinaryOpNode*>(node);
+    return binOp->op != TokenType::_durham ||
+           (!is_string_expression(binOp->left, string_variables) &&
+            !is_string_expression(binOp->right, string_variables));
+}
+
+// The left spine of a chain of numeric operations, from the top down. Below
+// a numeric durham the durhams are numeric too, but one below another
+// operator may be a concatenation, so it ends the chain.
+static std::vector<BinaryOpNode*> operation_chain(BinaryOpNode* binOp) {
+    std::vector<BinaryOpNode*> chain = {binOp};
+    bool only_durham = binOp->op == TokenType::_durham;
+    while (chain.back()->left->type == NodeType::BinaryOp) {
+        auto leftOp = static_cast<BinaryOpNode*>(chain.back()->left);
+        if (leftOp->op == TokenType::_durham && !only_durham) break;
+        only_durham = only_durham && leftOp->op == TokenType::_durham;
+        chain.push_back(leftOp);
+    }
+    return chain;
+}
+
+// An operand an instruction can take as it is
+static bool is_direct_operand(ASTNode* node) {
+    if (node->type == NodeType::Identifier) return true;
+    if (node->type != NodeType::Literal) return false;
+    int64_t value = static_cast<LiteralNode*>(node)->literalValue;
+    return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+static std::string direct_operand(ASTNode* node, VarOffsets& var_offsets) {
+    if (node->type == NodeType::Literal) {
+        return std::to_string(static_cast<LiteralNode*>(node)->literalValue);
+    }
+    if (var_offsets[node->symbol] == 0) {
+        throw std::runtime_error("Variable '" + symbol_name(node->symbol) + "' not defined");
+    }
+    return "qword [rbp-" + std::to_string(var_offsets[node->symbol]) + "]";
+}
+
+static int combine_needs(int left, int right) {
+    return left == right ? left + 1 : std::max(left, right);
+}
+
+// Scratch registers needed to evaluate node into one
+static int scratch_need(ASTNode* node) {
+    if (node->type == NodeType::ArrayAccess) {
+        return std::max(1, scratch_need(static_cast<ArrayAccessNode*>(node)->index));
+    }
+    if (!is_numeric_operation(node)) return 1;
+    std::vector<BinaryOpNode*> chain = operation_chain(static_cast<BinaryOpNode*>(node));
+    int need = scratch_need(chain.back()->left);
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        need = combine_needs(need, is_direct_operand((*it)->right) ? 0 : scratch_need((*it)->right));
+    }
+    return need;
+}
+
+// What evaluating an expression does that fixes its order: a call can print
+// or write any array, so it stays on the same side of other calls and of
+// array reads
+struct Effects {
+    bool calls = false;     // calls a function
+    bool reads = false;     // reads an array element
+
+    Effects& operator|=(const Effects& other) {
+        calls = calls || other.calls;
+        reads = reads || other.reads;
+        return *this;
+    }
+    bool conflicts(const Effects& other) const {
+        return (calls && (other.calls || other.reads)) || (reads && other.calls);
+    }
+};
+
+static Effects effects_of(ASTNode* node) {
+    Effects effects;
+    std::vector<ASTNode*> pending = {node};
+    while (!pending.empty() && !(effects.calls && effects.reads)) {
+        ASTNode* next = pending.back();
+        pending.pop_back();
+        switch (next->type) {
+            case NodeType::FunctionCall:
+                effects.calls = true;
+                break;
+            case NodeType::ArrayAccess:
+                effects.reads = true;
+                pending.push_back(static_cast<ArrayAccessNode*>(next)->index);
+                break;
+            case NodeType::VectorAlloc:
+                pending.push_back(static_cast<VectorAllocNode*>(next)->size);
+                break;
+            case NodeType::BinaryOp:
+                pending.push_back(next->left);
+                pending.push_back(next->right);
+                break;
+            default:
+                break;
+        }
+    }
+    return effects;
+}
+
+// Whether right is better evaluated before left, into scratch register k
+// with left in the next one
+static bool evaluate_right_first(int left_need, const Effects& left_effects, ASTNode* right, int k) {
+    return k + 1 < SCRATCH_COUNT && !is_direct_operand(right) && scratch_need(right) > left_need &&
+           !left_effects.conflicts(effects_of(right));
+}
+
+// dst op= src, for a numeric operator; src is a scratch register, rcx or a
+// direct operand
+static void emit_operation(TokenType op, const std::string& dst, const std::string& src,
+                           std::stringstream& asm_code) {
+    switch (op) {
+        case TokenType::_durham:
+            asm_code << "    add " << dst << ", " << src << "\n";
+            break;
+        case TokenType::_newcastle:
+            asm_code << "    sub " << dst << ", " << src << "\n";
+            break;
+        case TokenType::_york:
+            asm_code << "    imul " << dst << ", " << src << "\n";
+            break;
+        case TokenType::_edinburgh:
+        case TokenType::_remainder: {
+            // Unsigned divide of rdx:rax; the divisor has to be a register
+            std::string divisor = src;
+            if (src[0] != 'r') {
+                asm_code << "    mov rcx, " << src << "\n";
+                divisor = "rcx";
+            }
+            asm_code << "    mov rax, " << dst << "\n";
+            asm_code << "    xor edx, edx\n";
+            asm_code << "    div " << divisor << "\n";
+            asm_code << "    mov " << dst << ", " << (op == TokenType::_edinburgh ? "rax" : "rdx") << "\n";
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// The right operand of an operation whose left is in scratch register k
+static std::string generate_right(ASTNode* right, int k,
+                                  std::stringstream& asm_code,
+                                  VarOffsets& var_offsets) {
+    if (is_direct_operand(right)) return direct_operand(right, var_offsets);
+    if (k + 1 < SCRATCH_COUNT) {
+        generate_scratch(right, k + 1, asm_code, var_offsets);
+        return SCRATCH_REGISTERS[k + 1];
+    }
+    asm_code << "    push " << SCRATCH_REGISTERS[k] << "\n";
+    generate_scratch(right, k, asm_code, var_offsets);
+    asm_code << "    mov rcx, " << SCRATCH_REGISTERS[k] << "\n";
+    asm_code << "    pop " << SCRATCH_REGISTERS[k] << "\n";
+    return "rcx";
+}
+
+// Evaluate both operands of a binary operator from scratch register k up.
+// Returns the register holding left and the operand for right.
+static std::pair<std::string, std::string> generate_operands(ASTNode* left, ASTNode* right, int k,
+                                                             std::stringstream& asm_code,
+                                                             VarOffsets& var_offsets) {
+    if (evaluate_right_first(scratch_need(left), effects_of(left), right, k)) {
+        generate_scratch(right, k, asm_code, var_offsets);
+        generate_scratch(left, k + 1, asm_code, var_offsets);
+        return {SCRATCH_REGISTERS[k + 1], SCRATCH_REGISTERS[k]};
+    }
+    generate_scratch(left, k, asm_code, var_offsets);
+    return {SCRATCH_REGISTERS[k], generate_right(right, k, asm_code, var_offsets)};
+}
+
+// Evaluate node into scratch register k, using those above it as needed
+static void generate_scratch(ASTNode* node, int k,
+                             std::stringstream& asm_code,
+                             VarOffsets& var_offsets) {
+    const char* reg = SCRATCH_REGISTERS[k];
+    
+    if (node->type == NodeType::Literal || node->type == NodeType::Identifier) {
+        asm_code << "    mov " << reg << ", " << direct_operand(node, var_offsets) << "\n";
+        return;
+    }
+    
+    if (node->type == NodeType::ArrayAccess) {
+        auto accessNode = static_cast<ArrayAccessNode*>(node);
+        if (var_offsets[accessNode->arrayName] == 0) {
+            throw std::runtime_error("Array '" + symbol_name(accessNode->arrayName) + "' not defined");
+        }
+        generate_scratch(accessNode->index, k, asm_code, var_offsets);
+        asm_code << "    mov rcx, [rbp-" << var_offsets[accessNode->arrayName] << "]\n";
+        asm_code << "    mov " << reg << ", [rcx + " << reg << "*8]\n";
+        return;
+    }
+    
+    if (!is_numeric_operation(node)) {
+        // Anything else goes through rax, and may call out, so the scratch
+        // registers in use are saved around it
+        for (int i = 0; i < k; i++) {
+            asm_code << "    push " << SCRATCH_REGISTERS[i] << "\n";
+        }
+        generate_expression(node, asm_code, var_offsets);
+        for (int i = k; i-- > 0;) {
+            asm_code << "    pop " << SCRATCH_REGISTERS[i] << "\n";
+        }
+        asm_code << "    mov " << reg << ", rax\n";
+        return;
+    }
+    
+    // Long chains lean left, so they are walked rather than recursed into.
+    // Going up from the innermost operand, the needs and effects of what is
+    // below each step decide the highest step (if any) whose right side is
+    // worth evaluating first; everything above it applies its right side to
+    // the running value in reg.
+    std::vector<BinaryOpNode*> chain = operation_chain(static_cast<BinaryOpNode*>(node));
+    std::vector<int> needs(chain.size() + 1);
+    std::vector<Effects> effects(chain.size() + 1);
+    needs[chain.size()] = scratch_need(chain.back()->left);
+    effects[chain.size()] = effects_of(chain.back()->left);
+    for (size_t i = chain.size(); i-- > 0;) {
+        ASTNode* right = chain[i]->right;
+        needs[i] = combine_needs(needs[i + 1], is_direct_operand(right) ? 0 : scratch_need(right));
+        effects[i] = effects[i + 1];
+        effects[i] |= effects_of(right);
+    }
+    
+    size_t first = chain.size();
+    for (size_t i = 0; i < chain.size(); i++) {
+        if (evaluate_right_first(needs[i + 1], effects[i + 1], chain[i]->right, k)) {
+            first = i;
+            break;
+        }
+    }
+    if (first < chain.size()) {
+        BinaryOpNode* step = chain[first];
+        auto [left, right] = generate_operands(step->left, step->right, k, asm_code, var_offsets);
+        if (step->op == TokenType::_durham || step->op == TokenType::_york) {
+            emit_operation(step->op, right, left, asm_code);
+        } else {
+            emit_operation(step->op, left, right, asm_code);
+            asm_code << "    mov " << reg << ", " << left << "\n";
+        }
+    } else {
+        generate_scratch(chain.back()->left, k, asm_code, var_offsets);
+    }
+    for (size_t i = first; i-- > 0;) {
+        std::string right = generate_right(chain[i]->right, k, asm_code, var_offsets);
+        emit_operation(chain[i]->op, reg, right, asm_code);
+    }
+}
+
 // Generate code for an expression (returns result in rax)
-void generate_expression(std::shared_ptr<ASTNode> node,
+void generate_expression(ASTNode* node,
                         std::stringstream& asm_code,
-                        std::map<std::string, int>& var_offsets) {
+                        VarOffsets& var_offsets) {
     if (!node) return;
     
     switch (node->type) {
         case NodeType::Literal: {
-            // Convert base-17 to decimal
-            std::string val = node->value.value();
-            int decimal = base17_to_decimal(val);
-            asm_code << "    mov rax, " << decimal << "\n";
+            asm_code << "    mov rax, " << static_cast<LiteralNode*>(node)->literalValue << "\n";
             break;
         }
         
@@ -1641,16 +1096,15 @@ void generate_expression(std::shared_ptr<ASTNode> node,
         }
         
         case NodeType::Identifier: {
-            std::string var_name = node->value.value();
-            if (var_offsets.find(var_name) == var_offsets.end()) {
-                throw std::runtime_error("Variable '" + var_name + "' not defined");
+            if (var_offsets[node->symbol] == 0) {
+                throw std::runtime_error("Variable '" + symbol_name(node->symbol) + "' not defined");
             }
-            asm_code << "    mov rax, [rbp-" << var_offsets[var_name] << "]\n";
+            asm_code << "    mov rax, [rbp-" << var_offsets[node->symbol] << "]\n";
             break;
         }
         
         case NodeType::BinaryOp: {
-            auto binOp = std::static_pointer_cast<BinaryOpNode>(node);
+            auto binOp = static_cast<BinaryOpNode*>(node);
             
             // Check if this is a string concatenation operation
             if (binOp->op == TokenType::_durham && 
@@ -1660,41 +1114,15 @@ void generate_expression(std::shared_ptr<ASTNode> node,
                 generate_string_concat(binOp->left, binOp->right, asm_code, 
                                      var_offsets, string_variables, string_literals);
             } else {
-                // Numeric operation
-                // Generate left operand
-                generate_expression(binOp->left, asm_code, var_offsets);
-                asm_code << "    push rax\n";
-                
-                // Generate right operand
-                generate_expression(binOp->right, asm_code, var_offsets);
-                asm_code << "    mov rbx, rax\n";
-                asm_code << "    pop rax\n";
-                
-                // Perform operation
-                switch (binOp->op) {
-                    case TokenType::_durham:  // +
-                        asm_code << "    add rax, rbx\n";
-                        break;
-                    case TokenType::_newcastle:  // -
-                        asm_code << "    sub rax, rbx\n";
-                        break;
-                    case TokenType::_york:  // *
-                        asm_code << "    imul rax, rbx\n";
-                        break;
-                    case TokenType::_edinburgh:  // /
-                        asm_code << "    xor rdx, rdx\n";
-                        asm_code << "    div rbx\n";
-                        break;
-                    default:
-                        break;
-                }
+                generate_scratch(binOp, 0, asm_code, var_offsets);
+                asm_code << "    mov rax, " << SCRATCH_REGISTERS[0] << "\n";
             }
             break;
         }
         
         case NodeType::VectorAlloc: {
             // new college begin SIZE end
-            auto vecNode = std::static_pointer_cast<VectorAllocNode>(node);
+            auto vecNode = static_cast<VectorAllocNode*>(node);
             
             // Evaluate size expression
             generate_expression(vecNode->size, asm_code, var_offsets);
@@ -1711,73 +1139,63 @@ void generate_expression(std::shared_ptr<ASTNode> node,
         
         case NodeType::ArrayAccess: {
             // array at index
-            auto accessNode = std::static_pointer_cast<ArrayAccessNode>(node);
-            std::string array_name = accessNode->arrayName;
+            auto accessNode = static_cast<ArrayAccessNode*>(node);
+            Symbol array_name = accessNode->arrayName;
             
-            if (var_offsets.find(array_name) == var_offsets.end()) {
-                throw std::runtime_error("Array '" + array_name + "' not defined");
+            if (var_offsets[array_name] == 0) {
+                throw std::runtime_error("Array '" + symbol_name(array_name) + "' not defined");
             }
             
-            // Get the array pointer (stored in variable)
-            asm_code << "    mov rbx, [rbp-" << var_offsets[array_name] << "]\n";
-            
             // Evaluate index expression
             generate_expression(accessNode->index, asm_code, var_offsets);
             
-            // Calculate offset: index * 8 (each element is 8 bytes)
-            asm_code << "    imul rax, 8\n";
-            
-            // Load array[index] into rax
-            asm_code << "    add rbx, rax\n";
-            asm_code << "    mov rax, [rbx]\n";
+            // Load array[index] through the array pointer (stored in variable)
+            asm_code << "    mov rcx, [rbp-" << var_offsets[array_name] << "]\n";
+            asm_code << "    mov rax, [rcx + rax*8]\n";
             break;
         }
         
         case NodeType::FunctionCall: {
             // func begin arg1 and arg2 end
-            std::string func_name = node->value.value();
+            std::string func_name = symbol_name(node->symbol);
             
             asm_code << "    ; Call function " << func_name << "\n";
             
-            // Windows x64 calling convention: rcx, rdx, r8, r9, then stack
-            // Save caller-saved registers if needed
-            asm_code << "    push rcx\n";
-            asm_code << "    push rdx\n";
-            asm_code << "    push r8\n";
-            asm_code << "    push r9\n";
-            
-            // Align stack to 16 bytes (Windows x64 requirement)
-            asm_code << "    sub rsp, 32\n";  // Shadow space
+            // Arguments are evaluated left to right. Register arguments are
+            // pushed and popped into place just before the call, since
+            // evaluating a later argument may clobber earlier ones (div uses
+            // rdx, string concatenation uses rsi/rdi, ...). Stack arguments
+            // are stored straight into a reserved area above the shadow space.
+            const auto& regs = arg_registers();
+            size_t arg_count = node->children.size();
+            size_t reg_args = std::min(arg_count, regs.size());
+            int stack_args = static_cast<int>(arg_count - reg_args);
+            int reserved = shadow_space() + stack_args * 8;
+            if (reserved > 0) {
+                asm_code << "    sub rsp, " << reserved << "\n";
+            }
             
-            // Evaluate arguments and place them in registers/stack
-            for (size_t i = 0; i < node->children.size(); i++) {
+            for (size_t i = 0; i < arg_count; i++) {
                 generate_expression(node->children[i], asm_code, var_offsets);
                 
-                if (i == 0) {
-                    asm_code << "    mov rcx, rax\n";
-                } else if (i == 1) {
-                    asm_code << "    mov rdx, rax\n";
-                } else if (i == 2) {
-                    asm_code << "    mov r8, rax\n";
-                } else if (i == 3) {
-                    asm_code << "    mov r9, rax\n";
-                } else {
-                    // Push additional args onto stack (right-to-left)
+                if (i < regs.size()) {
                     asm_code << "    push rax\n";
+                } else {
+                    int slot = static_cast<int>(reg_args) * 8 + shadow_space() + static_cast<int>(i - regs.size()) * 8;
+                    asm_code << "    mov [rsp+" << slot << "], rax\n";
                 }
             }
+            for (size_t i = reg_args; i-- > 0;) {
+                asm_code << "    pop " << regs[i] << "\n";
+            }
             
             // Call the function
             asm_code << "    call " << func_name << "\n";
             
             // Clean up stack
-            asm_code << "    add rsp, 32\n";
-            
-            // Restore registers
-            asm_code << "    pop r9\n";
-            asm_code << "    pop r8\n";
-            asm_code << "    pop rdx\n";
-            asm_code << "    pop rcx\n";
+            if (reserved > 0) {
+                asm_code << "    add rsp, " << reserved << "\n";
+            }
             
             // Result is now in rax
             break;
@@ -1788,135 +1206,95 @@ void generate_expression(std::shared_ptr<ASTNode> node,
     }
 }
 
-// Generate code for a condition
-void generate_condition(std::shared_ptr<ASTNode> node,
-                       std::stringstream& asm_code,
-                       std::map<std::string, int>& var_offsets,
-                       int label,
-                       const std::string& label_prefix) {
-    if (!node) return;
+// Jump to target when the truth of node equals jump_when, else fall through.
+// and/or short-circuit; anything that isn't a comparison is true when non-zero.
+static void generate_branch(ASTNode* node,
+                            std::stringstream& asm_code,
+                            VarOffsets& var_offsets,
+                            const std::string& target,
+                            bool jump_when) {
+    if (node->type == NodeType::UnaryOp && static_cast<UnaryOpNode*>(node)->op == TokenType::_not) {
+        generate_branch(node->left, asm_code, var_offsets, target, !jump_when);
+        return;
+    }
     
     if (node->type == NodeType::BinaryOp) {
-        auto binOp = std::static_pointer_cast<BinaryOpNode>(node);
+        auto binOp = static_cast<BinaryOpNode*>(node);
         
-        // Handle logical operators (or/and)
-        if (binOp->op == TokenType::_or) {
-            // Short-circuit OR: if left is true, skip evaluation of right
-            // We need to invert the logic: jump to end only if BOTH conditions are false
-            auto leftBin = std::static_pointer_cast<BinaryOpNode>(binOp->left);
-            auto rightBin = std::static_pointer_cast<BinaryOpNode>(binOp->right);
-            
-            // Create a temporary label for "condition satisfied"
-            int temp_label = label + 2000;
-            
-            // Evaluate left condition - if TRUE, skip the jump to end
-            generate_expression(leftBin->left, asm_code, var_offsets);
-            asm_code << "    push rax\n";
-            generate_expression(leftBin->right, asm_code, var_offsets);
-            asm_code << "    mov rbx, rax\n";
-            asm_code << "    pop rax\n";
-            asm_code << "    cmp rax, rbx\n";
-            
-            // Jump past end-jump if left condition is TRUE
-            switch (leftBin->op) {
-                case TokenType::_lesser:
-                    asm_code << "    jl .or_satisfied_" << temp_label << "\n";
-                    break;
-                case TokenType::_greater:
-                    asm_code << "    jg .or_satisfied_" << temp_label << "\n";
-                    break;
-                case TokenType::_equals:
-                    asm_code << "    je .or_satisfied_" << temp_label << "\n";
-                    break;
-                case TokenType::_not_equals:
-                    asm_code << "    jne .or_satisfied_" << temp_label << "\n";
-                    break;
-                default:
-                    break;
-            }
-            
-            // Left was false, evaluate right condition
-            generate_expression(rightBin->left, asm_code, var_offsets);
-            asm_code << "    push rax\n";
-            generate_expression(rightBin->right, asm_code, var_offsets);
-            asm_code << "    mov rbx, rax\n";
-            asm_code << "    pop rax\n";
-            asm_code << "    cmp rax, rbx\n";
-            
-            // Jump to end if right condition is also FALSE
-            switch (rightBin->op) {
-                case TokenType::_lesser:
-                    asm_code << "    jge ." << label_prefix << "_end_" << label << "\n";
-                    break;
-                case TokenType::_greater:
-                    asm_code << "    jle ." << label_prefix << "_end_" << label << "\n";
-                    break;
-                case TokenType::_equals:
-                    asm_code << "    jne ." << label_prefix << "_end_" << label << "\n";
-                    break;
-                case TokenType::_not_equals:
-                    asm_code << "    je ." << label_prefix << "_end_" << label << "\n";
-                    break;
-                default:
-                    break;
+        if (binOp->op == TokenType::_and || binOp->op == TokenType::_or) {
+            // "a and b" jumps on false as soon as a is false, and "a or b"
+            // jumps on true as soon as a is true. The other way round the
+            // left side has to skip over the right one.
+            bool short_circuit = (binOp->op == TokenType::_or) == jump_when;
+            if (short_circuit) {
+                // A chain of the same operator leans left: take its operands
+                // in order by walking down it rather than recursing
+                std::vector<ASTNode*> rights;
+                ASTNode* first = binOp;
+                while (first->type == NodeType::BinaryOp && static_cast<BinaryOpNode*>(first)->op == binOp->op) {
+                    rights.push_back(first->right);
+                    first = first->left;
+                }
+                generate_branch(first, asm_code, var_offsets, target, jump_when);
+                for (auto it = rights.rbegin(); it != rights.rend(); ++it) {
+                    generate_branch(*it, asm_code, var_offsets, target, jump_when);
+                }
+            } else {
+                std::string skip = generate_label(binOp->op == TokenType::_and ? ".and_false_" : ".or_true_");
+                generate_branch(binOp->left, asm_code, var_offsets, skip, !jump_when);
+                generate_branch(binOp->right, asm_code, var_offsets, target, jump_when);
+                asm_code << skip << ":\n";
             }
-            
-            asm_code << ".or_satisfied_" << temp_label << ":\n";
-            return;
-        }
-        
-        if (binOp->op == TokenType::_and) {
-            // Short-circuit AND: if left is false, skip to end
-            int temp_label = label + 1000;
-            generate_expression(binOp->left, asm_code, var_offsets);
-            asm_code << "    test rax, rax\n";
-            asm_code << "    jz .and_false_" << temp_label << "\n";
-            generate_condition(binOp->right, asm_code, var_offsets, label, label_prefix);
-            asm_code << ".and_false_" << temp_label << ":\n";
             return;
         }
         
-        // Handle comparison operators
-        generate_expression(binOp->left, asm_code, var_offsets);
-        asm_code << "    push rax\n";
-        generate_expression(binOp->right, asm_code, var_offsets);
-        asm_code << "    mov rbx, rax\n";
-        asm_code << "    pop rax\n";
-        asm_code << "    cmp rax, rbx\n";
-        
-        // Jump to end if condition is FALSE
+        // Condition codes for the comparison being true and false
+        const char* when_true = nullptr;
+        const char* when_false = nullptr;
         switch (binOp->op) {
-            case TokenType::_lesser:
-                asm_code << "    jge ." << label_prefix << "_end_" << label << "\n";
-                break;
-            case TokenType::_greater:
-                asm_code << "    jle ." << label_prefix << "_end_" << label << "\n";
-                break;
-            case TokenType::_equals:
-                asm_code << "    jne ." << label_prefix << "_end_" << label << "\n";
-                break;
-            case TokenType::_not_equals:
-                asm_code << "    je ." << label_prefix << "_end_" << label << "\n";
-                break;
-            default:
-                break;
+            case TokenType::_lesser: when_true = "jl"; when_false = "jge"; break;
+            case TokenType::_greater: when_true = "jg"; when_false = "jle"; break;
+            case TokenType::_equals: when_true = "je"; when_false = "jne"; break;
+            case TokenType::_not_equals: when_true = "jne"; when_false = "je"; break;
+            default: break;
+        }
+        if (when_true) {
+            auto [left, right] = generate_operands(binOp->left, binOp->right, 0, asm_code, var_offsets);
+            asm_code << "    cmp " << left << ", " << right << "\n";
+            asm_code << "    " << (jump_when ? when_true : when_false) << " " << target << "\n";
+            return;
         }
     }
+    
+    generate_expression(node, asm_code, var_offsets);
+    asm_code << "    test rax, rax\n";
+    asm_code << "    " << (jump_when ? "jnz" : "jz") << " " << target << "\n";
+}
+
+// Generate code for a condition: jumps to .<label_prefix>_end_<label> when it
+// is false
+void generate_condition(ASTNode* node,
+                       std::stringstream& asm_code,
+                       VarOffsets& var_offsets,
+                       int label,
+                       const std::string& label_prefix) {
+    if (!node) return;
+    generate_branch(node, asm_code, var_offsets, "." + label_prefix + "_end_" + std::to_string(label), false);
 }
 
 // Helper function declarations (add these to gen_asm.h or at the top)
-void generate_node(std::shared_ptr<ASTNode> node, 
+void generate_node(ASTNode* node, 
                    std::stringstream& asm_code,
-                   std::map<std::string, int>& var_offsets,
+                   VarOffsets& var_offsets,
                    int& stack_offset,
                    int& label_counter);
 
-void generate_expression(std::shared_ptr<ASTNode> node,
+void generate_expression(ASTNode* node,
                         std::stringstream& asm_code,
-                        std::map<std::string, int>& var_offsets);
+                        VarOffsets& var_offsets);
 
-void generate_condition(std::shared_ptr<ASTNode> node,
+void generate_condition(ASTNode* node,
                        std::stringstream& asm_code,
-                       std::map<std::string, int>& var_offsets,
+                       VarOffsets& var_offsets,
                        int label);
 
@@ -7,13 +7,36 @@
 #include <vector>
 #include <memory>
 
-// Original function (keep for backward compatibility)
-std::string generate(std::vector<Token> tokens);
+// Output ABI and object format for the generated assembly
+enum class Target {
+    Win64,          // Windows x64 calling convention, nasm -f win64 / COFF
+    LinuxX86_64     // System V AMD64 ABI, nasm -f elf64 / ELF
+};
+
+// What a source file is compiled as
+enum class ModuleKind {
+    Program,        // defines main (and the heap imported modules share)
+    Library         // imported: functions only, exported by name
+};
 
 // New AST-based generator
-std::string generate_assembly_from_ast(std::shared_ptr<ASTNode> ast);
+// symbols names the identifiers in ast
+std::string generate_assembly_from_ast(ASTNode* ast, const SymbolTable& symbols,
+                                       Target target = Target::Win64,
+                                       ModuleKind kind = ModuleKind::Program);
+
+// Integer argument registers of target's calling convention, in order
+const std::vector<std::string>& argument_registers(Target target);
+
+// Bytes a caller reserves below its stack arguments (Win64 shadow space)
+int shadow_space_size(Target target);
+
+// True if node evaluates to a string, given which variables (by Symbol) hold
+// text
+bool is_string_expression(ASTNode* node, const std::vector<bool>& string_vars);
 
-// Helper for base-17 conversion
-int base17_to_decimal(const std::string& base17_str);
+// Freestanding runtime (_start, buffered putchar on the write syscall) that
+// replaces libc when the program is linked in-process
+std::string generate_runtime_asm(Target target);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,145 @@
+#ifndef IR_H
+#define IR_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "symbols.h"
+#include "gen_asm.h"
+
+struct ASTNode;
+
+// Typed SSA form between the AST and assembly (--backend=ir). A function is
+// a list of basic blocks; every instruction defines at most one value, named
+// by its index, and where control flow merges values that depend on the path
+// taken meet in phis at the top of a block.
+
+using IrValue = uint32_t;       // index into IrFunction::insts
+using IrBlockId = uint32_t;     // index into IrFunction::blocks
+inline constexpr uint32_t IR_NONE = UINT32_MAX;
+
+enum class IrType : uint8_t {
+    Void,       // no value
+    Bool,       // a comparison; only branched on
+    Int,        // 64-bit integer
+    Ptr         // address of a string or an array
+};
+
+enum class IrOp : uint8_t {
+    Const,          // imm
+    String,         // address of IrModule::strings[imm]
+    Param,          // the imm'th parameter
+    Phi,            // operands[i] when entered from the block's preds[i]
+    Add,
+    Sub,
+    Mul,
+    Div,            // unsigned
+    Rem,            // unsigned
+    Lt,             // signed, like the rest of the comparisons
+    Gt,
+    Eq,
+    Ne,
+    Alloc,          // operands[0] 8-byte elements from the heap
+    Load,           // element operands[1] of the array operands[0]
+    Store,          // element operands[1] of the array operands[0] = operands[2]
+    Concat,         // new string holding operands[0] then operands[1]
+    Call,           // callee(operands...)
+    PrintNumber,    // unsigned decimal and a newline
+    PrintString,    // the string and a newline
+
+    // Terminators: exactly one, at the end of every block
+    Jump,           // to targets[0]
+    Branch,         // to targets[0] if operands[0], else to targets[1]
+    Return          // operands[0]
+};
+
+struct IrInst {
+    IrOp op;
+    IrType type = IrType::Void;
+    IrBlockId block = IR_NONE;      // IR_NONE once the instruction is deleted
+    int64_t imm = 0;                // Const, String, Param
+    Symbol callee = NO_SYMBOL;      // Call
+    IrBlockId targets[2] = {IR_NONE, IR_NONE};
+    std::vector<IrValue> operands;
+};
+
+struct IrBlock {
+    std::vector<IrValue> insts;     // phis first, the terminator last
+    std::vector<IrBlockId> preds;   // one per incoming edge
+};
+
+struct IrFunction {
+    Symbol name = NO_SYMBOL;        // NO_SYMBOL for main
+    uint32_t param_count = 0;
+    std::vector<IrInst> insts;      // including deleted ones, so values stay put
+    std::vector<IrBlock> blocks;    // blocks[0] is the entry
+};
+
+struct IrModule {
+    ModuleKind kind = ModuleKind::Program;
+    bool imports = false;           // links with the modules it imports
+    std::vector<IrFunction> functions;  // in source order, then main for a Program
+    std::vector<std::string> strings;   // literals, each once
+};
+
+// Code lower_to_ir doesn't handle yet (a function declared inside a block, an
+// operator outside a condition, ...). The caller falls back to
+// generate_assembly_from_ast.
+class IrUnsupported : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+};
+
+// Lower a parsed module. Every block is reachable from the entry, blocks are
+// laid out in reverse postorder, no edge runs from a block with two
+// successors to one with two predecessors, and phis that would only forward
+// one value are removed. Throws std::runtime_error for the same errors as
+// generate_assembly_from_ast.
+IrModule lower_to_ir(ASTNode* ast, const SymbolTable& symbols, ModuleKind kind);
+
+// Check the invariants above, and that operands are live values defined
+// before use within a block. Throws std::logic_error naming the first
+// violation.
+void verify_ir(const IrFunction& function);
+
+// Blocks a block's terminator can transfer control to
+inline std::vector<IrBlockId> ir_successors(const IrFunction& function, IrBlockId block) {
+    const IrInst& last = function.insts[function.blocks[block].insts.back()];
+    if (last.op == IrOp::Jump) return {last.targets[0]};
+    if (last.op == IrOp::Branch) return {last.targets[0], last.targets[1]};
+    return {};
+}
+
+// Where a value lives while it is live
+struct IrLocation {
+    enum class Kind : uint8_t {
+        None,       // no home: a constant or string address, made where it is used
+        Register,   // index is the register's number in the x86 encoding (0 rax .. 15 r15)
+        Stack       // index is a spill slot, counted from 0
+    };
+    Kind kind = Kind::None;
+    int index = 0;
+};
+
+struct IrAllocation {
+    std::vector<IrLocation> locations;  // by value
+    // By value: a comparison only used by the branch right after it, which
+    // sets the flags for that branch instead of making a value
+    std::vector<bool> fused;
+    std::vector<int> saved_registers;   // callee-saved registers used, in save order
+    int spill_slots = 0;
+};
+
+// Linear-scan register allocation (Poletto and Sarkar) over live intervals
+// in block layout order. rax, rcx and rdx are left to instruction selection.
+// A value live across a call gets a callee-saved register or a spill slot;
+// when registers run out, the interval that ends furthest away is spilled.
+IrAllocation allocate_registers(const IrFunction& function, Target target);
+
+// NASM source for module, with the same layout and linkage as
+// generate_assembly_from_ast produces for the same code
+std::string generate_assembly_from_ir(const IrModule& module, const SymbolTable& symbols,
+                                      Target target = Target::Win64);
+
+#endif //IR_H
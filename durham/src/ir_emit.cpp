@@ -0,0 +1,619 @@
+#include "main.h"
+#include "ir.h"
+#include <algorithm>
+
+// Instruction selection from the IR, over the homes allocate_registers gives
+// values: a register, or a spill slot below the saved registers. rax, rcx
+// and rdx are scratch. Phis become a parallel copy at the end of each
+// predecessor (edges into a merge never leave a branch, so those always end
+// in a jump).
+
+static const char* const REGISTER_NAMES[16] = {
+    "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+    "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"
+};
+
+static int register_number(const std::string& name) {
+    return static_cast<int>(std::find(REGISTER_NAMES, REGISTER_NAMES + 16, name) - REGISTER_NAMES);
+}
+
+static int align16(int bytes) {
+    return (bytes + 15) & ~15;
+}
+
+static bool fits_int32(int64_t value) {
+    return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+static const char* condition_code(IrOp op, bool negate) {
+    switch (op) {
+        case IrOp::Lt: return negate ? "ge" : "l";
+        case IrOp::Gt: return negate ? "le" : "g";
+        case IrOp::Eq: return negate ? "ne" : "e";
+        default: return negate ? "e" : "ne";
+    }
+}
+
+// Where an instruction reads or writes a value
+struct Place {
+    enum class Kind { Register, Memory, Immediate, Address };
+    Kind kind;
+    std::string text;       // as written in an operand
+    int64_t imm = 0;        // Immediate
+
+    bool operator==(const Place& other) const { return kind == other.kind && text == other.text; }
+};
+
+static Place register_place(int reg) {
+    return {Place::Kind::Register, REGISTER_NAMES[reg]};
+}
+
+// Runtime helpers a module calls, emitted once each after its functions
+struct Helpers {
+    bool print_number = false;
+    bool print_string = false;
+    bool concat = false;
+};
+
+class FunctionEmitter {
+    public:
+        FunctionEmitter(const IrFunction& function, const SymbolTable& symbols, Target target,
+                        Helpers& helpers, std::stringstream& out);
+        void emit();
+
+    private:
+        using Moves = std::vector<std::pair<Place, Place>>;    // destination, source
+
+        const IrFunction& function;
+        const SymbolTable& symbols;
+        Target target;
+        Helpers& helpers;
+        std::stringstream& out;
+        IrAllocation allocation;
+        int saved_size = 0;             // bytes of callee-saved registers below rbp
+
+        std::string label(IrBlockId block) const { return ".b" + std::to_string(block); }
+        Place argument(size_t index) const { return register_place(register_number(argument_registers(target)[index])); }
+        Place place(IrValue value) const;
+        void load(const std::string& reg, const Place& source);
+        std::string source(const Place& place, const std::string& scratch);
+        std::string element(const Place& array, const Place& index);
+        void move(const Place& destination, const Place& source);
+        void emitMoves(Moves moves);
+        void emitInst(IrBlockId block, IrValue value);
+        void emitArithmetic(const IrInst& inst, const Place& destination);
+        void emitPhiCopies(IrBlockId from, IrBlockId to);
+        void emitCall(const IrInst& inst);
+        void emitEpilogue();
+};
+
+FunctionEmitter::FunctionEmitter(const IrFunction& function, const SymbolTable& symbols, Target target,
+                                 Helpers& helpers, std::stringstream& out)
+    : function(function), symbols(symbols), target(target), helpers(helpers), out(out),
+      allocation(allocate_registers(function, target)),
+      saved_size(8 * static_cast<int>(allocation.saved_registers.size())) {}
+
+Place FunctionEmitter::place(IrValue value) const {
+    const IrInst& inst = function.insts[value];
+    if (inst.op == IrOp::Const) return {Place::Kind::Immediate, std::to_string(inst.imm), inst.imm};
+    if (inst.op == IrOp::String) return {Place::Kind::Address, "[rel str_" + std::to_string(inst.imm) + "]"};
+    const IrLocation& location = allocation.locations[value];
+    if (location.kind == IrLocation::Kind::Register) return register_place(location.index);
+    return {Place::Kind::Memory, "qword [rbp-" + std::to_string(saved_size + 8 * (location.index + 1)) + "]"};
+}
+
+void FunctionEmitter::load(const std::string& reg, const Place& source) {
+    if (source.kind == Place::Kind::Register && source.text == reg) return;
+    out << "    " << (source.kind == Place::Kind::Address ? "lea " : "mov ") << reg << ", " << source.text << "\n";
+}
+
+// The place as the second operand of an ALU instruction, loaded into scratch
+// if it can't be one
+std::string FunctionEmitter::source(const Place& place, const std::string& scratch) {
+    if (place.kind == Place::Kind::Register || place.kind == Place::Kind::Memory) return place.text;
+    if (place.kind == Place::Kind::Immediate && fits_int32(place.imm)) return place.text;
+    load(scratch, place);
+    return scratch;
+}
+
+// Memory operand for an array element, with the base in a register (rax if
+// it isn't in one) and the index scaled, or folded in when it is a constant
+std::string FunctionEmitter::element(const Place& array, const Place& index) {
+    std::string base = array.text;
+    if (array.kind != Place::Kind::Register) {
+        load("rax", array);
+        base = "rax";
+    }
+    if (index.kind == Place::Kind::Immediate && fits_int32(index.imm) && fits_int32(index.imm * 8)) {
+        int64_t offset = index.imm * 8;
+        if (offset == 0) return "qword [" + base + "]";
+        return "qword [" + base + (offset < 0 ? " - " : " + ") + std::to_string(offset < 0 ? -offset : offset) + "]";
+    }
+    std::string scaled = index.text;
+    if (index.kind != Place::Kind::Register) {
+        load("rcx", index);
+        scaled = "rcx";
+    }
+    return "qword [" + base + " + " + scaled + "*8]";
+}
+
+void FunctionEmitter::move(const Place& destination, const Place& source) {
+    if (destination == source) return;
+    if (destination.kind == Place::Kind::Register) {
+        load(destination.text, source);
+    } else if (source.kind == Place::Kind::Register ||
+               (source.kind == Place::Kind::Immediate && fits_int32(source.imm))) {
+        out << "    mov " << destination.text << ", " << source.text << "\n";
+    } else {
+        load("rax", source);
+        out << "    mov " << destination.text << ", rax\n";
+    }
+}
+
+// Perform the moves as if at once: a move goes once nothing else still has to
+// read its destination, and a cycle is broken by setting one source aside on
+// the stack until the rest are done
+void FunctionEmitter::emitMoves(Moves moves) {
+    moves.erase(std::remove_if(moves.begin(), moves.end(),
+                               [](const auto& move) { return move.first == move.second; }),
+                moves.end());
+    std::vector<Place> set_aside;
+    while (!moves.empty()) {
+        size_t ready = 0;
+        for (; ready < moves.size(); ready++) {
+            bool read = false;
+            for (size_t other = 0; other < moves.size() && !read; other++) {
+                read = other != ready && moves[other].second == moves[ready].first;
+            }
+            if (!read) break;
+        }
+        if (ready == moves.size()) {
+            // Only cycles are left, and those only move between registers and slots
+            out << "    push " << moves[0].second.text << "\n";
+            set_aside.push_back(moves[0].first);
+            moves.erase(moves.begin());
+            continue;
+        }
+        move(moves[ready].first, moves[ready].second);
+        moves.erase(moves.begin() + static_cast<std::ptrdiff_t>(ready));
+    }
+    for (auto it = set_aside.rbegin(); it != set_aside.rend(); ++it) {
+        out << "    pop " << it->text << "\n";
+    }
+}
+
+void FunctionEmitter::emit() {
+    bool is_main = function.name == NO_SYMBOL;
+    std::string name = is_main ? "main" : std::string(symbols.name(function.name));
+    out << "\n; Function: " << name << "\n";
+    out << name << ":\n";
+    out << "    push rbp\n";
+    out << "    mov rbp, rsp\n";
+    for (int reg : allocation.saved_registers) {
+        out << "    push " << REGISTER_NAMES[reg] << "\n";
+    }
+    // Keep rsp 16-byte aligned below the saved registers and spill slots
+    int frame_size = align16(saved_size + 8 * allocation.spill_slots) - saved_size;
+    if (frame_size > 0) {
+        out << "    sub rsp, " << frame_size << "\n";
+    }
+
+    // Register parameters arrive in order; the rest were stored by the caller
+    // above the return address (and shadow space)
+    Moves parameters;
+    size_t register_count = argument_registers(target).size();
+    for (IrValue value : function.blocks[0].insts) {
+        const IrInst& inst = function.insts[value];
+        if (inst.op != IrOp::Param || allocation.locations[value].kind == IrLocation::Kind::None) continue;
+        size_t index = static_cast<size_t>(inst.imm);
+        if (index < register_count) {
+            parameters.push_back({place(value), argument(index)});
+        } else {
+            int caller_slot = 16 + shadow_space_size(target) + static_cast<int>(index - register_count) * 8;
+            parameters.push_back({place(value), {Place::Kind::Memory, "qword [rbp+" + std::to_string(caller_slot) + "]"}});
+        }
+    }
+    emitMoves(parameters);
+
+    if (is_main) {
+        out << "    lea rax, [rel heap_space]\n";
+        out << "    mov [rel heap_ptr], rax\n";
+    }
+
+    for (IrBlockId block = 0; block < function.blocks.size(); block++) {
+        if (block > 0) out << label(block) << ":\n";
+        for (IrValue value : function.blocks[block].insts) {
+            emitInst(block, value);
+        }
+    }
+}
+
+void FunctionEmitter::emitEpilogue() {
+    if (saved_size == 0) {
+        out << "    mov rsp, rbp\n";
+    } else {
+        out << "    lea rsp, [rbp-" << saved_size << "]\n";
+        for (auto it = allocation.saved_registers.rbegin(); it != allocation.saved_registers.rend(); ++it) {
+            out << "    pop " << REGISTER_NAMES[*it] << "\n";
+        }
+    }
+    out << "    pop rbp\n";
+    out << "    ret\n";
+}
+
+void FunctionEmitter::emitInst(IrBlockId block, IrValue value) {
+    const IrInst& inst = function.insts[value];
+    const std::vector<IrValue>& ops = inst.operands;
+    IrBlockId next = block + 1;
+
+    switch (inst.op) {
+        case IrOp::Const:
+        case IrOp::String:
+            break;      // made where they are used
+
+        case IrOp::Param:
+            break;      // moved into place on entry
+
+        case IrOp::Phi:
+            break;      // copied into by the predecessors
+
+        case IrOp::Add:
+        case IrOp::Sub:
+        case IrOp::Mul:
+            emitArithmetic(inst, place(value));
+            break;
+
+        case IrOp::Div:
+        case IrOp::Rem: {
+            load("rax", place(ops[0]));
+            Place divisor = place(ops[1]);
+            if (divisor.kind != Place::Kind::Register) {
+                load("rcx", divisor);
+                divisor = register_place(1);
+            }
+            out << "    xor edx, edx\n";
+            out << "    div " << divisor.text << "\n";
+            move(place(value), register_place(inst.op == IrOp::Div ? 0 : 2));
+            break;
+        }
+
+        case IrOp::Lt:
+        case IrOp::Gt:
+        case IrOp::Eq:
+        case IrOp::Ne: {
+            Place left = place(ops[0]);
+            Place right = place(ops[1]);
+            std::string first = left.text;
+            if (left.kind != Place::Kind::Register &&
+                (left.kind != Place::Kind::Memory || right.kind == Place::Kind::Memory)) {
+                load("rax", left);
+                first = "rax";
+            }
+            std::string second = source(right, "rcx");
+            out << "    cmp " << first << ", " << second << "\n";
+            if (!allocation.fused[value]) {
+                out << "    set" << condition_code(inst.op, false) << " al\n";
+                out << "    movzx eax, al\n";
+                move(place(value), register_place(0));
+            }
+            break;
+        }
+
+        case IrOp::Alloc:
+            load("rax", place(ops[0]));
+            out << "    shl rax, 3\n";
+            out << "    mov rcx, [rel heap_ptr]\n";
+            move(place(value), register_place(1));
+            out << "    add rcx, rax\n";
+            out << "    mov [rel heap_ptr], rcx\n";
+            break;
+
+        case IrOp::Load: {
+            std::string address = element(place(ops[0]), place(ops[1]));
+            Place destination = place(value);
+            if (destination.kind == Place::Kind::Register) {
+                out << "    mov " << destination.text << ", " << address << "\n";
+            } else {
+                out << "    mov rax, " << address << "\n";
+                out << "    mov " << destination.text << ", rax\n";
+            }
+            break;
+        }
+
+        case IrOp::Store: {
+            std::string address = element(place(ops[0]), place(ops[1]));
+            Place stored = place(ops[2]);
+            std::string text = stored.text;
+            if (stored.kind != Place::Kind::Register &&
+                !(stored.kind == Place::Kind::Immediate && fits_int32(stored.imm))) {
+                load("rdx", stored);
+                text = "rdx";
+            }
+            out << "    mov " << address << ", " << text << "\n";
+            break;
+        }
+
+        case IrOp::Concat:
+            helpers.concat = true;
+            emitMoves({{argument(0), place(ops[0])}, {argument(1), place(ops[1])}});
+            out << "    call durham_concat\n";
+            move(place(value), register_place(0));
+            break;
+
+        case IrOp::Call:
+            emitCall(inst);
+            move(place(value), register_place(0));
+            break;
+
+        case IrOp::PrintNumber:
+        case IrOp::PrintString: {
+            bool number = inst.op == IrOp::PrintNumber;
+            (number ? helpers.print_number : helpers.print_string) = true;
+            emitMoves({{argument(0), place(ops[0])}});
+            out << "    call " << (number ? "durham_print_number" : "durham_print_string") << "\n";
+            break;
+        }
+
+        case IrOp::Jump:
+            emitPhiCopies(block, inst.targets[0]);
+            if (inst.targets[0] != next) {
+                out << "    jmp " << label(inst.targets[0]) << "\n";
+            }
+            break;
+
+        case IrOp::Branch: {
+            IrOp test = function.insts[ops[0]].op;
+            if (!allocation.fused[ops[0]]) {
+                Place condition = place(ops[0]);
+                if (condition.kind == Place::Kind::Register) {
+                    out << "    test " << condition.text << ", " << condition.text << "\n";
+                } else if (condition.kind == Place::Kind::Memory) {
+                    out << "    cmp " << condition.text << ", 0\n";
+                } else {
+                    load("rax", condition);
+                    out << "    test rax, rax\n";
+                }
+                test = IrOp::Ne;
+            }
+            IrBlockId if_true = inst.targets[0];
+            IrBlockId if_false = inst.targets[1];
+            if (if_true == next) {
+                out << "    j" << condition_code(test, true) << " " << label(if_false) << "\n";
+            } else {
+                out << "    j" << condition_code(test, false) << " " << label(if_true) << "\n";
+                if (if_false != next) {
+                    out << "    jmp " << label(if_false) << "\n";
+                }
+            }
+            break;
+        }
+
+        case IrOp::Return:
+            load("rax", place(ops[0]));
+            emitEpilogue();
+            break;
+    }
+}
+
+// Add, Sub or Mul into the destination's register when it has one, with the
+// operands ordered so the first is already there when that is allowed
+void FunctionEmitter::emitArithmetic(const IrInst& inst, const Place& destination) {
+    Place left = place(inst.operands[0]);
+    Place right = place(inst.operands[1]);
+    bool commutative = inst.op != IrOp::Sub;
+    if (commutative && (right == destination ||
+                        (left.kind == Place::Kind::Immediate && right.kind != Place::Kind::Immediate))) {
+        std::swap(left, right);
+    }
+    std::string result = destination.text;
+    if (destination.kind != Place::Kind::Register || (right == destination && !(left == destination))) {
+        result = "rax";
+    }
+
+    if (inst.op == IrOp::Mul && right.kind == Place::Kind::Immediate && fits_int32(right.imm) &&
+        (left.kind == Place::Kind::Register || left.kind == Place::Kind::Memory)) {
+        out << "    imul " << result << ", " << left.text << ", " << right.imm << "\n";
+    } else {
+        const char* mnemonic = inst.op == IrOp::Add ? "add" : inst.op == IrOp::Sub ? "sub" : "imul";
+        load(result, left);
+        std::string operand = source(right, "rcx");
+        out << "    " << mnemonic << " " << result << ", " << operand << "\n";
+    }
+    if (result != destination.text) {
+        out << "    mov " << destination.text << ", " << result << "\n";
+    }
+}
+
+// Set to's phis to their values for the edge from `from`
+void FunctionEmitter::emitPhiCopies(IrBlockId from, IrBlockId to) {
+    const IrBlock& target_block = function.blocks[to];
+    size_t edge = std::find(target_block.preds.begin(), target_block.preds.end(), from) - target_block.preds.begin();
+    Moves copies;
+    for (IrValue value : target_block.insts) {
+        const IrInst& phi = function.insts[value];
+        if (phi.op != IrOp::Phi) break;
+        if (allocation.locations[value].kind == IrLocation::Kind::None) continue;
+        copies.push_back({place(value), place(phi.operands[edge])});
+    }
+    emitMoves(copies);
+}
+
+// Arguments beyond the registers go above the shadow space, in an area
+// rounded up to keep rsp 16-byte aligned at the call
+void FunctionEmitter::emitCall(const IrInst& inst) {
+    size_t arg_count = inst.operands.size();
+    size_t reg_args = std::min(arg_count, argument_registers(target).size());
+    int shadow = shadow_space_size(target);
+    int reserved = align16(shadow + static_cast<int>(arg_count - reg_args) * 8);
+    if (reserved > 0) {
+        out << "    sub rsp, " << reserved << "\n";
+    }
+    for (size_t i = reg_args; i < arg_count; i++) {
+        std::string slot = "qword [rsp+" + std::to_string(shadow + static_cast<int>(i - reg_args) * 8) + "]";
+        move({Place::Kind::Memory, slot}, place(inst.operands[i]));
+    }
+    Moves arguments;
+    for (size_t i = 0; i < reg_args; i++) {
+        arguments.push_back({argument(i), place(inst.operands[i])});
+    }
+    emitMoves(arguments);
+    out << "    call " << symbols.name(inst.callee) << "\n";
+    if (reserved > 0) {
+        out << "    add rsp, " << reserved << "\n";
+    }
+}
+
+static std::string putchar_call(Target target) {
+    return target == Target::LinuxX86_64 ? "    call putchar wrt ..plt\n" : "    call putchar\n";
+}
+
+// The helpers are called with rsp 16-byte aligned and only use registers the
+// caller doesn't expect to keep, so they follow either calling convention
+
+// Print the first argument as an unsigned decimal, then a newline
+static void emit_print_number_helper(std::stringstream& out, Target target) {
+    const std::string& arg = argument_registers(target)[0];
+    out << "durham_print_number:\n";
+    out << "    push rbp\n";
+    out << "    mov rbp, rsp\n";
+    out << "    sub rsp, " << 48 + shadow_space_size(target) << "\n";   // digits at rbp-32, count at rbp-40
+    out << "    mov rax, " << arg << "\n";
+    out << "    xor ecx, ecx\n";
+    out << "    mov r8, 10\n";
+    out << ".digit:\n";
+    out << "    xor edx, edx\n";
+    out << "    div r8\n";
+    out << "    add dl, '0'\n";
+    out << "    mov [rbp + rcx - 32], dl\n";
+    out << "    inc rcx\n";
+    out << "    test rax, rax\n";
+    out << "    jnz .digit\n";
+    out << "    mov [rbp-40], rcx\n";
+    out << ".print:\n";
+    out << "    mov rcx, [rbp-40]\n";
+    out << "    dec rcx\n";
+    out << "    mov [rbp-40], rcx\n";
+    out << "    movzx " << arg << ", byte [rbp + rcx - 32]\n";
+    out << putchar_call(target);
+    out << "    cmp qword [rbp-40], 0\n";
+    out << "    jne .print\n";
+    out << "    mov " << arg << ", 10\n";
+    out << putchar_call(target);
+    out << "    mov rsp, rbp\n";
+    out << "    pop rbp\n";
+    out << "    ret\n\n";
+}
+
+// Print the NUL-terminated string the first argument addresses, then a newline
+static void emit_print_string_helper(std::stringstream& out, Target target) {
+    const std::string& arg = argument_registers(target)[0];
+    out << "durham_print_string:\n";
+    out << "    push rbp\n";
+    out << "    mov rbp, rsp\n";
+    out << "    sub rsp, " << 16 + shadow_space_size(target) << "\n";   // pointer at rbp-8
+    out << "    mov [rbp-8], " << arg << "\n";
+    out << ".next:\n";
+    out << "    mov rax, [rbp-8]\n";
+    out << "    movzx " << arg << ", byte [rax]\n";
+    out << "    test " << arg << ", " << arg << "\n";
+    out << "    jz .done\n";
+    out << "    inc rax\n";
+    out << "    mov [rbp-8], rax\n";
+    out << putchar_call(target);
+    out << "    jmp .next\n";
+    out << ".done:\n";
+    out << "    mov " << arg << ", 10\n";
+    out << putchar_call(target);
+    out << "    mov rsp, rbp\n";
+    out << "    pop rbp\n";
+    out << "    ret\n\n";
+}
+
+// A new heap string holding the first argument's string then the second's
+static void emit_concat_helper(std::stringstream& out, Target target) {
+    const auto& args = argument_registers(target);
+    out << "durham_concat:\n";
+    out << "    mov r8, " << args[0] << "\n";
+    out << "    mov r9, " << args[1] << "\n";
+    out << "    mov rax, [rel heap_ptr]\n";
+    out << "    mov r10, rax\n";
+    out << ".left:\n";
+    out << "    movzx ecx, byte [r8]\n";
+    out << "    test ecx, ecx\n";
+    out << "    jz .right\n";
+    out << "    mov [rax], cl\n";
+    out << "    inc r8\n";
+    out << "    inc rax\n";
+    out << "    jmp .left\n";
+    out << ".right:\n";
+    out << "    movzx ecx, byte [r9]\n";
+    out << "    mov [rax], cl\n";
+    out << "    inc r9\n";
+    out << "    inc rax\n";
+    out << "    test ecx, ecx\n";
+    out << "    jnz .right\n";
+    out << "    mov [rel heap_ptr], rax\n";
+    out << "    mov rax, r10\n";
+    out << "    ret\n\n";
+}
+
+std::string generate_assembly_from_ir(const IrModule& module, const SymbolTable& symbols, Target target) {
+    std::stringstream asm_code;
+    bool linked = module.imports || module.kind == ModuleKind::Library;
+
+    asm_code << "section .data\n";
+    for (size_t i = 0; i < module.strings.size(); i++) {
+        asm_code << "    str_" << i << " db \"" << module.strings[i] << "\", 0\n";
+    }
+    asm_code << "\n";
+
+    asm_code << "section .bss\n";
+    if (module.kind == ModuleKind::Program) {
+        asm_code << "    heap_space resb 8192\n";
+        asm_code << "    heap_ptr resq 1\n";
+    }
+    asm_code << "\n";
+
+    asm_code << "section .text\n";
+    if (module.kind == ModuleKind::Program) {
+        asm_code << "    global main\n";
+    }
+    asm_code << "    extern putchar\n";
+    if (linked) {
+        asm_code << (module.kind == ModuleKind::Program ? "    global heap_ptr\n" : "    extern heap_ptr\n");
+        std::vector<bool> defined(symbols.size(), false);
+        std::vector<bool> called(symbols.size(), false);
+        for (const IrFunction& function : module.functions) {
+            if (function.name == NO_SYMBOL) continue;
+            asm_code << "    global " << symbols.name(function.name) << "\n";
+            defined[function.name] = true;
+        }
+        for (const IrFunction& function : module.functions) {
+            for (const IrBlock& block : function.blocks) {
+                for (IrValue value : block.insts) {
+                    if (function.insts[value].op == IrOp::Call) called[function.insts[value].callee] = true;
+                }
+            }
+        }
+        for (Symbol symbol = 0; symbol < symbols.size(); symbol++) {
+            if (called[symbol] && !defined[symbol]) {
+                asm_code << "    extern " << symbols.name(symbol) << "\n";
+            }
+        }
+    }
+
+    Helpers helpers;
+    for (const IrFunction& function : module.functions) {
+        FunctionEmitter(function, symbols, target, helpers, asm_code).emit();
+    }
+    asm_code << "\n";
+    if (helpers.print_number) emit_print_number_helper(asm_code, target);
+    if (helpers.print_string) emit_print_string_helper(asm_code, target);
+    if (helpers.concat) emit_concat_helper(asm_code, target);
+
+    // ELF: mark the stack non-executable so the linker doesn't warn
+    if (target == Target::LinuxX86_64) {
+        asm_code << "section .note.GNU-stack noalloc noexec nowrite progbits\n";
+    }
+    return asm_code.str();
+}
@@ -0,0 +1,856 @@
+#include "main.h"
+#include "ir.h"
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+
+static bool is_terminator(IrOp op) {
+    return op == IrOp::Jump || op == IrOp::Branch || op == IrOp::Return;
+}
+
+// Lowers one function. SSA form is built on the fly as in Braun et al.,
+// "Simple and Efficient Construction of Static Single Assignment Form": each
+// block records the current value of the variables assigned in it, a read
+// with no assignment in its block asks the predecessors (through a phi when
+// there are several), and a block that may still gain predecessors (a loop
+// header, until the back edge) gets placeholder phis that are completed when
+// it is sealed.
+class FunctionLowering {
+    public:
+        // string_vars and string_ids are shared by the module's functions:
+        // like the AST generator, a variable assigned text anywhere earlier in
+        // the module prints as a string
+        FunctionLowering(IrModule& module, IrFunction& function, const SymbolTable& symbols,
+                         std::vector<bool>& string_vars,
+                         std::unordered_map<std::string, int64_t>& string_ids);
+
+        void lowerFunction(FunctionDeclNode* node);
+        // The statements of program other than function declarations
+        void lowerMain(ASTNode* program);
+
+    private:
+        IrModule& module;
+        IrFunction& function;
+        const SymbolTable& symbols;
+        std::vector<bool>& string_vars;
+        std::unordered_map<std::string, int64_t>& string_ids;
+
+        IrBlockId current;                  // never terminated between statements
+        std::vector<bool> assigned;         // by Symbol: assigned somewhere earlier
+        IrValue undef = IR_NONE;            // stands in for a variable read before it is set
+
+        // Per block
+        std::vector<std::unordered_map<Symbol, IrValue>> defs;
+        std::vector<bool> sealed;
+        std::vector<std::vector<std::pair<Symbol, IrValue>>> incomplete;
+
+        IrBlockId newBlock();
+        IrValue append(IrBlockId block, IrOp op, IrType type, std::vector<IrValue> operands = {},
+                       int64_t imm = 0);
+        IrValue emit(IrOp op, IrType type, std::vector<IrValue> operands = {}, int64_t imm = 0);
+        IrValue constant(int64_t value);
+        IrValue stringLiteral(const std::string& text);
+        void jump(IrBlockId target);
+        void branch(IrValue condition, IrBlockId if_true, IrBlockId if_false);
+        void ret(IrValue value);
+
+        void writeVariable(Symbol var, IrBlockId block, IrValue value);
+        IrValue readVariable(Symbol var, IrBlockId block);
+        IrValue readVariableRecursive(Symbol var, IrBlockId block);
+        void addPhiOperands(Symbol var, IrValue phi);
+        void sealBlock(IrBlockId block);
+        IrValue undefined();
+
+        void lowerStatement(ASTNode* node);
+        void lowerLoop(ASTNode* condition, ASTNode* body, ASTNode* increment);
+        void lowerBranch(ASTNode* node, IrBlockId if_true, IrBlockId if_false);
+        IrValue lowerExpression(ASTNode* node);
+        IrValue lowerConcat(ASTNode* node);
+        IrValue lowerConcatOperand(ASTNode* node);
+        std::string name(Symbol symbol) const { return std::string(symbols.name(symbol)); }
+};
+
+FunctionLowering::FunctionLowering(IrModule& module, IrFunction& function, const SymbolTable& symbols,
+                                   std::vector<bool>& string_vars,
+                                   std::unordered_map<std::string, int64_t>& string_ids)
+    : module(module), function(function), symbols(symbols), string_vars(string_vars),
+      string_ids(string_ids), assigned(symbols.size(), false) {
+    current = newBlock();
+    sealed[current] = true;
+}
+
+IrBlockId FunctionLowering::newBlock() {
+    function.blocks.emplace_back();
+    defs.emplace_back();
+    sealed.push_back(false);
+    incomplete.emplace_back();
+    return static_cast<IrBlockId>(function.blocks.size() - 1);
+}
+
+IrValue FunctionLowering::append(IrBlockId block, IrOp op, IrType type, std::vector<IrValue> operands,
+                                 int64_t imm) {
+    IrInst inst;
+    inst.op = op;
+    inst.type = type;
+    inst.block = block;
+    inst.imm = imm;
+    inst.operands = std::move(operands);
+    IrValue value = static_cast<IrValue>(function.insts.size());
+    function.insts.push_back(std::move(inst));
+    std::vector<IrValue>& insts = function.blocks[block].insts;
+    if (op == IrOp::Phi) {
+        insts.insert(insts.begin(), value);
+    } else {
+        insts.push_back(value);
+    }
+    return value;
+}
+
+IrValue FunctionLowering::emit(IrOp op, IrType type, std::vector<IrValue> operands, int64_t imm) {
+    return append(current, op, type, std::move(operands), imm);
+}
+
+IrValue FunctionLowering::constant(int64_t value) {
+    return emit(IrOp::Const, IrType::Int, {}, value);
+}
+
+IrValue FunctionLowering::stringLiteral(const std::string& text) {
+    auto [it, inserted] = string_ids.try_emplace(text, static_cast<int64_t>(module.strings.size()));
+    if (inserted) module.strings.push_back(text);
+    return emit(IrOp::String, IrType::Ptr, {}, it->second);
+}
+
+void FunctionLowering::jump(IrBlockId target) {
+    IrValue value = emit(IrOp::Jump, IrType::Void);
+    function.insts[value].targets[0] = target;
+    function.blocks[target].preds.push_back(current);
+}
+
+void FunctionLowering::branch(IrValue condition, IrBlockId if_true, IrBlockId if_false) {
+    IrValue value = emit(IrOp::Branch, IrType::Void, {condition});
+    function.insts[value].targets[0] = if_true;
+    function.insts[value].targets[1] = if_false;
+    function.blocks[if_true].preds.push_back(current);
+    function.blocks[if_false].preds.push_back(current);
+}
+
+// Anything lowered after a return goes to a block nothing jumps to, which
+// is dropped once the function is done
+void FunctionLowering::ret(IrValue value) {
+    emit(IrOp::Return, IrType::Void, {value});
+    current = newBlock();
+    sealed[current] = true;
+}
+
+void FunctionLowering::writeVariable(Symbol var, IrBlockId block, IrValue value) {
+    defs[block][var] = value;
+}
+
+IrValue FunctionLowering::readVariable(Symbol var, IrBlockId block) {
+    auto it = defs[block].find(var);
+    if (it != defs[block].end()) return it->second;
+    return readVariableRecursive(var, block);
+}
+
+IrValue FunctionLowering::readVariableRecursive(Symbol var, IrBlockId block) {
+    IrValue value;
+    size_t pred_count = function.blocks[block].preds.size();
+    if (!sealed[block]) {
+        value = append(block, IrOp::Phi, IrType::Int);
+        incomplete[block].push_back({var, value});
+    } else if (pred_count == 0) {
+        value = undefined();
+    } else if (pred_count == 1) {
+        value = readVariable(var, function.blocks[block].preds[0]);
+    } else {
+        // Recorded before the operands are read, so a loop back to this
+        // block finds the phi instead of making another
+        value = append(block, IrOp::Phi, IrType::Int);
+        writeVariable(var, block, value);
+        addPhiOperands(var, value);
+    }
+    writeVariable(var, block, value);
+    return value;
+}
+
+void FunctionLowering::addPhiOperands(Symbol var, IrValue phi) {
+    IrBlockId block = function.insts[phi].block;
+    for (size_t i = 0; i < function.blocks[block].preds.size(); i++) {
+        IrValue operand = readVariable(var, function.blocks[block].preds[i]);
+        function.insts[phi].operands.push_back(operand);
+    }
+}
+
+void FunctionLowering::sealBlock(IrBlockId block) {
+    auto pending = std::move(incomplete[block]);
+    incomplete[block].clear();
+    sealed[block] = true;
+    for (auto [var, phi] : pending) {
+        addPhiOperands(var, phi);
+    }
+}
+
+// The AST generator reads whatever the variable's frame slot holds; here it
+// is 0
+IrValue FunctionLowering::undefined() {
+    if (undef == IR_NONE) {
+        IrInst inst;
+        inst.op = IrOp::Const;
+        inst.type = IrType::Int;
+        inst.block = 0;
+        undef = static_cast<IrValue>(function.insts.size());
+        function.insts.push_back(inst);
+        function.blocks[0].insts.insert(function.blocks[0].insts.begin(), undef);
+    }
+    return undef;
+}
+
+void FunctionLowering::lowerFunction(FunctionDeclNode* node) {
+    function.name = node->functionName;
+    function.param_count = static_cast<uint32_t>(node->parameters.size());
+    for (size_t i = 0; i < node->parameters.size(); i++) {
+        Symbol parameter = node->parameters[i];
+        writeVariable(parameter, current, emit(IrOp::Param, IrType::Int, {}, static_cast<int64_t>(i)));
+        assigned[parameter] = true;
+    }
+    lowerStatement(node->body);
+    ret(constant(0));   // falling off the end returns 0
+}
+
+void FunctionLowering::lowerMain(ASTNode* program) {
+    if (program->type == NodeType::Program) {
+        for (ASTNode* child : program->children) {
+            if (child->type != NodeType::FunctionDecl) lowerStatement(child);
+        }
+    } else {
+        lowerStatement(program);
+    }
+    ret(constant(0));
+}
+
+void FunctionLowering::lowerStatement(ASTNode* node) {
+    if (!node) return;
+
+    switch (node->type) {
+        case NodeType::Program:
+        case NodeType::Block: {
+            for (ASTNode* child : node->children) {
+                lowerStatement(child);
+            }
+            break;
+        }
+
+        case NodeType::Assignment: {
+            auto assignNode = static_cast<AssignmentNode*>(node);
+            Symbol var = assignNode->varName;
+            if (assignNode->left && assignNode->left->type == NodeType::ArrayAccess) {
+                auto accessNode = static_cast<ArrayAccessNode*>(assignNode->left);
+                IrValue array = readVariable(accessNode->arrayName, current);
+                IrValue index = lowerExpression(accessNode->index);
+                IrValue value = lowerExpression(assignNode->right);
+                emit(IrOp::Store, IrType::Void, {array, index, value});
+            } else if (assignNode->varType == "text") {
+                // Marked before the value is lowered, as the AST generator does
+                assigned[var] = true;
+                string_vars[var] = true;
+                IrValue value = assignNode->right->type == NodeType::StringLiteral
+                    ? stringLiteral(assignNode->right->value.value())
+                    : lowerExpression(assignNode->right);
+                writeVariable(var, current, value);
+            } else {
+                assigned[var] = true;
+                writeVariable(var, current, lowerExpression(assignNode->right));
+            }
+            break;
+        }
+
+        case NodeType::Print: {
+            if (node->value.has_value()) {
+                emit(IrOp::PrintString, IrType::Void, {stringLiteral(node->value.value())});
+            } else if (node->left && node->left->type == NodeType::Identifier && string_vars[node->left->symbol]) {
+                emit(IrOp::PrintString, IrType::Void, {readVariable(node->left->symbol, current)});
+            } else if (node->left && node->left->type != NodeType::Identifier &&
+                       is_string_expression(node->left, string_vars)) {
+                emit(IrOp::PrintString, IrType::Void, {lowerExpression(node->left)});
+            } else {
+                emit(IrOp::PrintNumber, IrType::Void, {lowerExpression(node->left)});
+            }
+            break;
+        }
+
+        case NodeType::IfStatement: {
+            auto ifNode = static_cast<IfNode*>(node);
+            IrBlockId then_block = newBlock();
+            IrBlockId else_block = ifNode->elseBranch ? newBlock() : IR_NONE;
+            IrBlockId end = newBlock();
+            lowerBranch(ifNode->condition, then_block, ifNode->elseBranch ? else_block : end);
+            sealBlock(then_block);
+
+            current = then_block;
+            lowerStatement(ifNode->thenBranch);
+            jump(end);
+
+            if (ifNode->elseBranch) {
+                sealBlock(else_block);
+                current = else_block;
+                lowerStatement(ifNode->elseBranch);
+                jump(end);
+            }
+            sealBlock(end);
+            current = end;
+            break;
+        }
+
+        case NodeType::WhileLoop: {
+            auto whileNode = static_cast<WhileNode*>(node);
+            lowerLoop(whileNode->condition, whileNode->body, nullptr);
+            break;
+        }
+
+        case NodeType::ForLoop: {
+            auto forNode = static_cast<ForNode*>(node);
+            lowerStatement(forNode->init);
+            lowerLoop(forNode->condition, forNode->body, forNode->increment);
+            break;
+        }
+
+        case NodeType::FunctionDecl:
+            throw IrUnsupported("function declared inside a block");
+
+        case NodeType::Return: {
+            auto returnNode = static_cast<ReturnNode*>(node);
+            ret(returnNode->returnValue ? lowerExpression(returnNode->returnValue) : constant(0));
+            break;
+        }
+
+        case NodeType::FunctionCall:
+            lowerExpression(node);
+            break;
+
+        default:
+            break;
+    }
+}
+
+// The condition is tested at the top; the header is sealed once the body has
+// jumped back to it
+void FunctionLowering::lowerLoop(ASTNode* condition, ASTNode* body, ASTNode* increment) {
+    IrBlockId header = newBlock();
+    IrBlockId body_block = newBlock();
+    IrBlockId exit = newBlock();
+    jump(header);
+
+    current = header;
+    lowerBranch(condition, body_block, exit);
+    sealBlock(body_block);
+    sealBlock(exit);
+
+    current = body_block;
+    lowerStatement(body);
+    lowerStatement(increment);
+    jump(header);
+    sealBlock(header);
+    current = exit;
+}
+
+// End the current block with a branch on node. and/or short-circuit, not
+// swaps the targets, and anything that isn't a comparison is true when
+// non-zero. A missing condition is always true.
+void FunctionLowering::lowerBranch(ASTNode* node, IrBlockId if_true, IrBlockId if_false) {
+    while (node && node->type == NodeType::UnaryOp && static_cast<UnaryOpNode*>(node)->op == TokenType::_not) {
+        std::swap(if_true, if_false);
+        node = node->left;
+    }
+    if (!node) {
+        jump(if_true);
+        return;
+    }
+
+    if (node->type == NodeType::BinaryOp) {
+        auto binOp = static_cast<BinaryOpNode*>(node);
+
+        if (binOp->op == TokenType::_and || binOp->op == TokenType::_or) {
+            // A chain of the same operator leans left: take its operands in
+            // order by walking down it rather than recursing
+            std::vector<ASTNode*> operands;
+            ASTNode* first = binOp;
+            while (first->type == NodeType::BinaryOp && static_cast<BinaryOpNode*>(first)->op == binOp->op) {
+                operands.push_back(first->right);
+                first = first->left;
+            }
+            operands.push_back(first);
+            std::reverse(operands.begin(), operands.end());
+
+            for (size_t i = 0; i + 1 < operands.size(); i++) {
+                IrBlockId next = newBlock();
+                if (binOp->op == TokenType::_and) {
+                    lowerBranch(operands[i], next, if_false);
+                } else {
+                    lowerBranch(operands[i], if_true, next);
+                }
+                sealBlock(next);
+                current = next;
+            }
+            lowerBranch(operands.back(), if_true, if_false);
+            return;
+        }
+
+        IrOp comparison = IrOp::Const;
+        switch (binOp->op) {
+            case TokenType::_lesser: comparison = IrOp::Lt; break;
+            case TokenType::_greater: comparison = IrOp::Gt; break;
+            case TokenType::_equals: comparison = IrOp::Eq; break;
+            case TokenType::_not_equals: comparison = IrOp::Ne; break;
+            default: break;
+        }
+        if (comparison != IrOp::Const) {
+            IrValue left = lowerExpression(binOp->left);
+            IrValue right = lowerExpression(binOp->right);
+            branch(emit(comparison, IrType::Bool, {left, right}), if_true, if_false);
+            return;
+        }
+    }
+
+    IrValue value = lowerExpression(node);
+    branch(emit(IrOp::Ne, IrType::Bool, {value, constant(0)}), if_true, if_false);
+}
+
+IrValue FunctionLowering::lowerExpression(ASTNode* node) {
+    if (!node) return constant(0);
+
+    switch (node->type) {
+        case NodeType::Literal:
+            return constant(static_cast<LiteralNode*>(node)->literalValue);
+
+        case NodeType::StringLiteral:
+            return stringLiteral(node->value.value());
+
+        case NodeType::Identifier: {
+            if (!assigned[node->symbol]) {
+                throw std::runtime_error("Variable '" + name(node->symbol) + "' not defined");
+            }
+            return readVariable(node->symbol, current);
+        }
+
+        case NodeType::BinaryOp: {
+            auto binOp = static_cast<BinaryOpNode*>(node);
+            if (binOp->op == TokenType::_durham &&
+                (is_string_expression(binOp->left, string_vars) || is_string_expression(binOp->right, string_vars))) {
+                return lowerConcat(binOp);
+            }
+
+            // The left spine of a chain, as in generate_expression. Operators
+            // other than arithmetic give their left operand, as they do there.
+            std::vector<BinaryOpNode*> chain = {binOp};
+            bool only_durham = binOp->op == TokenType::_durham;
+            while (chain.back()->left->type == NodeType::BinaryOp) {
+                auto leftOp = static_cast<BinaryOpNode*>(chain.back()->left);
+                if (leftOp->op == TokenType::_durham && !only_durham) break;
+                only_durham = only_durham && leftOp->op == TokenType::_durham;
+                chain.push_back(leftOp);
+            }
+
+            IrValue result = lowerExpression(chain.back()->left);
+            for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+                IrValue right = lowerExpression((*it)->right);
+                switch ((*it)->op) {
+                    case TokenType::_durham: result = emit(IrOp::Add, IrType::Int, {result, right}); break;
+                    case TokenType::_newcastle: result = emit(IrOp::Sub, IrType::Int, {result, right}); break;
+                    case TokenType::_york: result = emit(IrOp::Mul, IrType::Int, {result, right}); break;
+                    case TokenType::_edinburgh: result = emit(IrOp::Div, IrType::Int, {result, right}); break;
+                    case TokenType::_remainder: result = emit(IrOp::Rem, IrType::Int, {result, right}); break;
+                    default: break;
+                }
+            }
+            return result;
+        }
+
+        case NodeType::VectorAlloc: {
+            IrValue count = lowerExpression(static_cast<VectorAllocNode*>(node)->size);
+            return emit(IrOp::Alloc, IrType::Ptr, {count});
+        }
+
+        case NodeType::ArrayAccess: {
+            auto accessNode = static_cast<ArrayAccessNode*>(node);
+            if (!assigned[accessNode->arrayName]) {
+                throw std::runtime_error("Array '" + name(accessNode->arrayName) + "' not defined");
+            }
+            IrValue array = readVariable(accessNode->arrayName, current);
+            IrValue index = lowerExpression(accessNode->index);
+            return emit(IrOp::Load, IrType::Int, {array, index});
+        }
+
+        case NodeType::FunctionCall: {
+            std::vector<IrValue> arguments;
+            for (ASTNode* argument : node->children) {
+                arguments.push_back(lowerExpression(argument));
+            }
+            IrValue value = emit(IrOp::Call, IrType::Int, std::move(arguments));
+            function.insts[value].callee = node->symbol;
+            return value;
+        }
+
+        default:
+            throw IrUnsupported("expression the IR can't represent");
+    }
+}
+
+// Nested durhams under a concatenation concatenate too
+IrValue FunctionLowering::lowerConcat(ASTNode* node) {
+    std::vector<ASTNode*> rights;
+    ASTNode* first = node;
+    while (first->type == NodeType::BinaryOp && static_cast<BinaryOpNode*>(first)->op == TokenType::_durham) {
+        rights.push_back(first->right);
+        first = first->left;
+    }
+    IrValue result = lowerConcatOperand(first);
+    for (auto it = rights.rbegin(); it != rights.rend(); ++it) {
+        IrValue right = lowerConcatOperand(*it);
+        result = emit(IrOp::Concat, IrType::Ptr, {result, right});
+    }
+    return result;
+}
+
+IrValue FunctionLowering::lowerConcatOperand(ASTNode* node) {
+    if (node->type == NodeType::BinaryOp && static_cast<BinaryOpNode*>(node)->op == TokenType::_durham) {
+        return lowerConcat(node);
+    }
+    if (node->type == NodeType::Identifier) {
+        return readVariable(node->symbol, current);
+    }
+    return lowerExpression(node);
+}
+
+// Keep the blocks listed in order, numbered by their place in it, and delete
+// the rest with their instructions. Edges from deleted blocks must already be
+// gone.
+static void reorder_blocks(IrFunction& function, const std::vector<IrBlockId>& order) {
+    std::vector<IrBlockId> renumbered(function.blocks.size(), IR_NONE);
+    for (size_t i = 0; i < order.size(); i++) {
+        renumbered[order[i]] = static_cast<IrBlockId>(i);
+    }
+    for (IrBlockId block = 0; block < function.blocks.size(); block++) {
+        if (renumbered[block] != IR_NONE) continue;
+        for (IrValue value : function.blocks[block].insts) {
+            function.insts[value].block = IR_NONE;
+        }
+    }
+
+    std::vector<IrBlock> blocks;
+    for (IrBlockId block : order) {
+        IrBlock& old = function.blocks[block];
+        for (IrValue value : old.insts) {
+            IrInst& inst = function.insts[value];
+            inst.block = renumbered[block];
+            for (IrBlockId& target : inst.targets) {
+                if (target != IR_NONE) target = renumbered[target];
+            }
+        }
+        for (IrBlockId& pred : old.preds) {
+            pred = renumbered[pred];
+        }
+        blocks.push_back(std::move(old));
+    }
+    function.blocks = std::move(blocks);
+}
+
+// Drop the blocks nothing reaches (code after a return), along with the phi
+// operands for edges out of them
+static void remove_unreachable_blocks(IrFunction& function) {
+    size_t block_count = function.blocks.size();
+    std::vector<bool> reachable(block_count, false);
+    std::vector<IrBlockId> work = {0};
+    reachable[0] = true;
+    while (!work.empty()) {
+        IrBlockId block = work.back();
+        work.pop_back();
+        for (IrBlockId successor : ir_successors(function, block)) {
+            if (!reachable[successor]) {
+                reachable[successor] = true;
+                work.push_back(successor);
+            }
+        }
+    }
+
+    std::vector<IrBlockId> order;
+    for (IrBlockId block = 0; block < block_count; block++) {
+        if (!reachable[block]) continue;
+        order.push_back(block);
+        IrBlock& b = function.blocks[block];
+        std::vector<bool> keep;
+        for (IrBlockId pred : b.preds) {
+            keep.push_back(reachable[pred]);
+        }
+        if (std::find(keep.begin(), keep.end(), false) == keep.end()) continue;
+        for (IrValue value : b.insts) {
+            IrInst& inst = function.insts[value];
+            if (inst.op != IrOp::Phi) break;
+            std::vector<IrValue> operands;
+            for (size_t i = 0; i < keep.size(); i++) {
+                if (keep[i]) operands.push_back(inst.operands[i]);
+            }
+            inst.operands = std::move(operands);
+        }
+        std::vector<IrBlockId> preds;
+        for (size_t i = 0; i < keep.size(); i++) {
+            if (keep[i]) preds.push_back(b.preds[i]);
+        }
+        b.preds = std::move(preds);
+    }
+    if (order.size() < block_count) reorder_blocks(function, order);
+}
+
+// A phi whose operands are all one value (or itself) is replaced by that
+// value, which may make others trivial in turn
+static void remove_trivial_phis(IrFunction& function) {
+    std::vector<IrValue> replacement(function.insts.size(), IR_NONE);
+    auto resolve = [&](IrValue value) {
+        while (replacement[value] != IR_NONE) value = replacement[value];
+        return value;
+    };
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (IrBlock& block : function.blocks) {
+            for (IrValue phi : block.insts) {
+                IrInst& inst = function.insts[phi];
+                if (inst.op != IrOp::Phi) break;
+                if (replacement[phi] != IR_NONE) continue;
+                IrValue same = IR_NONE;
+                bool trivial = true;
+                for (IrValue operand : inst.operands) {
+                    operand = resolve(operand);
+                    if (operand == phi || operand == same) continue;
+                    if (same != IR_NONE) {
+                        trivial = false;
+                        break;
+                    }
+                    same = operand;
+                }
+                if (trivial && same != IR_NONE) {
+                    replacement[phi] = same;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    for (IrBlock& block : function.blocks) {
+        std::vector<IrValue> insts;
+        for (IrValue value : block.insts) {
+            if (replacement[value] != IR_NONE) {
+                function.insts[value].block = IR_NONE;
+                continue;
+            }
+            for (IrValue& operand : function.insts[value].operands) {
+                operand = resolve(operand);
+            }
+            insts.push_back(value);
+        }
+        block.insts = std::move(insts);
+    }
+}
+
+// A phi's copies are made at the end of each predecessor, so an edge from a
+// block that branches into a block that merges gets a block of its own
+static void split_critical_edges(IrFunction& function) {
+    size_t block_count = function.blocks.size();
+    for (IrBlockId block = 0; block < block_count; block++) {
+        for (size_t i = 0; i < function.blocks[block].preds.size(); i++) {
+            if (function.blocks[block].preds.size() < 2) break;
+            IrBlockId pred = function.blocks[block].preds[i];
+            IrInst& branch = function.insts[function.blocks[pred].insts.back()];
+            if (branch.op != IrOp::Branch) continue;
+
+            IrBlockId middle = static_cast<IrBlockId>(function.blocks.size());
+            for (IrBlockId& target : branch.targets) {
+                if (target == block) target = middle;
+            }
+            IrInst jump;
+            jump.op = IrOp::Jump;
+            jump.block = middle;
+            jump.targets[0] = block;
+            IrValue value = static_cast<IrValue>(function.insts.size());
+            function.insts.push_back(jump);
+            function.blocks.emplace_back();
+            function.blocks[middle].insts.push_back(value);
+            function.blocks[middle].preds.push_back(pred);
+            function.blocks[block].preds[i] = middle;
+        }
+    }
+}
+
+// Lay the blocks out in reverse postorder, taking a branch's false side
+// first so its true side comes out first: a loop body follows its header, a
+// then-branch its condition, and most jumps fall through
+static void order_blocks(IrFunction& function) {
+    std::vector<IrBlockId> postorder;
+    std::vector<bool> visited(function.blocks.size(), false);
+    std::vector<std::pair<IrBlockId, size_t>> stack = {{0, 0}};   // block, successors taken
+    visited[0] = true;
+    while (!stack.empty()) {
+        IrBlockId block = stack.back().first;
+        std::vector<IrBlockId> successors = ir_successors(function, block);
+        size_t taken = stack.back().second++;
+        if (taken < successors.size()) {
+            IrBlockId successor = successors[successors.size() - 1 - taken];
+            if (!visited[successor]) {
+                visited[successor] = true;
+                stack.push_back({successor, 0});
+            }
+        } else {
+            postorder.push_back(block);
+            stack.pop_back();
+        }
+    }
+    std::reverse(postorder.begin(), postorder.end());
+    reorder_blocks(function, postorder);
+}
+
+// A phi is a pointer if any value flowing into it is
+static void type_phis(IrFunction& function) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (IrBlock& block : function.blocks) {
+            for (IrValue phi : block.insts) {
+                IrInst& inst = function.insts[phi];
+                if (inst.op != IrOp::Phi) break;
+                if (inst.type == IrType::Ptr) continue;
+                for (IrValue operand : inst.operands) {
+                    if (function.insts[operand].type == IrType::Ptr) {
+                        inst.type = IrType::Ptr;
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+IrModule lower_to_ir(ASTNode* ast, const SymbolTable& symbols, ModuleKind kind) {
+    IrModule module;
+    module.kind = kind;
+
+    std::vector<FunctionDeclNode*> functions;
+    if (ast->type == NodeType::Program) {
+        for (ASTNode* child : ast->children) {
+            if (child->type == NodeType::FunctionDecl) {
+                functions.push_back(static_cast<FunctionDeclNode*>(child));
+            } else if (child->type == NodeType::Import) {
+                module.imports = true;
+            } else if (kind == ModuleKind::Library) {
+                throw std::runtime_error("An imported module may only contain functions and imports");
+            }
+        }
+    }
+
+    std::vector<bool> string_vars(symbols.size(), false);
+    std::unordered_map<std::string, int64_t> string_ids;
+    module.functions.reserve(functions.size() + 1);
+    for (FunctionDeclNode* function : functions) {
+        module.functions.emplace_back();
+        FunctionLowering(module, module.functions.back(), symbols, string_vars, string_ids).lowerFunction(function);
+    }
+    if (kind == ModuleKind::Program) {
+        module.functions.emplace_back();
+        FunctionLowering(module, module.functions.back(), symbols, string_vars, string_ids).lowerMain(ast);
+    }
+
+    for (IrFunction& function : module.functions) {
+        remove_unreachable_blocks(function);
+        remove_trivial_phis(function);
+        split_critical_edges(function);
+        order_blocks(function);
+        type_phis(function);
+        verify_ir(function);
+    }
+    return module;
+}
+
+void verify_ir(const IrFunction& function) {
+    auto fail = [&](IrBlockId block, const std::string& what) {
+        throw std::logic_error("Invalid IR in block " + std::to_string(block) + ": " + what);
+    };
+
+    size_t block_count = function.blocks.size();
+    if (block_count == 0) throw std::logic_error("Invalid IR: function has no blocks");
+    if (!function.blocks[0].preds.empty()) fail(0, "the entry block has predecessors");
+
+    // Position of each live instruction in its block
+    std::vector<size_t> position(function.insts.size(), SIZE_MAX);
+    std::vector<size_t> incoming(block_count, 0);
+    for (IrBlockId block = 0; block < block_count; block++) {
+        const IrBlock& b = function.blocks[block];
+        if (b.insts.empty()) fail(block, "empty block");
+        for (size_t i = 0; i < b.insts.size(); i++) {
+            IrValue value = b.insts[i];
+            if (value >= function.insts.size()) fail(block, "instruction out of range");
+            const IrInst& inst = function.insts[value];
+            if (inst.block != block || position[value] != SIZE_MAX) fail(block, "instruction listed in the wrong block");
+            position[value] = i;
+            if (is_terminator(inst.op) != (i + 1 == b.insts.size())) fail(block, "terminator not at the end");
+            if (inst.op == IrOp::Phi && i > 0 && function.insts[b.insts[i - 1]].op != IrOp::Phi) {
+                fail(block, "phi after other instructions");
+            }
+        }
+        for (IrBlockId successor : ir_successors(function, block)) {
+            if (successor >= block_count) fail(block, "branch to a missing block");
+            incoming[successor]++;
+            const auto& preds = function.blocks[successor].preds;
+            if (std::find(preds.begin(), preds.end(), block) == preds.end()) {
+                fail(block, "successor doesn't list it as a predecessor");
+            }
+        }
+        std::vector<IrBlockId> successors = ir_successors(function, block);
+        if (successors.size() == 2) {
+            if (successors[0] == successors[1]) fail(block, "both branch targets are the same");
+            for (IrBlockId successor : successors) {
+                if (function.blocks[successor].preds.size() > 1) fail(block, "critical edge");
+            }
+        }
+    }
+
+    std::vector<bool> reachable(block_count, false);
+    std::vector<IrBlockId> work = {0};
+    reachable[0] = true;
+    while (!work.empty()) {
+        IrBlockId block = work.back();
+        work.pop_back();
+        for (IrBlockId successor : ir_successors(function, block)) {
+            if (!reachable[successor]) {
+                reachable[successor] = true;
+                work.push_back(successor);
+            }
+        }
+    }
+
+    for (IrBlockId block = 0; block < block_count; block++) {
+        const IrBlock& b = function.blocks[block];
+        if (!reachable[block]) fail(block, "unreachable block");
+        if (incoming[block] != b.preds.size()) fail(block, "predecessors don't match the edges into it");
+        for (IrValue value : b.insts) {
+            const IrInst& inst = function.insts[value];
+            if (inst.op == IrOp::Phi && inst.operands.size() != b.preds.size()) {
+                fail(block, "phi operands don't match the predecessors");
+            }
+            for (IrValue operand : inst.operands) {
+                if (operand >= function.insts.size() || position[operand] == SIZE_MAX) {
+                    fail(block, "operand is not a live instruction");
+                }
+                const IrInst& definition = function.insts[operand];
+                if (definition.type == IrType::Void) fail(block, "operand has no value");
+                if (inst.op != IrOp::Phi && definition.block == block && position[operand] >= position[value]) {
+                    fail(block, "operand used before it is defined");
+                }
+                if ((definition.type == IrType::Bool) != (inst.op == IrOp::Branch)) {
+                    fail(block, "comparison used as a value, or a value branched on");
+                }
+            }
+            if (inst.op == IrOp::Branch && inst.operands.size() != 1) fail(block, "branch without a condition");
+        }
+    }
+}
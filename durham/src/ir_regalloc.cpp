@@ -0,0 +1,249 @@
+#include "main.h"
+#include "ir.h"
+#include <algorithm>
+
+// Register numbers in the x86 encoding
+static constexpr int RBX = 3, RSI = 6, RDI = 7, R8 = 8, R9 = 9, R10 = 10, R11 = 11,
+                     R12 = 12, R13 = 13, R14 = 14, R15 = 15;
+
+// Allocatable registers a call may clobber, in order of preference
+static const std::vector<int>& caller_saved(Target target) {
+    static const std::vector<int> win64 = {R10, R11, R8, R9};
+    static const std::vector<int> sysv = {R10, R11, R8, R9, RSI, RDI};
+    return target == Target::LinuxX86_64 ? sysv : win64;
+}
+
+// Allocatable registers a callee preserves, which cost a save in the prologue
+static const std::vector<int>& callee_saved(Target target) {
+    static const std::vector<int> win64 = {RBX, R12, R13, R14, R15, RSI, RDI};
+    static const std::vector<int> sysv = {RBX, R12, R13, R14, R15};
+    return target == Target::LinuxX86_64 ? sysv : win64;
+}
+
+static bool rematerialized(IrOp op) {
+    return op == IrOp::Const || op == IrOp::String;
+}
+
+// Calls and the runtime helpers (which call putchar) clobber every
+// caller-saved register
+static bool is_call(IrOp op) {
+    return op == IrOp::Call || op == IrOp::Concat || op == IrOp::PrintNumber || op == IrOp::PrintString;
+}
+
+static bool is_comparison(IrOp op) {
+    return op == IrOp::Lt || op == IrOp::Gt || op == IrOp::Eq || op == IrOp::Ne;
+}
+
+struct LiveInterval {
+    IrValue value;
+    uint32_t start;     // positions: each instruction is two apart, in layout order
+    uint32_t end;
+};
+
+IrAllocation allocate_registers(const IrFunction& function, Target target) {
+    size_t value_count = function.insts.size();
+    size_t block_count = function.blocks.size();
+    IrAllocation allocation;
+    allocation.locations.assign(value_count, {});
+    allocation.fused.assign(value_count, false);
+
+    std::vector<uint32_t> uses(value_count, 0);
+    for (const IrBlock& block : function.blocks) {
+        for (IrValue value : block.insts) {
+            for (IrValue operand : function.insts[value].operands) {
+                uses[operand]++;
+            }
+        }
+    }
+    for (const IrBlock& block : function.blocks) {
+        size_t size = block.insts.size();
+        const IrInst& last = function.insts[block.insts.back()];
+        if (last.op == IrOp::Branch && size >= 2 && block.insts[size - 2] == last.operands[0] &&
+            is_comparison(function.insts[last.operands[0]].op) && uses[last.operands[0]] == 1) {
+            allocation.fused[last.operands[0]] = true;
+        }
+    }
+
+    // Values that need a home
+    std::vector<bool> allocated(value_count, false);
+    for (const IrBlock& block : function.blocks) {
+        for (IrValue value : block.insts) {
+            const IrInst& inst = function.insts[value];
+            allocated[value] = inst.type != IrType::Void && !rematerialized(inst.op) && !allocation.fused[value];
+        }
+    }
+
+    // Positions
+    std::vector<uint32_t> position(value_count, 0);
+    std::vector<uint32_t> block_start(block_count), block_end(block_count);
+    std::vector<uint32_t> calls;
+    uint32_t next = 0;
+    for (IrBlockId block = 0; block < block_count; block++) {
+        block_start[block] = next;
+        for (IrValue value : function.blocks[block].insts) {
+            position[value] = next;
+            if (is_call(function.insts[value].op)) calls.push_back(next);
+            next += 2;
+        }
+        block_end[block] = next - 2;
+    }
+
+    // One interval per value, from its definition to its last use, stretched
+    // over every block it is live through (holes included). Liveness is found
+    // per value by walking back from each use to the definition, so the work
+    // grows with the live ranges rather than with values times blocks. A phi
+    // reads its operand at the end of the matching predecessor.
+    std::vector<LiveInterval> intervals(value_count);
+    std::vector<IrBlockId> defined_in(value_count, IR_NONE);
+    std::vector<uint32_t> first_use(value_count + 1, 0);
+    for (IrBlockId block = 0; block < block_count; block++) {
+        for (IrValue value : function.blocks[block].insts) {
+            const IrInst& inst = function.insts[value];
+            defined_in[value] = block;
+            intervals[value] = {value, position[value], position[value]};
+            if (inst.op == IrOp::Phi) {
+                // Every phi of a block is set by the same parallel copy
+                intervals[value].start = block_start[block];
+                intervals[value].end = block_start[block] + 1;
+            } else if (inst.op == IrOp::Param) {
+                // Likewise every parameter, on entry
+                intervals[value].start = 0;
+                intervals[value].end = 1;
+            }
+            for (IrValue operand : inst.operands) {
+                first_use[operand + 1]++;
+            }
+        }
+    }
+    for (size_t value = 0; value < value_count; value++) {
+        first_use[value + 1] += first_use[value];
+    }
+
+    // Blocks each value is used in, or for a phi operand the predecessor
+    std::vector<IrBlockId> use_blocks(first_use[value_count]);
+    std::vector<uint32_t> filled(first_use.begin(), first_use.end() - 1);
+    for (IrBlockId block = 0; block < block_count; block++) {
+        for (IrValue value : function.blocks[block].insts) {
+            const IrInst& inst = function.insts[value];
+            for (size_t i = 0; i < inst.operands.size(); i++) {
+                IrValue operand = inst.operands[i];
+                IrBlockId user = inst.op == IrOp::Phi ? function.blocks[block].preds[i] : block;
+                use_blocks[filled[operand]++] = user;
+                uint32_t at = inst.op == IrOp::Phi ? block_end[user] : position[value];
+                intervals[operand].end = std::max(intervals[operand].end, at);
+            }
+        }
+    }
+
+    std::vector<IrValue> live_into(block_count, IR_NONE);  // last value found live into the block
+    std::vector<IrBlockId> worklist;
+    for (IrValue value = 0; value < value_count; value++) {
+        if (!allocated[value]) continue;
+        LiveInterval& interval = intervals[value];
+        for (uint32_t use = first_use[value]; use < first_use[value + 1]; use++) {
+            IrBlockId block = use_blocks[use];
+            if (block == defined_in[value] || live_into[block] == value) continue;
+            live_into[block] = value;
+            worklist.push_back(block);
+        }
+        while (!worklist.empty()) {
+            IrBlockId block = worklist.back();
+            worklist.pop_back();
+            interval.start = std::min(interval.start, block_start[block]);
+            for (IrBlockId pred : function.blocks[block].preds) {
+                interval.end = std::max(interval.end, block_end[pred]);
+                if (pred == defined_in[value] || live_into[pred] == value) continue;
+                live_into[pred] = value;
+                worklist.push_back(pred);
+            }
+        }
+    }
+
+    std::vector<LiveInterval> order;
+    for (IrValue value = 0; value < value_count; value++) {
+        if (allocated[value]) order.push_back(intervals[value]);
+    }
+    std::sort(order.begin(), order.end(), [](const LiveInterval& a, const LiveInterval& b) {
+        return a.start != b.start ? a.start < b.start : a.value < b.value;
+    });
+
+    const std::vector<int>& volatile_registers = caller_saved(target);
+    const std::vector<int>& preserved_registers = callee_saved(target);
+    std::vector<bool> free(16, false);
+    std::vector<bool> preserved(16, false);
+    std::vector<bool> used(16, false);
+    for (int reg : volatile_registers) free[reg] = true;
+    for (int reg : preserved_registers) free[reg] = preserved[reg] = true;
+
+    auto spill = [&](IrValue value) {
+        allocation.locations[value] = {IrLocation::Kind::Stack, allocation.spill_slots++};
+    };
+    auto assign = [&](IrValue value, int reg) {
+        allocation.locations[value] = {IrLocation::Kind::Register, reg};
+        free[reg] = false;
+        used[reg] = true;
+    };
+
+    std::vector<LiveInterval> active;
+    for (const LiveInterval& interval : order) {
+        // Registers of intervals that have ended (including at this
+        // instruction, which reads its operands before writing its result)
+        for (size_t i = 0; i < active.size();) {
+            if (active[i].end <= interval.start) {
+                free[allocation.locations[active[i].value].index] = true;
+                active[i] = active.back();
+                active.pop_back();
+            } else {
+                i++;
+            }
+        }
+
+        auto call = std::upper_bound(calls.begin(), calls.end(), interval.start);
+        bool across_call = call != calls.end() && *call < interval.end;
+
+        int chosen = -1;
+        if (!across_call) {
+            for (int reg : volatile_registers) {
+                if (free[reg]) {
+                    chosen = reg;
+                    break;
+                }
+            }
+        }
+        if (chosen < 0) {
+            for (int reg : preserved_registers) {
+                if (free[reg]) {
+                    chosen = reg;
+                    break;
+                }
+            }
+        }
+        if (chosen >= 0) {
+            assign(interval.value, chosen);
+            active.push_back(interval);
+            continue;
+        }
+
+        // Out of registers: spill whichever usable interval ends last
+        size_t victim = active.size();
+        for (size_t i = 0; i < active.size(); i++) {
+            int reg = allocation.locations[active[i].value].index;
+            if (across_call && !preserved[reg]) continue;
+            if (victim == active.size() || active[i].end > active[victim].end) victim = i;
+        }
+        if (victim < active.size() && active[victim].end > interval.end) {
+            int reg = allocation.locations[active[victim].value].index;
+            spill(active[victim].value);
+            free[reg] = true;
+            assign(interval.value, reg);
+            active[victim] = interval;
+        } else {
+            spill(interval.value);
+        }
+    }
+
+    for (int reg : preserved_registers) {
+        if (used[reg]) allocation.saved_registers.push_back(reg);
+    }
+    return allocation;
+}
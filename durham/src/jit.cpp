@@ -0,0 +1,119 @@
+#include "jit.h"
+#include "assembler.h"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Glue linked next to the program: an entry trampoline that preserves the
+// host's callee-saved registers (generated code uses rbx/r12-r15 freely), and
+// an import stub reaching the host putchar through a data slot, since libc is
+// usually out of rel32 range of the mapping.
+static const char* JIT_GLUE_ASM =
+    "section .data\n"
+    "    durham_import_putchar dq 0\n"
+    "section .text\n"
+    "    global durham_jit_entry\n"
+    "    global durham_import_putchar\n"
+    "    global putchar\n"
+    "durham_jit_entry:\n"
+    "    push rbx\n"
+    "    push rbp\n"
+    "    push r12\n"
+    "    push r13\n"
+    "    push r14\n"
+    "    push r15\n"
+    "    sub rsp, 8\n"
+    "    call main\n"
+    "    add rsp, 8\n"
+    "    pop r15\n"
+    "    pop r14\n"
+    "    pop r13\n"
+    "    pop r12\n"
+    "    pop rbp\n"
+    "    pop rbx\n"
+    "    ret\n"
+    "putchar:\n"
+    "    jmp [rel durham_import_putchar]\n";
+
+static size_t round_to_page(size_t size, size_t page) {
+    return (size + page - 1) / page * page;
+}
+
+int run_jit(const std::string& assembly_code, TimeReport* report) {
+    ObjectCode program;
+    {
+        TimeReport::Phase phase(report, "assemble");
+        program = assemble(assembly_code);
+    }
+    return run_jit(std::vector<ObjectCode>{program}, report);
+}
+
+int run_jit(const std::vector<ObjectCode>& program, TimeReport* report) {
+#ifdef _WIN32
+    (void)program;
+    (void)report;
+    throw std::runtime_error("--jit is only supported on Linux");
+#else
+    // The glue never changes, so it is assembled once per process
+    static const ObjectCode glue = assemble(JIT_GLUE_ASM);
+    std::vector<ObjectCode> objects = {glue};
+    objects.insert(objects.end(), program.begin(), program.end());
+
+    // Upper bound on the linked size (sections are 16-byte aligned per object),
+    // for the mapping only: the text really ends where link_objects says
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t text_bound = 0, data_bound = 0;
+    for (const auto& object : objects) {
+        text_bound += object.text.size() + 16;
+        data_bound += object.data.size() + object.bss_size + 32;
+    }
+    size_t total = round_to_page(text_bound, page) + round_to_page(data_bound, page);
+
+    void* region = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+        throw std::runtime_error("jit: could not map memory");
+    }
+    uint8_t* base = static_cast<uint8_t*>(region);
+    uint64_t base_address = reinterpret_cast<uint64_t>(base);
+
+    int result;
+    try {
+        LinkedImage image;
+        {
+            TimeReport::Phase phase(report, "link");
+            image = link_objects(objects, base_address);
+            std::memcpy(base, image.text.data(), image.text.size());
+            uint8_t* data = base + (image.data_address - base_address);
+            std::memcpy(data, image.data.data(), image.data.size());   // bss is already zero
+
+            int (*host_putchar)(int) = &std::putchar;
+            uint64_t slot = image.symbols.at("durham_import_putchar");
+            std::memcpy(base + (slot - base_address), &host_putchar, sizeof(host_putchar));
+
+            // W^X: the text becomes executable only once it is no longer
+            // writable. The data starts on the page after it, which has to stay
+            // writable.
+            size_t text_pages = image.data_address - base_address;
+            if (mprotect(base, text_pages, PROT_READ | PROT_EXEC) != 0) {
+                throw std::runtime_error("jit: could not make code executable");
+            }
+        }
+        if (report) report->count("code bytes", image.text.size() + image.data.size());
+
+        TimeReport::Phase phase(report, "run");
+        auto entry = reinterpret_cast<int (*)()>(image.symbols.at("durham_jit_entry"));
+        result = entry();
+        std::fflush(stdout);
+    } catch (...) {
+        munmap(region, total);
+        throw;
+    }
+    munmap(region, total);
+    return result;
+#endif
+}
@@ -0,0 +1,19 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <string>
+#include <vector>
+#include "assembler.h"
+#include "time_report.h"
+
+// Assemble linux-x86_64 output into executable memory and run its main in this
+// process. putchar is bound to the host C library. Returns main's result;
+// throws std::runtime_error if the code can't be assembled or mapped. Phases
+// are recorded in report when one is given.
+int run_jit(const std::string& assembly_code, TimeReport* report = nullptr);
+
+// Same, for an already assembled program: its main module and any modules it
+// imports.
+int run_jit(const std::vector<ObjectCode>& program, TimeReport* report = nullptr);
+
+#endif //JIT_H
@@ -0,0 +1,134 @@
+#ifndef KEYWORDS_H
+#define KEYWORDS_H
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include "tokenizer.h"
+
+// Every reserved word: keywords map to their token, colleges to int_lit with
+// their decimal digits. Recognized through a perfect hash built at compile time.
+struct KeywordEntry {
+    std::string_view word;
+    TokenType type;
+    std::string_view digits;    // colleges only
+};
+
+inline constexpr KeywordEntry KEYWORD_ENTRIES[] = {
+    // Colleges: the digits 0-16
+    {"butler", TokenType::int_lit, "0"},
+    {"chads", TokenType::int_lit, "1"},
+    {"marys", TokenType::int_lit, "2"},
+    {"collingwood", TokenType::int_lit, "3"},
+    {"johns", TokenType::int_lit, "4"},
+    {"castle", TokenType::int_lit, "5"},
+    {"cuths", TokenType::int_lit, "6"},
+    {"trevs", TokenType::int_lit, "7"},
+    {"aidans", TokenType::int_lit, "8"},
+    {"snow", TokenType::int_lit, "9"},
+    {"grey", TokenType::int_lit, "10"},
+    {"stephenson", TokenType::int_lit, "11"},
+    {"hatfield", TokenType::int_lit, "12"},
+    {"hildbede", TokenType::int_lit, "13"},
+    {"south", TokenType::int_lit, "14"},
+    {"vanmildert", TokenType::int_lit, "15"},
+    {"ustinov", TokenType::int_lit, "16"},
+
+    {"tlc", TokenType::_tlc, ""},
+    {"mcs", TokenType::_mcs, ""},
+    {"for", TokenType::_for, ""},
+    {"if", TokenType::_if, ""},
+    {"else", TokenType::_else, ""},
+    {"while", TokenType::_while, ""},
+    {"function", TokenType::_function, ""},
+    {"import", TokenType::_import, ""},
+    // Type keywords
+    {"text", TokenType::_text, ""},
+    {"number", TokenType::_number, ""},
+    // Vector/Array keywords
+    {"new", TokenType::_new, ""},
+    {"college", TokenType::_college, ""},
+    {"at", TokenType::_at, ""},
+    // Arithmetic operators
+    {"durham", TokenType::_durham, ""},
+    {"newcastle", TokenType::_newcastle, ""},
+    {"york", TokenType::_york, ""},
+    {"edinburgh", TokenType::_edinburgh, ""},
+    // Logical operators
+    {"and", TokenType::_and, ""},
+    {"or", TokenType::_or, ""},
+    {"not", TokenType::_not, ""},
+    // Comparison operators
+    {"greater", TokenType::_greater, ""},
+    {"lesser", TokenType::_lesser, ""},
+    {"equals", TokenType::_equals, ""},
+    // Punctuation words
+    {"is", TokenType::equals, ""},
+    {"begin", TokenType::open_paren, ""},
+    {"end", TokenType::close_paren, ""},
+    {"front", TokenType::open_brace, ""},
+    {"back", TokenType::close_brace, ""}
+};
+
+inline constexpr size_t KEYWORD_COUNT = sizeof(KEYWORD_ENTRIES) / sizeof(KEYWORD_ENTRIES[0]);
+inline constexpr size_t KEYWORD_TABLE_SIZE = 256;   // power of two
+inline constexpr uint8_t KEYWORD_EMPTY = 0xFF;
+
+// Seeded FNV-1a, reduced to a table slot
+constexpr size_t keyword_slot(std::string_view word, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ seed;
+    for (char c : word) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+    return (hash ^ (hash >> 15)) & (KEYWORD_TABLE_SIZE - 1);
+}
+
+// Slot -> entry index for a given seed; perfect is false on a collision
+struct KeywordTable {
+    std::array<uint8_t, KEYWORD_TABLE_SIZE> slots;
+    bool perfect;
+};
+
+constexpr KeywordTable build_keyword_table(uint32_t seed) {
+    KeywordTable table{};
+    for (auto& slot : table.slots) slot = KEYWORD_EMPTY;
+    for (size_t i = 0; i < KEYWORD_COUNT; i++) {
+        size_t slot = keyword_slot(KEYWORD_ENTRIES[i].word, seed);
+        if (table.slots[slot] != KEYWORD_EMPTY) return table;
+        table.slots[slot] = static_cast<uint8_t>(i);
+    }
+    table.perfect = true;
+    return table;
+}
+
+// First seed with no collisions
+constexpr uint32_t find_keyword_seed() {
+    for (uint32_t seed = 0; seed < 100000; seed++) {
+        if (build_keyword_table(seed).perfect) return seed;
+    }
+    return UINT32_MAX;
+}
+
+inline constexpr uint32_t KEYWORD_SEED = find_keyword_seed();
+inline constexpr KeywordTable KEYWORD_TABLE = build_keyword_table(KEYWORD_SEED);
+
+// One hash and at most one string comparison
+constexpr const KeywordEntry* lookup_keyword(std::string_view word) {
+    uint8_t index = KEYWORD_TABLE.slots[keyword_slot(word, KEYWORD_SEED)];
+    if (index == KEYWORD_EMPTY || KEYWORD_ENTRIES[index].word != word) return nullptr;
+    return &KEYWORD_ENTRIES[index];
+}
+
+constexpr bool every_keyword_found() {
+    for (const auto& entry : KEYWORD_ENTRIES) {
+        if (lookup_keyword(entry.word) != &entry) return false;
+    }
+    return true;
+}
+
+static_assert(KEYWORD_COUNT < KEYWORD_EMPTY, "entry indices must fit in a byte");
+static_assert(KEYWORD_SEED != UINT32_MAX, "no collision-free seed; grow KEYWORD_TABLE_SIZE");
+static_assert(every_keyword_found(), "keyword table is not a perfect hash");
+
+#endif //KEYWORDS_H
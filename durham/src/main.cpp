@@ -2,6 +2,30 @@
 #include "tokenizer.h"
 #include "parser.h"
 #include "gen_asm.h"
+#include "ir.h"
+#include "assembler.h"
+#include "elf_writer.h"
+#include "jit.h"
+#include "time_report.h"
+#include "source_file.h"
+#include "compile_cache.h"
+#include "ast_file.h"
+#include "serve.h"
+#include "serve_protocol.h"
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <cerrno>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 //using namespace std;
 
@@ -28,82 +52,594 @@ void autocorrect(int argc, char** argv) {
 
 }
 
-int main(int argc, char** argv) {
-    if (argc != 2) {
-        std::cerr << "Incorrect Usage" << std::endl; 
-        std::cerr << "Correct Usage: durham <input.dur>" << std::endl;  // Changed
-        return EXIT_FAILURE;  // Fixed: should be FAILURE not SUCCESS
+// Single-file compiles keep the historical output.* names; batch compiles name
+// the outputs after each input so concurrent jobs don't clobber each other
+OutputPaths output_paths_for(const Options& options, const std::string& input) {
+    bool windows = options.target == Target::Win64;
+    if (options.input_files.size() == 1) {
+        OutputPaths paths;
+        if (windows) {
+            paths = {"output.asm", "output.obj", "output.exe", "output.exe"};
+        } else {
+            paths = {"output.asm", "output.o", "output", "./output"};
+        }
+        if (!options.working_directory.empty()) {
+            std::filesystem::path directory(options.working_directory);
+            paths.assembly = (directory / paths.assembly).string();
+            paths.object = (directory / paths.object).string();
+            paths.executable = (directory / paths.executable).string();
+            paths.run_command = paths.executable;
+        }
+        return paths;
     }
-    //std::cout << argv[1] << std::endl; 
-    //std::cout<< "Hello World" << std::endl;
 
-    std::ifstream input(argv[1]); // ifstream ONLY input
-    
-    if (!input.is_open()) {
-        std::cerr << "Error: Could not open file " << argv[1] << std::endl; 
-        return EXIT_FAILURE; 
+    std::filesystem::path source(input);
+    std::filesystem::path executable = source;
+    executable.replace_extension(windows ? ".exe" : "");
+    if (executable == source) executable += ".out";
+
+    OutputPaths paths;
+    paths.assembly = std::filesystem::path(source).replace_extension(".asm").string();
+    paths.object = std::filesystem::path(source).replace_extension(windows ? ".obj" : ".o").string();
+    paths.executable = executable.string();
+    paths.run_command = executable.has_parent_path() ? paths.executable : "./" + paths.executable;
+    return paths;
+}
+
+// Run a tool or the compiled program and wait for its exit code. No shell:
+// paths come from the input's name, which may contain anything.
+static int run_process(const std::vector<std::string>& arguments) {
+#ifdef _WIN32
+    // _spawnvp joins the arguments with spaces, so each needs its quotes
+    std::vector<std::string> quoted;
+    for (const auto& argument : arguments) {
+        quoted.push_back("\"" + argument + "\"");
+    }
+    std::vector<const char*> argv;
+    for (const auto& argument : quoted) {
+        argv.push_back(argument.c_str());
+    }
+    argv.push_back(nullptr);
+    return static_cast<int>(_spawnvp(_P_WAIT, arguments[0].c_str(), argv.data()));
+#else
+    std::vector<char*> argv;
+    for (const auto& argument : arguments) {
+        argv.push_back(const_cast<char*>(argument.c_str()));
+    }
+    argv.push_back(nullptr);
+    pid_t child;
+    if (posix_spawnp(&child, argv[0], nullptr, nullptr, argv.data(), environ) != 0) {
+        return 127;
     }
+    int status = 0;
+    while (waitpid(child, &status, 0) < 0) {
+        if (errno != EINTR) return EXIT_FAILURE;
+    }
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
+#endif
+}
 
-    std::stringstream buffer; 
-    buffer << input.rdbuf(); 
-    std::string contents = buffer.str(); 
+bool parse_options(int argc, char** argv, Options& options, std::ostream& diag) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--target=", 0) == 0) {
+            std::string name = arg.substr(9);
+            if (name == "linux-x86_64") {
+                options.target = Target::LinuxX86_64;
+            } else if (name == "win64") {
+                options.target = Target::Win64;
+            } else {
+                diag << "Unknown target '" << name << "' (expected linux-x86_64 or win64)" << std::endl;
+                return false;
+            }
+        } else if (arg == "--serve") {
+            options.serve_socket = default_socket_path();
+        } else if (arg.rfind("--serve=", 0) == 0) {
+            options.serve_socket = arg.substr(8);
+        } else if (arg.rfind("--autocorrect=", 0) == 0) {
+            std::string mode = arg.substr(14);
+            if (mode == "prompt") {
+                options.autocorrect = AutocorrectMode::Prompt;
+            } else if (mode == "off") {
+                options.autocorrect = AutocorrectMode::Off;
+            } else if (mode == "report") {
+                options.autocorrect = AutocorrectMode::Report;
+            } else if (mode == "apply") {
+                options.autocorrect = AutocorrectMode::Apply;
+            } else {
+                diag << "Unknown autocorrect mode '" << mode << "' (expected off, prompt, report or apply)" << std::endl;
+                return false;
+            }
+        } else if (arg == "--no-cache") {
+            options.use_cache = false;
+        } else if (arg.rfind("--cache-dir=", 0) == 0) {
+            options.cache_directory = arg.substr(12);
+        } else if (arg == "--no-run") {
+            options.run = false;
+        } else if (arg == "--jit") {
+            options.jit = true;
+        } else if (arg == "--time-report" || arg == "--time-report=text") {
+            options.time_report = ReportFormat::Text;
+        } else if (arg == "--time-report=json") {
+            options.time_report = ReportFormat::Json;
+        } else if (arg == "--backend=ast") {
+            options.backend = Backend::Ast;
+        } else if (arg == "--backend=ir") {
+            options.backend = Backend::Ir;
+        } else if (arg == "--emit=asm") {
+            options.emit = EmitKind::Asm;
+        } else if (arg == "--emit=exe") {
+            options.emit = EmitKind::Exe;
+        } else if (arg.rfind("-j", 0) == 0) {
+            std::string count = arg.size() > 2 ? arg.substr(2) : (i + 1 < argc ? argv[++i] : "");
+            try {
+                options.jobs = std::stoi(count);
+            } catch (const std::exception&) {
+                options.jobs = 0;
+            }
+            if (options.jobs < 1) {
+                diag << "-j expects a positive job count" << std::endl;
+                return false;
+            }
+        } else if (arg.rfind("-", 0) == 0) {
+            diag << "Unknown option '" << arg << "'" << std::endl;
+            return false;
+        } else {
+            options.input_files.push_back(arg);
+        }
+    }
+    if (options.jit && options.target != Target::LinuxX86_64) {
+        diag << "--jit requires --target=linux-x86_64" << std::endl;
+        return false;
+    }
+    if (options.jit && options.input_files.size() > 1) {
+        diag << "--jit takes a single input file" << std::endl;
+        return false;
+    }
+    if (options.serve_socket) {
+        return options.input_files.empty();
+    }
+    return !options.input_files.empty();
+}
+
+// The freestanding runtime only depends on the target, so assemble it once
+static const ObjectCode& runtime_object(Target target) {
+    static const ObjectCode linux_runtime = assemble(generate_runtime_asm(Target::LinuxX86_64));
+    if (target != Target::LinuxX86_64) {
+        throw std::runtime_error("Freestanding runtime is only available for linux-x86_64");
+    }
+    return linux_runtime;
+}
+
+// 1-based line and column of a byte offset
+static std::pair<size_t, size_t> line_and_column(std::string_view text, size_t offset) {
+    size_t line = 1, line_start = 0;
+    for (size_t i = 0; i < offset && i < text.size(); i++) {
+        if (text[i] == '\n') {
+            line++;
+            line_start = i + 1;
+        }
+    }
+    return {line, offset - line_start + 1};
+}
 
-    input.close(); // always close after opening file
+// Tokenize and parse one source into arena. Returns null (after reporting to
+// diag) if it doesn't parse.
+// cacheable is cleared when the result depends on more than the source text
+// (corrections were applied, or suggestions or warnings reported that a cache
+// hit would not repeat).
+static ASTNode* parse_source(const Options& options, SourceFile& input, const std::string& input_path,
+                             SymbolTable& symbols, AstArena& arena, bool& cacheable,
+                             std::ostream& diag, TimeReport* report) {
+    // Tokens are lexed as the parser asks for them, so "parse" covers lexing
+    // too. They are spans of the mapped source, so parse before anything
+    // below can unmap it. The AST owns copies of the text it needs.
+    Tokenizer tokenizer(input.text(), symbols, options.autocorrect); 
+    // Batch compiles already keep every core busy with one file each
+    if (options.input_files.size() == 1) {
+        tokenizer.setLexThreads(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    ASTNode* ast = nullptr;
+    std::string parse_error;
+    std::vector<ParseWarning> warnings;
+    {
+        TimeReport::Phase phase(report, "parse");
+        try {
+            Parser parser(tokenizer, input.text(), arena);
+            ast = parser.parse();
+            warnings = parser.getWarnings();
+        } catch (const std::exception& e) {
+            parse_error = e.what();
+            // Lex the rest anyway so every autocorrect question is still asked
+            while (tokenizer.next().type != TokenType::end_of_file) {}
+        }
+    }
+    if (report) report->count("tokens", tokenizer.getTokenCount());
 
-    Tokenizer tokenizer(contents); 
-    std::vector<Token> tokens = tokenizer.tokenize(); 
+    // --autocorrect=report: every suggestion in one list, after lexing
+    for (const auto& suggestion : tokenizer.getSuggestions()) {
+        auto [line, column] = line_and_column(input.text(), suggestion.offset);
+        diag << input_path << ":" << line << ":" << column << ": unknown word '" << suggestion.word
+             << "', did you mean '" << suggestion.keyword << "'?" << std::endl;
+    }
+    for (const auto& error : tokenizer.getErrors()) {
+        auto [line, column] = line_and_column(input.text(), error.offset);
+        diag << input_path << ":" << line << ":" << column << ": error: " << error.message << std::endl;
+    }
+    for (const auto& warning : warnings) {
+        auto [line, column] = line_and_column(input.text(), warning.offset);
+        diag << input_path << ":" << line << ":" << column << ": warning: " << warning.message << std::endl;
+    }
     
-    // If corrections were made, write back to file
+    // If corrections were made, write back to file. Build the corrected text
+    // and drop the mapping before the file is truncated underneath it.
+    cacheable = !tokenizer.hasCorrections() && tokenizer.getSuggestions().empty() && warnings.empty();
     if (tokenizer.hasCorrections()) {
-        std::ofstream output_file(argv[1]);
+        std::string corrected_source = tokenizer.getCorrectedSource();
+        input.close();
+        std::ofstream output_file(input_path);
         if (output_file.is_open()) {
-            output_file << tokenizer.getCorrectedSource();
+            output_file << corrected_source;
             output_file.close();
             std::cout << "File updated with corrections." << std::endl;
         } else {
-            std::cerr << "Warning: Could not write corrections to file" << std::endl;
+            diag << "Warning: Could not write corrections to file" << std::endl;
+        }
+    }
+
+    if (!ast) {
+        diag << "Error: " << parse_error << std::endl;
+        return nullptr;
+    }
+    if (!tokenizer.getErrors().empty()) return nullptr;     // reported above
+    return ast;
+}
+
+// Parse (or load the precompiled tree of) one source and generate its
+// assembly as kind. Returns null (after reporting to diag) if it doesn't
+// compile. cacheable is as for parse_source.
+static std::shared_ptr<CachedModule> build_module(const Options& options, SourceFile& input,
+                                                  const std::string& input_path, ModuleKind kind,
+                                                  bool& cacheable, std::ostream& diag, TimeReport* report) {
+    if (input.text().size() > MAX_SOURCE_BYTES) {
+        diag << "Error: " << input_path << " is too large (at most " << MAX_SOURCE_BYTES << " bytes)" << std::endl;
+        return nullptr;
+    }
+    SymbolTable symbols;
+    // The whole tree is freed with the arena when this returns
+    AstArena arena;
+    ASTNode* ast = nullptr;
+
+    // A .durast beside the source, made from the same text, stands in for
+    // lexing and parsing. Like the module cache, --no-cache turns it off.
+    std::string ast_path = options.use_cache ? ast_file_path(input_path) : "";
+    if (!ast_path.empty()) {
+        TimeReport::Phase phase(report, "load ast");
+        ast = load_ast_file(ast_path, input.text(), symbols, arena);
+        if (report) report->count("ast file hit", ast ? 1 : 0);
+    }
+    if (!ast) {
+        ast = parse_source(options, input, input_path, symbols, arena, cacheable, diag, report);
+        if (!ast) return nullptr;
+        if (!ast_path.empty() && cacheable) {
+            write_ast_file(ast_path, ast, symbols, input.text());
         }
     }
+    if (report) report->count("ast nodes", count_ast_nodes(ast));
 
-    std::string assembly_code;
+    auto module = std::make_shared<CachedModule>();
+    for (ASTNode* statement : ast->children) {
+        if (statement->type == NodeType::Import) {
+            module->imports.emplace_back(symbols.name(statement->symbol));
+        }
+    }
     try {
-        Parser parser(tokens);
-        std::shared_ptr<ASTNode> ast = parser.parse();
-        
-        assembly_code = generate_assembly_from_ast(ast);
+        std::optional<IrModule> ir;
+        if (options.backend == Backend::Ir) {
+            TimeReport::Phase phase(report, "lower ir");
+            try {
+                ir = lower_to_ir(ast, symbols, kind);
+            } catch (const IrUnsupported&) {
+                // Generated from the tree instead
+            }
+            if (report) report->count("ir fallback", ir ? 0 : 1);
+        }
+        TimeReport::Phase phase(report, "codegen");
+        module->assembly = ir ? generate_assembly_from_ir(*ir, symbols, options.target)
+                              : generate_assembly_from_ast(ast, symbols, options.target, kind);
     } catch (const std::exception& e) {
-        std::cerr << "Error: " << e.what() << std::endl;
-        return EXIT_FAILURE;
+        diag << "Error: " << e.what() << std::endl;
+        return nullptr;
     }
+    if (report) {
+        report->count("instructions", count_instructions(module->assembly));
+        report->count("assembly bytes", module->assembly.size());
+    }
+    return module;
+}
+
+// A compiled source file: the program, or a module it imports
+struct CompiledUnit {
+    std::string path;
+    std::shared_ptr<const CachedModule> module;
+    CompileCache* cache = nullptr;      // null if the module can't be cached
+    std::string cache_key;
+};
+
+// Compile one source as kind, or find it in cache. Returns false (after
+// reporting to diag) if it doesn't compile.
+static bool compile_unit(const Options& options, const std::string& path, ModuleKind kind,
+                         std::ostream& diag, TimeReport* report, CompileCache* cache, CompiledUnit& unit) {
+    // Mapped, not copied: the tokenizer reads the file in place
+    SourceFile input;
+    
+    if (!input.open(path)) {
+        diag << "Error: Could not open file " << path << std::endl; 
+        return false; 
+    }
+
+    unit.path = path;
+    if (cache) {
+        unit.cache_key = CompileCache::key_for(input.text(), options, kind);
+        unit.module = cache->find(unit.cache_key);
+        if (report) report->count("cache hit", unit.module ? 1 : 0);
+    }
+    if (!unit.module) {
+        bool cacheable = true;
+        std::shared_ptr<CachedModule> built = build_module(options, input, path, kind, cacheable, diag, report);
+        if (!built) return false;
+        if (!cacheable) cache = nullptr;
+        if (cache) cache->store(unit.cache_key, built);
+        unit.module = built;
+    }
+    unit.cache = cache;
+    return true;
+}
+
+// Where "import name" in the file at importer finds its module
+static std::string import_path(const std::string& importer, const std::string& name) {
+    return (std::filesystem::path(importer).parent_path() / (name + ".dur")).string();
+}
+
+// One spelling per file, so a module reached by two paths is compiled once
+static std::string file_identity(const std::string& path) {
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    return error ? path : canonical.string();
+}
 
-    // Write assembly
-    std::ofstream output("output.asm");
-    if (output.is_open()) {
-        output << assembly_code;
-        output.close();
-        //std::cout << "Generated output.asm" << std::endl;
-    } else {
-        std::cerr << "Error: Could not write output.asm" << std::endl;
+// Tokenize, parse, generate and build one input. Diagnostics go to diag. When
+// run is set the program is executed and its exit code returned. Phase timings
+// are recorded in report if one is given, and modules are reused from cache.
+// Each imported module is compiled (and cached) separately and linked in, so
+// editing one module only rebuilds that module.
+static int compile_file(const Options& options, const std::string& input_path, bool run,
+                        std::ostream& diag, TimeReport* report, CompileCache* cache) {
+    std::vector<CompiledUnit> units(1);
+    if (!compile_unit(options, input_path, ModuleKind::Program, diag, report, cache, units[0])) {
         return EXIT_FAILURE;
     }
 
+    // Every module imported directly or indirectly, once each
+    std::set<std::string> compiled = {file_identity(input_path)};
+    for (size_t i = 0; i < units.size(); i++) {
+        std::string importer = units[i].path;
+        std::vector<std::string> imports = units[i].module->imports;
+        for (const auto& name : imports) {
+            std::string path = import_path(importer, name);
+            if (!compiled.insert(file_identity(path)).second) continue;
+            CompiledUnit unit;
+            if (!compile_unit(options, path, ModuleKind::Library, diag, report, cache, unit)) {
+                diag << "Error: Could not compile module '" << name << "' imported by " << importer << std::endl;
+                return EXIT_FAILURE;
+            }
+            units.push_back(std::move(unit));
+        }
+    }
+
+    // Machine code for a module, assembled at most once per cached module
+    auto object_of = [&](const CompiledUnit& unit) -> ObjectCode {
+        if (unit.module->object) return *unit.module->object;
+        ObjectCode object;
+        {
+            TimeReport::Phase phase(report, "assemble");
+            object = assemble(unit.module->assembly);
+        }
+        if (unit.cache) {
+            auto assembled = std::make_shared<CachedModule>(*unit.module);
+            assembled->object = object;
+            unit.cache->store(unit.cache_key, assembled);
+        }
+        return object;
+    };
+    auto program_objects = [&]() {
+        std::vector<ObjectCode> objects;
+        for (const auto& unit : units) {
+            objects.push_back(object_of(unit));
+        }
+        return objects;
+    };
+    // Run straight from memory: no files, no external tools
+    if (options.jit) {
+        try {
+            return run_jit(program_objects(), report);
+        } catch (const std::exception& e) {
+            diag << "Error: " << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    OutputPaths paths = output_paths_for(options, input_path);
+
+    // Linux executables are assembled and linked in-process
+    if (options.emit == EmitKind::Exe && options.target == Target::LinuxX86_64) {
+        try {
+            std::vector<ObjectCode> objects = {runtime_object(options.target)};
+            for (ObjectCode& object : program_objects()) {
+                objects.push_back(std::move(object));
+            }
+            TimeReport::Phase phase(report, "link");
+            LinkedImage image = link_objects(objects, ELF_TEXT_ADDRESS);
+            std::vector<uint8_t> executable = build_elf_executable(image, image.symbols.at("_start"));
+            if (!write_executable(paths.executable, executable)) {
+                diag << "Error: Could not write " << paths.executable << std::endl;
+                return EXIT_FAILURE;
+            }
+            if (report) report->count("executable bytes", executable.size());
+        } catch (const std::exception& e) {
+            diag << "Error: " << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (!run) {
+            return EXIT_SUCCESS;
+        }
+        TimeReport::Phase phase(report, "run");
+        return run_process({paths.run_command});
+    }
+
+    // Write assembly: the program's to the usual place, each imported
+    // module's beside its source
+    std::vector<std::pair<std::string, std::string>> listings;  // assembly, object
+    for (const auto& unit : units) {
+        std::string assembly = paths.assembly, object = paths.object;
+        if (&unit != &units[0]) {
+            assembly = std::filesystem::path(unit.path).replace_extension(".asm").string();
+            object = std::filesystem::path(unit.path).replace_extension(".obj").string();
+        }
+        std::ofstream output(assembly);
+        if (output.is_open()) {
+            output << unit.module->assembly;
+            output.close();
+            //std::cout << "Generated output.asm" << std::endl;
+        } else {
+            diag << "Error: Could not write " << assembly << std::endl;
+            return EXIT_FAILURE;
+        }
+        listings.emplace_back(assembly, object);
+    }
+
+    // --emit=asm stops at the listing, for debugging the generator
+    if (options.emit == EmitKind::Asm) {
+        return EXIT_SUCCESS;
+    }
+
     // Automatically assemble and link
+    std::vector<std::string> link_command = {"gcc"};
     //std::cout << "Assembling..." << std::endl;
-    int result = system("nasm -f win64 output.asm -o output.obj");
-    if (result != 0) {
-        std::cerr << "Assembly failed" << std::endl;
-        return EXIT_FAILURE;
+    int result;
+    for (const auto& [assembly, object] : listings) {
+        {
+            TimeReport::Phase phase(report, "assemble");
+            result = run_process({"nasm", "-f", "win64", assembly, "-o", object});
+        }
+        if (result != 0) {
+            diag << "Assembly failed" << std::endl;
+            return EXIT_FAILURE;
+        }
+        link_command.push_back(object);
     }
+    link_command.insert(link_command.end(), {"-o", paths.executable});
 
     //std::cout << "Linking..." << std::endl;
-    result = system("gcc output.obj -o output.exe");
+    {
+        TimeReport::Phase phase(report, "link");
+        result = run_process(link_command);
+    }
     if (result != 0) {
-        std::cerr << "Linking failed" << std::endl;
+        diag << "Linking failed" << std::endl;
         return EXIT_FAILURE;
     }
 
+    if (!run) {
+        return EXIT_SUCCESS;
+    }
+
     //std::cout << "Running program..." << std::endl;
-    result = system("output.exe");
-    
-    return result;
-}
\ No newline at end of file
+    TimeReport::Phase phase(report, "run");
+    return run_process({paths.run_command});
+}
+
+static void print_time_report(const Options& options, const TimeReport& report, std::ostream& diag) {
+    if (options.time_report == ReportFormat::Text) {
+        report.print(diag);
+    } else if (options.time_report == ReportFormat::Json) {
+        report.print_json(diag);
+    }
+}
+
+// Compile every input on a pool of worker threads without running the
+// programs. Returns failure if any input failed.
+static int compile_batch(const Options& options, std::ostream& diag_out, CompileCache* cache) {
+    std::atomic<size_t> next_input{0};
+    std::atomic<size_t> failures{0};
+    std::mutex diag_mutex;
+
+    auto worker = [&]() {
+        for (size_t i = next_input++; i < options.input_files.size(); i = next_input++) {
+            const std::string& input = options.input_files[i];
+            std::ostringstream diag;
+            TimeReport report(input);
+            bool reporting = options.time_report != ReportFormat::None;
+            int status = compile_file(options, input, false, diag, reporting ? &report : nullptr, cache);
+            if (status != EXIT_SUCCESS) failures++;
+
+            std::lock_guard<std::mutex> lock(diag_mutex);
+            if (!diag.str().empty()) diag_out << input << ":\n" << diag.str();
+            if (status != EXIT_SUCCESS) diag_out << "FAILED " << input << std::endl;
+            print_time_report(options, report, diag_out);
+        }
+    };
+
+    size_t thread_count = std::min<size_t>(options.jobs, options.input_files.size());
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < thread_count; t++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    if (failures > 0) {
+        diag_out << failures << " of " << options.input_files.size() << " files failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int compile(const Options& options, bool run, std::ostream& diag, CompileCache* cache) {
+    if (options.input_files.size() > 1) {
+        return compile_batch(options, diag, cache);
+    }
+    TimeReport report(options.input_files[0]);
+    bool reporting = options.time_report != ReportFormat::None;
+    int status = compile_file(options, options.input_files[0], run, diag, reporting ? &report : nullptr, cache);
+    print_time_report(options, report, diag);
+    return status;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "Incorrect Usage" << std::endl; 
+        std::cerr << "Correct Usage: durham [--target=linux-x86_64|win64] [--backend=ast|ir] [--emit=asm|exe] [--jit] [--no-run] [-j N] [--time-report[=json]]" << std::endl;
+        std::cerr << "                     [--autocorrect=off|prompt|report|apply] [--no-cache] [--cache-dir=DIR] <input.dur>..." << std::endl;
+        std::cerr << "               durham --serve[=socket]" << std::endl;
+        return EXIT_FAILURE;  // Fixed: should be FAILURE not SUCCESS
+    }
+    //std::cout << argv[1] << std::endl; 
+    //std::cout<< "Hello World" << std::endl;
+
+    std::unique_ptr<CompileCache> cache;
+    if (options.use_cache) {
+        std::string directory = options.cache_directory.empty() ? default_cache_directory() : options.cache_directory;
+        cache = std::make_unique<CompileCache>(directory);
+    }
+
+    if (options.serve_socket) {
+        CompileCache memory_only;
+        return serve(*options.serve_socket, cache ? *cache : memory_only);
+    }
+    return compile(options, options.run, std::cerr, cache.get());
+}
@@ -27,8 +27,63 @@ struct Settings {
     std::string college_one;
 }; 
 
+// What the driver produces
+enum class EmitKind {
+    Asm,    // assembly listing only
+    Exe     // executable (run it when compiling a single file)
+};
+
+// What generates the assembly
+enum class Backend {
+    Ast,    // straight from the tree
+    Ir      // through the SSA IR (falls back to Ast for code it doesn't cover)
+};
+
+// --time-report output
+enum class ReportFormat {
+    None,
+    Text,
+    Json    // one JSON object per input, for tracking regressions
+};
+
+// Command line options for a compile
+struct Options {
+    std::vector<std::string> input_files;
+    int jobs = 1;           // worker threads for multi-file compiles
+    EmitKind emit = EmitKind::Exe;
+    Backend backend = Backend::Ir;
+    bool jit = false;       // run from memory instead of writing an executable
+    bool run = true;        // run a single-file build once it is linked
+    ReportFormat time_report = ReportFormat::None;
+    AutocorrectMode autocorrect = AutocorrectMode::Prompt;
+    std::optional<std::string> serve_socket;    // --serve: run as a compile server
+    bool use_cache = true;          // reuse modules from earlier compiles of the same source
+    std::string cache_directory;    // empty for default_cache_directory()
+    std::string working_directory;  // where outputs go; empty for the current directory
+#ifdef _WIN32
+    Target target = Target::Win64;
+#else
+    Target target = Target::LinuxX86_64;
+#endif
+};
+
+// Files produced for one input
+struct OutputPaths {
+    std::string assembly;
+    std::string object;
+    std::string executable;
+    std::string run_command;
+};
+
+class CompileCache;
+
 void ask_user_info(); 
 void make_joke(User user); // make jokes depending on the user info 
 void autocorrect(int argc, int **argv); // automatically corrects code in .dur file
+bool parse_options(int argc, char** argv, Options& options, std::ostream& diag = std::cerr); // false on bad usage
+OutputPaths output_paths_for(const Options& options, const std::string& input);
+// Build every input in options (the work behind main() and --serve). Modules
+// are reused from cache when one is given.
+int compile(const Options& options, bool run, std::ostream& diag, CompileCache* cache = nullptr);
 
 #endif //MAIN_HPP
\ No newline at end of file
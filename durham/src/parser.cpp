@@ -1,22 +1,66 @@
 #include "main.h"
 #include "parser.h"
+#include <array>
+#include <optional>
 #include <iostream>
 #include <stdexcept>
 
-Parser::Parser(const std::vector<Token>& tokens) 
-    : tokens(tokens), current(0) {}
+// Binding power of each binary operator, indexed by TokenType; 0 for tokens
+// that aren't one
+static constexpr std::array<uint8_t, TOKEN_TYPE_COUNT> build_precedence_table() {
+    std::array<uint8_t, TOKEN_TYPE_COUNT> table{};
+    auto set = [&table](TokenType type, int precedence) {
+        table[static_cast<size_t>(type)] = static_cast<uint8_t>(precedence);
+    };
+    set(TokenType::_or, PREC_OR);
+    set(TokenType::_and, PREC_AND);
+    set(TokenType::_lesser, PREC_COMPARISON);
+    set(TokenType::_greater, PREC_COMPARISON);
+    set(TokenType::_equals, PREC_COMPARISON);
+    set(TokenType::_not_equals, PREC_COMPARISON);
+    set(TokenType::_durham, PREC_ADDITIVE);
+    set(TokenType::_newcastle, PREC_ADDITIVE);
+    set(TokenType::_york, PREC_MULTIPLICATIVE);
+    set(TokenType::_edinburgh, PREC_MULTIPLICATIVE);
+    set(TokenType::_remainder, PREC_MULTIPLICATIVE);
+    return table;
+}
+
+static constexpr auto BINARY_PRECEDENCE = build_precedence_table();
+
+static int binary_precedence(TokenType type) {
+    return BINARY_PRECEDENCE[static_cast<size_t>(type)];
+}
+
+static bool is_comparison(const ASTNode* node) {
+    return node->type == NodeType::BinaryOp
+        && binary_precedence(static_cast<const BinaryOpNode*>(node)->op) == PREC_COMPARISON;
+}
+
+// and, or and not: what a grouped condition may be, and an arithmetic
+// operand may not
+static bool is_logical(const ASTNode* node) {
+    if (node->type == NodeType::UnaryOp) return true;
+    if (node->type != NodeType::BinaryOp) return false;
+    int precedence = binary_precedence(static_cast<const BinaryOpNode*>(node)->op);
+    return precedence == PREC_OR || precedence == PREC_AND || precedence == PREC_COMPARISON;
+}
+
+Parser::Parser(Tokenizer& tokenizer, std::string_view source, AstArena& arena) 
+    : tokens(tokenizer), source(source), arena(arena) {}
+
+std::string Parser::text(const Token& token) const {
+    return std::string(token_text(source, token));
+}
 
 // Helper methods
 Token Parser::peek(int offset) {
-    if (current + offset >= tokens.size()) {
-        return tokens.back(); // Return last token if out of bounds
-    }
-    return tokens[current + offset];
+    return tokens.peek(offset); // end_of_file if out of bounds
 }
 
 Token Parser::advance() {
-    if (!at_end()) current++;
-    return tokens[current - 1];
+    if (!at_end()) return tokens.advance();
+    return tokens.previous();
 }
 
 bool Parser::match(TokenType type) {
@@ -38,20 +82,21 @@ Token Parser::consume(TokenType type, const std::string& message) {
 }
 
 bool Parser::at_end() {
-    return current >= tokens.size();
+    return tokens.peek().type == TokenType::end_of_file;
 }
 
 // Main parse method
-std::shared_ptr<ASTNode> Parser::parse() {
+ASTNode* Parser::parse() {
     return parseProgram();
 }
 
 // Parse entire program
-std::shared_ptr<ASTNode> Parser::parseProgram() {
-    auto program = std::make_shared<ASTNode>(NodeType::Program);
+ASTNode* Parser::parseProgram() {
+    auto program = arena.make<ASTNode>(NodeType::Program);
     
     while (!at_end()) {
-        auto stmt = parseStatement();
+        // Imports only make sense for the file as a whole
+        auto stmt = check(TokenType::_import) ? parseImport() : parseStatement();
         if (stmt) {
             program->children.push_back(stmt);
         }
@@ -61,7 +106,7 @@ std::shared_ptr<ASTNode> Parser::parseProgram() {
 }
 
 // Parse a statement
-std::shared_ptr<ASTNode> Parser::parseStatement() {
+ASTNode* Parser::parseStatement() {
     // Skip semicolons
     if (match(TokenType::semi)) {
         return nullptr;
@@ -72,6 +117,10 @@ std::shared_ptr<ASTNode> Parser::parseStatement() {
         return parseFunctionDecl();
     }
     
+    if (check(TokenType::_import)) {
+        throw std::runtime_error("'import' is only allowed outside functions and blocks");
+    }
+    
     // Return statement
     if (check(TokenType::_mcs)) {
         return parseReturn();
@@ -112,12 +161,12 @@ std::shared_ptr<ASTNode> Parser::parseStatement() {
 }
 
 // Parse assignment: x is expr. OR array at index is expr. OR function call: func begin args end.
-std::shared_ptr<ASTNode> Parser::parseAssignment() {
+ASTNode* Parser::parseAssignment() {
     Token name = consume(TokenType::identifier, "Expected variable name");
     
     // Check if it's a function call: name begin args end
     if (check(TokenType::open_paren)) {
-        auto funcCall = parseFunctionCall(name.value.value());
+        auto funcCall = parseFunctionCall(name.symbol);
         consume(TokenType::semi, "Expected '.' after function call");
         return funcCall;
     }
@@ -125,13 +174,13 @@ std::shared_ptr<ASTNode> Parser::parseAssignment() {
     // Check if it's array element assignment: array at index is value
     if (check(TokenType::_at)) {
         consume(TokenType::_at, "Expected 'at'");
-        auto arrayAccess = std::make_shared<ArrayAccessNode>(name.value.value());
+        auto arrayAccess = arena.make<ArrayAccessNode>(name.symbol);
         arrayAccess->index = parseExpression();
         
         consume(TokenType::equals, "Expected 'is' after array index");
         
         // Create an assignment node with the array access on the left
-        auto assignment = std::make_shared<AssignmentNode>(name.value.value());
+        auto assignment = arena.make<AssignmentNode>(name.symbol);
         assignment->left = arrayAccess;  // Array access
         assignment->right = parseExpression();  // Value to assign
         
@@ -142,7 +191,7 @@ std::shared_ptr<ASTNode> Parser::parseAssignment() {
     // Regular variable assignment
     consume(TokenType::equals, "Expected 'is' after variable name");
     
-    auto assignment = std::make_shared<AssignmentNode>(name.value.value());
+    auto assignment = arena.make<AssignmentNode>(name.symbol);
     assignment->right = parseExpression();
     
     consume(TokenType::semi, "Expected '.' after expression");
@@ -151,7 +200,7 @@ std::shared_ptr<ASTNode> Parser::parseAssignment() {
 }
 
 // Parse typed variable declaration: text name is "value". OR number x is butler.
-std::shared_ptr<ASTNode> Parser::parseTypedDeclaration() {
+ASTNode* Parser::parseTypedDeclaration() {
     // Consume type keyword (text or number)
     Token typeToken = advance();
     std::string varType = (typeToken.type == TokenType::_text) ? "text" : "number";
@@ -163,7 +212,7 @@ std::shared_ptr<ASTNode> Parser::parseTypedDeclaration() {
     consume(TokenType::equals, "Expected 'is' after variable name");
     
     // Parse the value expression
-    auto assignment = std::make_shared<AssignmentNode>(name.value.value(), varType);
+    auto assignment = arena.make<AssignmentNode>(name.symbol, varType);
     assignment->right = parseExpression();
     
     // Type checking: verify the expression matches the declared type
@@ -172,13 +221,13 @@ std::shared_ptr<ASTNode> Parser::parseTypedDeclaration() {
         if (assignment->right->type != NodeType::StringLiteral && 
             assignment->right->type != NodeType::Identifier &&
             assignment->right->type != NodeType::BinaryOp) {
-            throw std::runtime_error("Type error: text variable '" + name.value.value() + 
+            throw std::runtime_error("Type error: text variable '" + text(name) + 
                                    "' must be assigned a string value");
         }
     } else if (varType == "number") {
         // For number variables, check if it's a numeric literal or numeric expression
         if (assignment->right->type == NodeType::StringLiteral) {
-            throw std::runtime_error("Type error: number variable '" + name.value.value() + 
+            throw std::runtime_error("Type error: number variable '" + text(name) + 
                                    "' cannot be assigned a string value");
         }
     }
@@ -188,50 +237,26 @@ std::shared_ptr<ASTNode> Parser::parseTypedDeclaration() {
     return assignment;
 }
 
-// Parse expression: term ((+ | -) term)*
-std::shared_ptr<ASTNode> Parser::parseExpression() {
-    auto left = parseTerm();
-    
-    while (match(TokenType::_durham) || match(TokenType::_newcastle)) {
-        TokenType op = tokens[current - 1].type;
-        auto node = std::make_shared<BinaryOpNode>(op);
-        node->left = left;
-        node->right = parseTerm();
-        left = node;
-    }
-    
-    return left;
+// Parse expression: arithmetic only, comparisons belong to conditions
+ASTNode* Parser::parseExpression() {
+    return parseBinary(PREC_ADDITIVE);
 }
 
-// Parse term: factor ((* | /) factor)*
-std::shared_ptr<ASTNode> Parser::parseTerm() {
-    auto left = parseFactor();
-    
-    while (match(TokenType::_york) || match(TokenType::_edinburgh)) {
-        TokenType op = tokens[current - 1].type;
-        auto node = std::make_shared<BinaryOpNode>(op);
-        node->left = left;
-        node->right = parseFactor();
-        left = node;
-    }
-    
-    return left;
-}
-
-// Parse factor: primary or (expression) or string
-std::shared_ptr<ASTNode> Parser::parseFactor() {
+// Parse factor: primary or (expression) or string. In a condition
+// "begin ... end" may also group a condition.
+ASTNode* Parser::parseFactor(bool condition) {
     if (match(TokenType::open_paren)) {
         // Check if it's a string literal: begin "text" end
         if (check(TokenType::quotations)) {
             consume(TokenType::quotations, "Expected string");
-            auto stringNode = std::make_shared<ASTNode>(NodeType::StringLiteral);
-            stringNode->value = tokens[current - 1].value.value();
+            auto stringNode = arena.make<ASTNode>(NodeType::StringLiteral);
+            stringNode->value = text(tokens.previous());
             consume(TokenType::close_paren, "Expected 'end' after string");
             return stringNode;
         }
         
         // Otherwise it's a parenthesized expression
-        auto expr = parseExpression();
+        auto expr = condition ? parseCondition() : parseExpression();
         consume(TokenType::close_paren, "Expected 'end' after expression");
         return expr;
     }
@@ -240,9 +265,9 @@ std::shared_ptr<ASTNode> Parser::parseFactor() {
 }
 
 // Parse primary: number or identifier
-std::shared_ptr<ASTNode> Parser::parsePrimary() {
+ASTNode* Parser::parsePrimary() {
     if (match(TokenType::int_lit)) {
-        return std::make_shared<LiteralNode>(tokens[current - 1].value.value());
+        return arena.make<LiteralNode>(college_number_value(token_text(source, tokens.previous())));
     }
     
     // Vector allocation: new college begin SIZE end
@@ -251,7 +276,7 @@ std::shared_ptr<ASTNode> Parser::parsePrimary() {
     }
     
     if (match(TokenType::identifier)) {
-        std::string name = tokens[current - 1].value.value();
+        Symbol name = tokens.previous().symbol;
         
         // Check for function call: identifier begin args end
         if (check(TokenType::open_paren)) {
@@ -264,45 +289,101 @@ std::shared_ptr<ASTNode> Parser::parsePrimary() {
         }
         
         // Regular identifier
-        auto node = std::make_shared<ASTNode>(NodeType::Identifier, name);
+        auto node = arena.make<ASTNode>(NodeType::Identifier, name);
         return node;
     }
     
     throw std::runtime_error("Expected expression");
 }
 
-// Parse condition: expr (< | > | == | !=) expr (or/and expr)*
-std::shared_ptr<ASTNode> Parser::parseCondition() {
-    auto left = parseExpression();
-    
-    // Comparison operators
-    if (match(TokenType::_lesser) || match(TokenType::_greater) || 
-        match(TokenType::_equals) || match(TokenType::_not_equals)) {
-        TokenType op = tokens[current - 1].type;
-        auto node = std::make_shared<BinaryOpNode>(op);
-        node->left = left;
-        node->right = parseExpression();
-        left = node;
+// Parse condition: comparisons of expressions joined by and/or, with not
+ASTNode* Parser::parseCondition() {
+    return parseBinary(PREC_OR);
+}
+
+// Operator precedence parsing of operators binding at least as tightly as
+// min_precedence. Operands and pending operators are kept on explicit stacks,
+// so a long chain like "a durham b durham c ..." costs no native recursion;
+// only "begin ... end" nests.
+// An "or" after an "and" at one level is legal, but versions before
+// precedence climbing read "a and b or c" as "a and (b or c)", so it is
+// flagged. "a or b and c" meant "a or (b and c)" then too.
+ASTNode* Parser::parseBinary(int min_precedence) {
+    struct PendingOperator {
+        TokenType op;
+        int precedence;
+        bool prefix;
+    };
+    std::vector<ASTNode*> operands;
+    std::vector<PendingOperator> operators;
+    bool condition = min_precedence <= PREC_NOT;
+    bool seen_and = false;
+    std::optional<Token> or_after_and;     // the first 'or' whose meaning changed
+
+    auto reduce = [&]() {
+        PendingOperator top = operators.back();
+        operators.pop_back();
+        if (top.prefix) {
+            auto node = arena.make<UnaryOpNode>(top.op);
+            node->left = operands.back();
+            operands.back() = node;
+        } else {
+            auto node = arena.make<BinaryOpNode>(top.op);
+            node->right = operands.back();
+            operands.pop_back();
+            node->left = operands.back();
+            operands.back() = node;
+        }
+    };
+
+    while (true) {
+        while (condition && match(TokenType::_not)) {
+            operators.push_back({TokenType::_not, PREC_NOT, true});
+        }
+        // Only a grouped condition comes back from a factor as logical. It has
+        // no value, so it can only be negated or joined with and/or.
+        operands.push_back(parseFactor(condition));
+        bool logical = is_logical(operands.back());
+        if (logical && !operators.empty() && operators.back().precedence > PREC_NOT) {
+            throw std::runtime_error("A grouped condition can't be compared or used in arithmetic");
+        }
+
+        TokenType op = peek().type;
+        int precedence = binary_precedence(op);
+        if (precedence == 0 || precedence < min_precedence) break;
+        if (logical && precedence > PREC_NOT) {
+            throw std::runtime_error("A grouped condition can't be compared or used in arithmetic");
+        }
+        if (op == TokenType::_and) seen_and = true;
+        if (op == TokenType::_or && seen_and && !or_after_and) or_after_and = peek();
+
+        // Left associative: everything pending that binds as tightly goes first
+        while (!operators.empty() && operators.back().precedence >= precedence) {
+            reduce();
+        }
+        // Comparisons don't chain; leave the second one for the caller to reject
+        if (precedence == PREC_COMPARISON && is_comparison(operands.back())) break;
+
+        advance();
+        operators.push_back({op, precedence, false});
     }
-    
-    // Logical operators (or/and)
-    while (match(TokenType::_or) || match(TokenType::_and)) {
-        TokenType op = tokens[current - 1].type;
-        auto node = std::make_shared<BinaryOpNode>(op);
-        node->left = left;
-        node->right = parseCondition();
-        left = node;
+
+    while (!operators.empty()) {
+        reduce();
     }
-    
-    return left;
+    if (or_after_and) {
+        warnings.push_back({or_after_and->offset, "'or' after 'and' now reads as '(a and b) or c' (older "
+                            "versions read 'a and (b or c)'); group with begin ... end"});
+    }
+    return operands.back();
 }
 
 // Parse if: if begin condition end front body back
-std::shared_ptr<ASTNode> Parser::parseIfStatement() {
+ASTNode* Parser::parseIfStatement() {
     consume(TokenType::_if, "Expected 'if'");
     consume(TokenType::open_paren, "Expected 'begin' after 'if'");
     
-    auto ifNode = std::make_shared<IfNode>();
+    auto ifNode = arena.make<IfNode>();
     ifNode->condition = parseCondition();
     
     consume(TokenType::close_paren, "Expected 'end' after condition");
@@ -313,7 +394,7 @@ std::shared_ptr<ASTNode> Parser::parseIfStatement() {
     consume(TokenType::close_brace, "Expected 'back' after if body");
     
     // Check for else clause
-    if (current < tokens.size() && peek().type == TokenType::_else) {
+    if (check(TokenType::_else)) {
         consume(TokenType::_else, "Expected 'else'");
         consume(TokenType::open_brace, "Expected 'front' after 'else'");
         
@@ -326,11 +407,11 @@ std::shared_ptr<ASTNode> Parser::parseIfStatement() {
 }
 
 // Parse while: while begin condition end front body back
-std::shared_ptr<ASTNode> Parser::parseWhileLoop() {
+ASTNode* Parser::parseWhileLoop() {
     consume(TokenType::_while, "Expected 'while'");
     consume(TokenType::open_paren, "Expected 'begin' after 'while'");
     
-    auto whileNode = std::make_shared<WhileNode>();
+    auto whileNode = arena.make<WhileNode>();
     whileNode->condition = parseCondition();
     
     consume(TokenType::close_paren, "Expected 'end' after condition");
@@ -344,11 +425,11 @@ std::shared_ptr<ASTNode> Parser::parseWhileLoop() {
 }
 
 // Parse for: for begin init . condition . increment end front body back
-std::shared_ptr<ASTNode> Parser::parseForLoop() {
+ASTNode* Parser::parseForLoop() {
     consume(TokenType::_for, "Expected 'for'");
     consume(TokenType::open_paren, "Expected 'begin' after 'for'");
     
-    auto forNode = std::make_shared<ForNode>();
+    auto forNode = arena.make<ForNode>();
     
     // Initialization
     forNode->init = parseAssignment();
@@ -360,7 +441,7 @@ std::shared_ptr<ASTNode> Parser::parseForLoop() {
     // Increment (parse assignment without consuming semicolon)
     Token name = consume(TokenType::identifier, "Expected variable name");
     consume(TokenType::equals, "Expected 'is' after variable name");
-    auto assignment = std::make_shared<AssignmentNode>(name.value.value());
+    auto assignment = arena.make<AssignmentNode>(name.symbol);
     assignment->right = parseExpression();
     forNode->increment = assignment;
     // Note: No semicolon consumed here - 'end' comes directly after increment
@@ -376,8 +457,8 @@ std::shared_ptr<ASTNode> Parser::parseForLoop() {
 }
 
 // Parse block of statements
-std::shared_ptr<ASTNode> Parser::parseBlock() {
-    auto block = std::make_shared<ASTNode>(NodeType::Block);
+ASTNode* Parser::parseBlock() {
+    auto block = arena.make<ASTNode>(NodeType::Block);
     
     while (!check(TokenType::close_brace) && !at_end()) {
         auto stmt = parseStatement();
@@ -390,16 +471,16 @@ std::shared_ptr<ASTNode> Parser::parseBlock() {
 }
 
 // Parse print: tlc begin expr end.
-std::shared_ptr<ASTNode> Parser::parsePrint() {
+ASTNode* Parser::parsePrint() {
     consume(TokenType::_tlc, "Expected 'tlc'");
     consume(TokenType::open_paren, "Expected 'begin' after 'tlc'");
     
-    auto printNode = std::make_shared<ASTNode>(NodeType::Print);
+    auto printNode = arena.make<ASTNode>(NodeType::Print);
     
     // Check if it's a string literal: tlc begin "string" end.
     if (check(TokenType::quotations)) {
         Token strToken = advance();
-        printNode->value = strToken.value;  // Store the string
+        printNode->value = text(strToken);  // Store the string
     } else {
         // Regular expression: tlc begin expr end.
         printNode->left = parseExpression();
@@ -412,11 +493,11 @@ std::shared_ptr<ASTNode> Parser::parsePrint() {
 }
 
 // Parse vector allocation: new college begin SIZE end
-std::shared_ptr<ASTNode> Parser::parseVectorAlloc() {
+ASTNode* Parser::parseVectorAlloc() {
     consume(TokenType::_college, "Expected 'college' after 'new'");
     consume(TokenType::open_paren, "Expected 'begin' after 'college'");
     
-    auto vectorNode = std::make_shared<VectorAllocNode>();
+    auto vectorNode = arena.make<VectorAllocNode>();
     vectorNode->size = parseExpression();
     
     consume(TokenType::close_paren, "Expected 'end' after size");
@@ -425,21 +506,21 @@ std::shared_ptr<ASTNode> Parser::parseVectorAlloc() {
 }
 
 // Parse array access: array at index
-std::shared_ptr<ASTNode> Parser::parseArrayAccess(const std::string& arrayName) {
+ASTNode* Parser::parseArrayAccess(Symbol arrayName) {
     consume(TokenType::_at, "Expected 'at'");
     
-    auto accessNode = std::make_shared<ArrayAccessNode>(arrayName);
+    auto accessNode = arena.make<ArrayAccessNode>(arrayName);
     accessNode->index = parseExpression();
     
     return accessNode;
 }
 
 // Parse function declaration: function name begin param1 and param2 end front body back
-std::shared_ptr<ASTNode> Parser::parseFunctionDecl() {
+ASTNode* Parser::parseFunctionDecl() {
     consume(TokenType::_function, "Expected 'function'");
     
     Token nameToken = consume(TokenType::identifier, "Expected function name");
-    auto funcNode = std::make_shared<FunctionDeclNode>(nameToken.value.value());
+    auto funcNode = arena.make<FunctionDeclNode>(nameToken.symbol);
     
     consume(TokenType::open_paren, "Expected 'begin' after function name");
     
@@ -447,7 +528,7 @@ std::shared_ptr<ASTNode> Parser::parseFunctionDecl() {
     if (!check(TokenType::close_paren)) {
         do {
             Token param = consume(TokenType::identifier, "Expected parameter name");
-            funcNode->parameters.push_back(param.value.value());
+            funcNode->parameters.push_back(param.symbol);
             
             if (match(TokenType::_and)) {
                 continue; // More parameters
@@ -469,10 +550,10 @@ std::shared_ptr<ASTNode> Parser::parseFunctionDecl() {
 }
 
 // Parse return statement: mcs expression.
-std::shared_ptr<ASTNode> Parser::parseReturn() {
+ASTNode* Parser::parseReturn() {
     consume(TokenType::_mcs, "Expected 'mcs'");
     
-    auto returnNode = std::make_shared<ReturnNode>();
+    auto returnNode = arena.make<ReturnNode>();
     returnNode->returnValue = parseExpression();
     
     consume(TokenType::semi, "Expected '.' after return value");
@@ -480,9 +561,18 @@ std::shared_ptr<ASTNode> Parser::parseReturn() {
     return returnNode;
 }
 
+// Parse import: import name. (the module in name.dur beside this file)
+ASTNode* Parser::parseImport() {
+    consume(TokenType::_import, "Expected 'import'");
+    Token name = consume(TokenType::identifier, "Expected module name after 'import'");
+    consume(TokenType::semi, "Expected '.' after import");
+    
+    return arena.make<ASTNode>(NodeType::Import, name.symbol);
+}
+
 // Parse function call: name begin arg1 and arg2 end
-std::shared_ptr<ASTNode> Parser::parseFunctionCall(const std::string& functionName) {
-    auto callNode = std::make_shared<ASTNode>(NodeType::FunctionCall, functionName);
+ASTNode* Parser::parseFunctionCall(Symbol functionName) {
+    auto callNode = arena.make<ASTNode>(NodeType::FunctionCall, functionName);
     
     consume(TokenType::open_paren, "Expected 'begin' for function call");
     
@@ -5,6 +5,7 @@
 #include <vector>
 #include "main.h"
 #include "tokenizer.h"
+#include "ast_arena.h"
 
 
 //using namespace std; 
@@ -30,25 +31,28 @@ enum class NodeType {
     Condition, 
     Print,
     VectorAlloc,    // new college begin SIZE end
-    ArrayAccess     // ARRAY at INDEX
+    ArrayAccess,    // ARRAY at INDEX
+    Import          // import NAME: symbol is the module's name
 }; 
 
 struct ASTNode {
     NodeType type; 
     std::optional<std::string> value; 
-    std::shared_ptr<ASTNode> left; 
-    std::shared_ptr<ASTNode> right; 
-    std::vector<std::shared_ptr<ASTNode>> children; 
-
-    ASTNode(NodeType t) : type(t), left(nullptr), right(nullptr) {}
-    ASTNode(NodeType t, const std::string& val) : type(t), value(val), left(nullptr), right(nullptr) {}
+    Symbol symbol;      // the name of an Identifier or FunctionCall
+    ASTNode* left; 
+    ASTNode* right; 
+    std::vector<ASTNode*> children; 
+
+    ASTNode(NodeType t) : type(t), symbol(NO_SYMBOL), left(nullptr), right(nullptr) {}
+    ASTNode(NodeType t, const std::string& val) : type(t), value(val), symbol(NO_SYMBOL), left(nullptr), right(nullptr) {}
+    ASTNode(NodeType t, Symbol name) : type(t), symbol(name), left(nullptr), right(nullptr) {}
 }; 
 
 struct LiteralNode : public ASTNode {
-    std::string literalValue;
+    int64_t literalValue;
     
-    LiteralNode(const std::string& val) 
-        : ASTNode(NodeType::Literal, val), literalValue(val) {}
+    LiteralNode(int64_t val) 
+        : ASTNode(NodeType::Literal), literalValue(val) {}
 };
 
 struct BinaryOpNode : public ASTNode {
@@ -58,71 +62,97 @@ struct BinaryOpNode : public ASTNode {
         : ASTNode(NodeType::BinaryOp), op(operation) {}
 };
 
+// Prefix operator (not); the operand is left
+struct UnaryOpNode : public ASTNode {
+    TokenType op;
+    
+    UnaryOpNode(TokenType operation) 
+        : ASTNode(NodeType::UnaryOp), op(operation) {}
+};
+
 struct AssignmentNode : public ASTNode {
-    std::string varName;
+    Symbol varName;
     std::string varType;  // "text", "number", or "" (untyped/inferred)
     
-    AssignmentNode(const std::string& name, const std::string& type = "") 
-        : ASTNode(NodeType::Assignment, name), varName(name), varType(type) {}
+    AssignmentNode(Symbol name, const std::string& type = "") 
+        : ASTNode(NodeType::Assignment), varName(name), varType(type) {}
 };
 
 struct IfNode : public ASTNode {
-    std::shared_ptr<ASTNode> condition;
-    std::shared_ptr<ASTNode> thenBranch;
-    std::shared_ptr<ASTNode> elseBranch;
+    ASTNode* condition = nullptr;
+    ASTNode* thenBranch = nullptr;
+    ASTNode* elseBranch = nullptr;
     
     IfNode() : ASTNode(NodeType::IfStatement) {}
 };
 
 struct WhileNode : public ASTNode {
-    std::shared_ptr<ASTNode> condition;
-    std::shared_ptr<ASTNode> body;
+    ASTNode* condition = nullptr;
+    ASTNode* body = nullptr;
     
     WhileNode() : ASTNode(NodeType::WhileLoop) {}
 };
 
 struct ForNode : public ASTNode {
-    std::shared_ptr<ASTNode> init; 
-    std::shared_ptr<ASTNode> condition; 
-    std::shared_ptr<ASTNode> increment; 
-    std::shared_ptr<ASTNode> body;
+    ASTNode* init = nullptr; 
+    ASTNode* condition = nullptr; 
+    ASTNode* increment = nullptr; 
+    ASTNode* body = nullptr;
     
     ForNode() : ASTNode(NodeType::ForLoop) {}
 }; 
 
 struct VectorAllocNode : public ASTNode {
-    std::shared_ptr<ASTNode> size;  // Size expression
+    ASTNode* size = nullptr;  // Size expression
     
     VectorAllocNode() : ASTNode(NodeType::VectorAlloc) {}
 };
 
 struct ArrayAccessNode : public ASTNode {
-    std::string arrayName;
-    std::shared_ptr<ASTNode> index;  // Index expression
+    Symbol arrayName;
+    ASTNode* index = nullptr;  // Index expression
     
-    ArrayAccessNode(const std::string& name) 
-        : ASTNode(NodeType::ArrayAccess, name), arrayName(name) {}
+    ArrayAccessNode(Symbol name) 
+        : ASTNode(NodeType::ArrayAccess), arrayName(name) {}
 };
 
 struct FunctionDeclNode : public ASTNode {
-    std::string functionName;
-    std::vector<std::string> parameters;  // Parameter names
-    std::shared_ptr<ASTNode> body;        // Function body (Block)
+    Symbol functionName;
+    std::vector<Symbol> parameters;       // Parameter names
+    ASTNode* body = nullptr;        // Function body (Block)
     
-    FunctionDeclNode(const std::string& name) 
-        : ASTNode(NodeType::FunctionDecl, name), functionName(name) {}
+    FunctionDeclNode(Symbol name) 
+        : ASTNode(NodeType::FunctionDecl), functionName(name) {}
 };
 
 struct ReturnNode : public ASTNode {
-    std::shared_ptr<ASTNode> returnValue;  // Expression to return
+    ASTNode* returnValue = nullptr;  // Expression to return
     
     ReturnNode() : ASTNode(NodeType::Return) {}
 };
 
+// Operator precedence, loosest first
+inline constexpr int PREC_OR = 1;
+inline constexpr int PREC_AND = 2;
+inline constexpr int PREC_NOT = 3;          // prefix
+inline constexpr int PREC_COMPARISON = 4;
+inline constexpr int PREC_ADDITIVE = 5;
+inline constexpr int PREC_MULTIPLICATIVE = 6;
+
+// Something that parses but may not mean what the author meant
+struct ParseWarning {
+    size_t offset;          // of the token in the source
+    std::string message;
+};
+
 class Parser {
     private:
-        std::vector<Token> tokens; 
-        size_t current; 
+        TokenStream tokens;         // pulled from the tokenizer as parsing goes
+        std::string_view source;    // token spans point into this
+        AstArena& arena;            // owns every node made
+        std::vector<ParseWarning> warnings;
+
+        std::string text(const Token& token) const;
 
         Token peek(int offset = 0); 
         Token advance(); 
@@ -131,29 +161,32 @@ class Parser {
         bool check(TokenType type);
         bool at_end(); 
 
-        std::shared_ptr<ASTNode> parseProgram();
-        std::shared_ptr<ASTNode> parseStatement();
-        std::shared_ptr<ASTNode> parseAssignment();
-        std::shared_ptr<ASTNode> parseExpression();
-        std::shared_ptr<ASTNode> parseComparison();
-        std::shared_ptr<ASTNode> parseTerm();
-        std::shared_ptr<ASTNode> parseFactor();
-        std::shared_ptr<ASTNode> parsePrimary();
-        std::shared_ptr<ASTNode> parseIfStatement();
-        std::shared_ptr<ASTNode> parseWhileLoop();
-        std::shared_ptr<ASTNode> parseForLoop();
-        std::shared_ptr<ASTNode> parseBlock();
-        std::shared_ptr<ASTNode> parsePrint();
-        std::shared_ptr<ASTNode> parseCondition();
-        std::shared_ptr<ASTNode> parseVectorAlloc();
-        std::shared_ptr<ASTNode> parseArrayAccess(const std::string& arrayName);
-        std::shared_ptr<ASTNode> parseFunctionDecl();
-        std::shared_ptr<ASTNode> parseReturn();
-        std::shared_ptr<ASTNode> parseFunctionCall(const std::string& functionName);
-        std::shared_ptr<ASTNode> parseTypedDeclaration();
+        ASTNode* parseProgram();
+        ASTNode* parseStatement();
+        ASTNode* parseAssignment();
+        ASTNode* parseExpression();
+        ASTNode* parseBinary(int min_precedence);
+        ASTNode* parseFactor(bool condition = false);
+        ASTNode* parsePrimary();
+        ASTNode* parseIfStatement();
+        ASTNode* parseWhileLoop();
+        ASTNode* parseForLoop();
+        ASTNode* parseBlock();
+        ASTNode* parsePrint();
+        ASTNode* parseCondition();
+        ASTNode* parseVectorAlloc();
+        ASTNode* parseArrayAccess(Symbol arrayName);
+        ASTNode* parseFunctionDecl();
+        ASTNode* parseReturn();
+        ASTNode* parseFunctionCall(Symbol functionName);
+        ASTNode* parseTypedDeclaration();
+        ASTNode* parseImport();
     public: 
-        Parser(const std::vector<Token>& tokens);
-        std::shared_ptr<ASTNode> parse(); 
+        // Tokens are lexed on demand; the tokenizer must outlive the parser.
+        // Nodes live as long as arena.
+        Parser(Tokenizer& tokenizer, std::string_view source, AstArena& arena);
+        ASTNode* parse(); 
+        const std::vector<ParseWarning>& getWarnings() const { return warnings; }
 
 }; 
 
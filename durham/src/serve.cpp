@@ -0,0 +1,230 @@
+#include "serve.h"
+#include "serve_protocol.h"
+#include "main.h"
+#include "compile_cache.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+
+// Drain a --jit child's stdout and stderr, whichever it writes to first
+static void read_child_output(int out_fd, int err_fd, std::string& output, std::string& errors) {
+    pollfd fds[2] = {{out_fd, POLLIN, 0}, {err_fd, POLLIN, 0}};
+    std::string* sinks[2] = {&output, &errors};
+    int open_count = 2;
+    char buffer[4096];
+    while (open_count > 0) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int i = 0; i < 2; i++) {
+            if (fds[i].fd < 0 || fds[i].revents == 0) continue;
+            ssize_t got = read(fds[i].fd, buffer, sizeof(buffer));
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) {
+                fds[i].fd = -1;
+                open_count--;
+            } else {
+                sinks[i]->append(buffer, static_cast<size_t>(got));
+            }
+        }
+    }
+}
+
+// A --jit program runs in the compiler's address space, so a request runs
+// this compiler again as `durham --jit ...` in the client's directory: a crash
+// then fails the request instead of the server. The server is multithreaded,
+// so between fork and exec the child only makes async-signal-safe calls.
+static std::vector<std::string> run_jit_request(const std::vector<std::string>& request, bool prompt) {
+    std::vector<std::string> arguments(request.begin() + 1, request.end());
+    if (prompt) arguments.push_back("--autocorrect=report");   // nobody can answer
+    std::vector<char*> argv = {const_cast<char*>("durham")};
+    for (auto& argument : arguments) {
+        argv.push_back(argument.data());
+    }
+    argv.push_back(nullptr);
+    const char* directory = request[0].c_str();
+
+    int out[2], err[2];
+    if (pipe2(out, O_CLOEXEC) != 0) {
+        return {std::to_string(EXIT_FAILURE), "", std::string("Error: pipe failed: ") + std::strerror(errno) + "\n", ""};
+    }
+    if (pipe2(err, O_CLOEXEC) != 0) {
+        close(out[0]);
+        close(out[1]);
+        return {std::to_string(EXIT_FAILURE), "", std::string("Error: pipe failed: ") + std::strerror(errno) + "\n", ""};
+    }
+    pid_t child = fork();
+    if (child == 0) {
+        if (chdir(directory) == 0 && dup2(out[1], STDOUT_FILENO) >= 0 && dup2(err[1], STDERR_FILENO) >= 0) {
+            execv("/proc/self/exe", argv.data());
+        }
+        _exit(127);
+    }
+    int fork_error = errno;
+    close(out[1]);
+    close(err[1]);
+    if (child < 0) {
+        close(out[0]);
+        close(err[0]);
+        return {std::to_string(EXIT_FAILURE), "", std::string("Error: fork failed: ") + std::strerror(fork_error) + "\n", ""};
+    }
+
+    std::string output, errors;
+    read_child_output(out[0], err[0], output, errors);
+    close(out[0]);
+    close(err[0]);
+    int wait_status = 0;
+    while (waitpid(child, &wait_status, 0) < 0 && errno == EINTR) {}
+
+    int status = EXIT_FAILURE;
+    if (WIFEXITED(wait_status)) {
+        status = WEXITSTATUS(wait_status);
+        if (status == 127 && output.empty() && errors.empty()) {
+            errors = "Error: Could not run the compiler in " + request[0] + "\n";
+        }
+    } else if (WIFSIGNALED(wait_status)) {
+        errors += std::string("Error: program terminated by ") + strsignal(WTERMSIG(wait_status)) + "\n";
+    }
+    return {std::to_string(status), output, errors, ""};
+}
+
+// Reply: status, --jit output, diagnostics, executable for the client to run
+static std::vector<std::string> handle_request(const std::vector<std::string>& request, CompileCache& cache) {
+    std::ostringstream diag;
+    if (request.empty()) {
+        return {std::to_string(EXIT_FAILURE), "", "Error: empty request\n", ""};
+    }
+
+    std::vector<char*> argv = {const_cast<char*>("durham")};
+    for (size_t i = 1; i < request.size(); i++) {
+        argv.push_back(const_cast<char*>(request[i].c_str()));
+    }
+    Options options;
+    if (!parse_options(static_cast<int>(argv.size()), argv.data(), options, diag) || options.serve_socket) {
+        diag << "Incorrect Usage" << std::endl;
+        return {std::to_string(EXIT_FAILURE), "", diag.str(), ""};
+    }
+    if (options.jit) {
+        return run_jit_request(request, options.autocorrect == AutocorrectMode::Prompt);
+    }
+
+    // Nobody can answer a prompt here; report the suggestions to the client
+    if (options.autocorrect == AutocorrectMode::Prompt) {
+        options.autocorrect = AutocorrectMode::Report;
+    }
+
+    // Paths are relative to the client, not the server
+    std::filesystem::path working_directory(request[0]);
+    options.working_directory = request[0];
+    for (auto& input : options.input_files) {
+        input = (working_directory / input).lexically_normal().string();
+    }
+
+    int status = compile(options, false, diag, &cache);
+
+    // A single-file compile runs its program, as it would locally
+    std::string run_path;
+    if (status == EXIT_SUCCESS && options.run && options.emit == EmitKind::Exe
+            && options.input_files.size() == 1) {
+        run_path = output_paths_for(options, options.input_files[0]).executable;
+    }
+    return {std::to_string(status), "", diag.str(), run_path};
+}
+
+int serve(const std::string& socket_path, CompileCache& cache) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: Socket path too long: " << socket_path << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::strcpy(address.sun_path, socket_path.c_str());
+
+    std::string directory_error;
+    if (!prepare_socket_directory(socket_path, directory_error)) {
+        std::cerr << "Error: Refusing to serve on " << socket_path << ": " << directory_error << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // A socket file nobody answers on was left behind by a server that was
+    // killed; one that answers belongs to a live server
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    bool live = probe >= 0 && connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    if (probe >= 0) close(probe);
+    if (live) {
+        std::cerr << "Error: A durham server is already listening on " << socket_path << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Only this user may connect: the socket is 0600 from bind onwards, and
+    // every client is checked again on accept
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    unlink(socket_path.c_str());
+    mode_t old_mask = umask(0177);
+    bool bound = listener >= 0 && bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    umask(old_mask);
+    if (!bound || chmod(socket_path.c_str(), 0600) != 0 || listen(listener, 64) != 0) {
+        std::cerr << "Error: Could not listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // A client that disconnects before its reply must only fail its own
+    // request, not kill the server on the write
+    std::signal(SIGPIPE, SIG_IGN);
+
+    // Requests never prompt, but keep stray reads off the terminal
+    if (!std::freopen("/dev/null", "r", stdin)) {
+        std::cerr << "Warning: Could not detach stdin" << std::endl;
+    }
+    std::cerr << "durham: serving on " << socket_path << std::endl;
+
+    while (true) {
+        int client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Error: accept failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        if (!peer_is_current_user(client)) {
+            std::cerr << "Warning: Refused a connection from another user" << std::endl;
+            close(client);
+            continue;
+        }
+        std::thread([client, &cache]() {
+            std::vector<std::string> request;
+            if (receive_strings(client, request) && !send_strings(client, handle_request(request, cache))) {
+                std::cerr << "Warning: Client disconnected before its reply was sent" << std::endl;
+            }
+            close(client);
+        }).detach();
+    }
+    close(listener);
+    unlink(socket_path.c_str());
+    return EXIT_FAILURE;
+}
+
+#else
+
+int serve(const std::string&, CompileCache&) {
+    std::cerr << "Error: --serve is only supported on POSIX systems" << std::endl;
+    return EXIT_FAILURE;
+}
+
+#endif
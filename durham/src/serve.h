@@ -0,0 +1,13 @@
+#ifndef SERVE_H
+#define SERVE_H
+
+#include <string>
+
+class CompileCache;
+
+// durham --serve: accept compile requests (see serve_protocol.h) on a Unix
+// domain socket until killed. Compiled modules stay in cache between
+// requests.
+int serve(const std::string& socket_path, CompileCache& cache);
+
+#endif //SERVE_H
@@ -0,0 +1,132 @@
+#include "serve_protocol.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::string default_socket_path() {
+    if (const char* path = std::getenv("DURHAM_SOCKET")) {
+        return path;
+    }
+#ifdef _WIN32
+    return "durham.sock";
+#else
+    if (const char* runtime = std::getenv("XDG_RUNTIME_DIR"); runtime && *runtime) {
+        return std::string(runtime) + "/durham.sock";
+    }
+    return "/tmp/durham-" + std::to_string(getuid()) + "/durham.sock";
+#endif
+}
+
+#ifndef _WIN32
+
+bool prepare_socket_directory(const std::string& socket_path, std::string& error) {
+    size_t slash = socket_path.rfind('/');
+    std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : socket_path.substr(0, slash);
+    if (mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST) {
+        error = "Could not create " + directory + ": " + std::strerror(errno);
+        return false;
+    }
+
+    // Whoever can replace the socket can impersonate the server, so the
+    // directory must be ours (or root's) and, if others may write to it,
+    // sticky so they cannot remove our socket
+    struct stat info;
+    if (lstat(directory.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)) {
+        error = directory + " is not a directory";
+        return false;
+    }
+    if (info.st_uid != getuid() && info.st_uid != 0) {
+        error = directory + " belongs to another user";
+        return false;
+    }
+    if ((info.st_mode & (S_IWGRP | S_IWOTH)) != 0 && (info.st_mode & S_ISVTX) == 0) {
+        error = directory + " is writable by other users";
+        return false;
+    }
+    return true;
+}
+
+bool peer_is_current_user(int fd) {
+    ucred credentials{};
+    socklen_t size = sizeof(credentials);
+    return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &size) == 0
+        && size == sizeof(credentials) && credentials.uid == getuid();
+}
+
+static bool write_all(int fd, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+static bool read_all(int fd, void* data, size_t size) {
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t got = read(fd, bytes, size);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        bytes += got;
+        size -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+bool send_strings(int fd, const std::vector<std::string>& strings) {
+    uint32_t count = static_cast<uint32_t>(strings.size());
+    if (!write_all(fd, &count, sizeof(count))) return false;
+    for (const auto& string : strings) {
+        uint32_t length = static_cast<uint32_t>(string.size());
+        if (!write_all(fd, &length, sizeof(length)) || !write_all(fd, string.data(), length)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool receive_strings(int fd, std::vector<std::string>& strings) {
+    uint32_t count;
+    if (!read_all(fd, &count, sizeof(count))) return false;
+    strings.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t length;
+        if (!read_all(fd, &length, sizeof(length))) return false;
+        std::string string(length, '\0');
+        if (!read_all(fd, string.data(), length)) return false;
+        strings.push_back(std::move(string));
+    }
+    return true;
+}
+
+#else
+
+bool prepare_socket_directory(const std::string&, std::string& error) {
+    error = "sockets need a POSIX system";
+    return false;
+}
+
+bool peer_is_current_user(int) {
+    return false;
+}
+
+bool send_strings(int, const std::vector<std::string>&) {
+    return false;
+}
+
+bool receive_strings(int, std::vector<std::string>&) {
+    return false;
+}
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef SERVE_PROTOCOL_H
+#define SERVE_PROTOCOL_H
+
+#include <string>
+#include <vector>
+
+// Wire format between durhamc and durham --serve. A request is the client's
+// working directory followed by its arguments; the reply is the exit status,
+// the program's output (--jit), the compiler's diagnostics and, when the
+// client should run the result, the executable. Every message is a count
+// followed by length-prefixed strings.
+
+// $DURHAM_SOCKET, else durham.sock in $XDG_RUNTIME_DIR or in a private
+// /tmp/durham-<uid> directory
+std::string default_socket_path();
+
+// Create the socket's directory (0700) if it is missing, and refuse one
+// that another user could swap the socket out of
+bool prepare_socket_directory(const std::string& socket_path, std::string& error);
+
+// Whether the process at the other end of a connected socket runs as this
+// user (SO_PEERCRED); both ends check before trusting the other
+bool peer_is_current_user(int fd);
+
+bool send_strings(int fd, const std::vector<std::string>& strings);
+bool receive_strings(int fd, std::vector<std::string>& strings);
+
+#endif //SERVE_PROTOCOL_H
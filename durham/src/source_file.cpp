@@ -0,0 +1,76 @@
+#include "source_file.h"
+#include <fstream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+SourceFile::~SourceFile() {
+    close();
+}
+
+bool SourceFile::open(const std::string& path) {
+    close();
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    // Only regular files are mapped; pipes, /dev/stdin and `<(gen)` are read
+    // from the descriptor already open, since they can't be opened twice
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* region = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (region != MAP_FAILED) {
+            ::close(fd);
+            data = static_cast<const char*>(region);
+            size = static_cast<size_t>(info.st_size);
+            mapped = true;
+            return true;
+        }
+    }
+
+    char chunk[65536];
+    while (true) {
+        ssize_t got = ::read(fd, chunk, sizeof(chunk));
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0) {
+            ::close(fd);
+            buffer.clear();
+            return false;
+        }
+        if (got == 0) break;
+        buffer.append(chunk, static_cast<size_t>(got));
+    }
+    ::close(fd);
+    data = buffer.data();
+    size = buffer.size();
+    return true;
+#endif
+
+    // Not POSIX: read it once
+    std::ifstream input(path, std::ios::binary);
+    if (!input.is_open()) return false;
+    std::stringstream contents;
+    contents << input.rdbuf();
+    buffer = contents.str();
+    data = buffer.data();
+    size = buffer.size();
+    return true;
+}
+
+void SourceFile::close() {
+#ifndef _WIN32
+    if (mapped) {
+        munmap(const_cast<char*>(data), size);
+    }
+#endif
+    data = nullptr;
+    size = 0;
+    mapped = false;
+    buffer.clear();
+}
@@ -0,0 +1,29 @@
+#ifndef SOURCE_FILE_H
+#define SOURCE_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only view of a source file. On POSIX a regular file is mapped into
+// memory so the tokenizer reads it in place; pipes and other streams, and
+// every file elsewhere, are read once into owned storage.
+class SourceFile {
+    public:
+        SourceFile() = default;
+        ~SourceFile();
+        SourceFile(const SourceFile&) = delete;
+        SourceFile& operator=(const SourceFile&) = delete;
+
+        bool open(const std::string& path);     // false if it can't be read
+        void close();
+        std::string_view text() const { return {data, size}; }
+
+    private:
+        const char* data = nullptr;
+        size_t size = 0;
+        bool mapped = false;
+        std::string buffer;     // contents when the file isn't mapped
+};
+
+#endif //SOURCE_FILE_H
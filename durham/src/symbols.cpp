@@ -0,0 +1,11 @@
+#include "symbols.h"
+
+Symbol SymbolTable::intern(std::string_view name) {
+    auto known = ids.find(name);
+    if (known != ids.end()) return known->second;
+
+    Symbol symbol = static_cast<Symbol>(names.size());
+    names.emplace_back(name);
+    ids.emplace(names.back(), symbol);
+    return symbol;
+}
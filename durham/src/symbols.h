@@ -0,0 +1,28 @@
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Identifier names are interned once, as the tokenizer meets them, and every
+// later stage compares and indexes by the 32-bit id. Ids are dense from 0, so
+// per-symbol state can live in a vector of size() entries.
+using Symbol = uint32_t;
+inline constexpr Symbol NO_SYMBOL = UINT32_MAX;
+
+// One table per compilation, shared by the tokenizer, parser and codegen
+class SymbolTable {
+    public:
+        Symbol intern(std::string_view name);
+        std::string_view name(Symbol symbol) const { return names[symbol]; }
+        size_t size() const { return names.size(); }
+
+    private:
+        std::deque<std::string> names;      // by id; a deque so the keys below stay valid
+        std::unordered_map<std::string_view, Symbol> ids;
+};
+
+#endif //SYMBOLS_H
@@ -0,0 +1,244 @@
+#include "time_report.h"
+#include "parser.h"
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <new>
+#include <sstream>
+#include <unordered_set>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+static thread_local uint64_t allocation_count = 0;
+static thread_local uint64_t allocated_bytes = 0;
+
+// Count every heap allocation; array and nothrow forms forward to this one
+void* operator new(std::size_t size) {
+    allocation_count++;
+    allocated_bytes += size;
+    if (void* memory = std::malloc(size ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+uint64_t thread_allocation_count() {
+    return allocation_count;
+}
+
+uint64_t thread_allocated_bytes() {
+    return allocated_bytes;
+}
+
+static double wall_now_ms() {
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+// CPU time of this thread plus any child processes it waited on (nasm, gcc,
+// the compiled program), so the run phase isn't reported as free
+static double cpu_now_ms() {
+#ifdef _WIN32
+    return 1000.0 * std::clock() / CLOCKS_PER_SEC;
+#else
+    timespec thread_time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &thread_time);
+    rusage children;
+    getrusage(RUSAGE_CHILDREN, &children);
+    return thread_time.tv_sec * 1000.0 + thread_time.tv_nsec / 1e6
+         + (children.ru_utime.tv_sec + children.ru_stime.tv_sec) * 1000.0
+         + (children.ru_utime.tv_usec + children.ru_stime.tv_usec) / 1000.0;
+#endif
+}
+
+TimeReport::Phase::Phase(TimeReport* report, const char* name)
+    : report(report), name(name), wall_start(0), cpu_start(0), allocations_start(0), bytes_start(0) {
+    if (!report) return;
+    allocations_start = allocation_count;
+    bytes_start = allocated_bytes;
+    cpu_start = cpu_now_ms();
+    wall_start = wall_now_ms();
+}
+
+TimeReport::Phase::~Phase() {
+    if (!report) return;
+    double wall_end = wall_now_ms();
+    double cpu_end = cpu_now_ms();
+    PhaseTiming timing{name, wall_end - wall_start, cpu_end - cpu_start,
+                       allocation_count - allocations_start, allocated_bytes - bytes_start};
+    for (auto& phase : report->phases) {
+        if (phase.name == timing.name) {
+            phase.wall_ms += timing.wall_ms;
+            phase.cpu_ms += timing.cpu_ms;
+            phase.allocations += timing.allocations;
+            phase.allocated_bytes += timing.allocated_bytes;
+            return;
+        }
+    }
+    report->phases.push_back(timing);
+}
+
+void TimeReport::count(const std::string& name, uint64_t value) {
+    for (auto& [existing, total] : counts) {
+        if (existing == name) {
+            total += value;
+            return;
+        }
+    }
+    counts.emplace_back(name, value);
+}
+
+void TimeReport::print(std::ostream& out) const {
+    std::ostringstream text;
+    text << "Time report for " << input << "\n";
+    text << std::left << std::setw(12) << "  phase" << std::right
+         << std::setw(12) << "wall ms" << std::setw(12) << "cpu ms"
+         << std::setw(10) << "allocs" << std::setw(12) << "bytes" << "\n";
+
+    PhaseTiming total{"total", 0, 0, 0, 0};
+    auto row = [&](const PhaseTiming& phase) {
+        text << "  " << std::left << std::setw(10) << phase.name << std::right << std::fixed << std::setprecision(3)
+             << std::setw(12) << phase.wall_ms << std::setw(12) << phase.cpu_ms
+             << std::setw(10) << phase.allocations << std::setw(12) << phase.allocated_bytes << "\n";
+    };
+    for (const auto& phase : phases) {
+        row(phase);
+        total.wall_ms += phase.wall_ms;
+        total.cpu_ms += phase.cpu_ms;
+        total.allocations += phase.allocations;
+        total.allocated_bytes += phase.allocated_bytes;
+    }
+    row(total);
+
+    for (const auto& [name, value] : counts) {
+        text << "  " << name << ": " << value << "\n";
+    }
+    out << text.str();
+}
+
+static void write_json_string(std::ostream& out, const std::string& value) {
+    out << '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c)
+                << std::dec << std::setfill(' ');
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+void TimeReport::print_json(std::ostream& out) const {
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(3);
+    json << "{\"input\":";
+    write_json_string(json, input);
+    json << ",\"phases\":[";
+    for (size_t i = 0; i < phases.size(); i++) {
+        const auto& phase = phases[i];
+        if (i > 0) json << ",";
+        json << "{\"name\":";
+        write_json_string(json, phase.name);
+        json << ",\"wall_ms\":" << phase.wall_ms << ",\"cpu_ms\":" << phase.cpu_ms
+             << ",\"allocations\":" << phase.allocations
+             << ",\"allocated_bytes\":" << phase.allocated_bytes << "}";
+    }
+    json << "],\"counts\":{";
+    for (size_t i = 0; i < counts.size(); i++) {
+        if (i > 0) json << ",";
+        write_json_string(json, counts[i].first);
+        json << ":" << counts[i].second;
+    }
+    json << "}}\n";
+    out << json.str();
+}
+
+static void collect_nodes(const ASTNode* node, std::unordered_set<const ASTNode*>& seen) {
+    // Operator chains lean left, so the left child is visited by looping
+    for (; node && seen.insert(node).second; node = node->left) {
+        collect_nodes(node->right, seen);
+        for (const auto& child : node->children) {
+            collect_nodes(child, seen);
+        }
+
+        // Subclasses keep some children in named fields
+        switch (node->type) {
+            case NodeType::IfStatement: {
+                auto ifNode = static_cast<const IfNode*>(node);
+                collect_nodes(ifNode->condition, seen);
+                collect_nodes(ifNode->thenBranch, seen);
+                collect_nodes(ifNode->elseBranch, seen);
+                break;
+            }
+            case NodeType::WhileLoop: {
+                auto whileNode = static_cast<const WhileNode*>(node);
+                collect_nodes(whileNode->condition, seen);
+                collect_nodes(whileNode->body, seen);
+                break;
+            }
+            case NodeType::ForLoop: {
+                auto forNode = static_cast<const ForNode*>(node);
+                collect_nodes(forNode->init, seen);
+                collect_nodes(forNode->condition, seen);
+                collect_nodes(forNode->increment, seen);
+                collect_nodes(forNode->body, seen);
+                break;
+            }
+            case NodeType::VectorAlloc:
+                collect_nodes(static_cast<const VectorAllocNode*>(node)->size, seen);
+                break;
+            case NodeType::ArrayAccess:
+                collect_nodes(static_cast<const ArrayAccessNode*>(node)->index, seen);
+                break;
+            case NodeType::FunctionDecl:
+                collect_nodes(static_cast<const FunctionDeclNode*>(node)->body, seen);
+                break;
+            case NodeType::Return:
+                collect_nodes(static_cast<const ReturnNode*>(node)->returnValue, seen);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+size_t count_ast_nodes(const ASTNode* node) {
+    std::unordered_set<const ASTNode*> seen;
+    collect_nodes(node, seen);
+    return seen.size();
+}
+
+// Lines of the listing that are machine instructions: not blank, a comment,
+// a label, or a directive
+size_t count_instructions(const std::string& assembly) {
+    static const std::unordered_set<std::string> directives = {
+        "section", "global", "extern", "default", "bits", "align",
+        "db", "dw", "dd", "dq", "resb", "resw", "resd", "resq", "times"
+    };
+
+    size_t count = 0;
+    std::istringstream lines(assembly);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::istringstream words(line.substr(0, line.find(';')));
+        std::string first, second;
+        if (!(words >> first) || first.back() == ':') continue;
+        if (directives.count(first)) continue;
+        // "name db ..." / "name equ ..." define data, not code
+        if (words >> second && (directives.count(second) || second == "equ")) continue;
+        count++;
+    }
+    return count;
+}
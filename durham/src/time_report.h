@@ -0,0 +1,64 @@
+#ifndef TIME_REPORT_H
+#define TIME_REPORT_H
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct ASTNode;
+
+// Per-phase wall/CPU time and heap traffic for one compile (--time-report).
+// A phase or count met again (once per imported module) is added to the
+// first, so each name appears once.
+class TimeReport {
+    public:
+        // Times a phase from construction to destruction. A null report makes
+        // it a no-op so call sites don't need to check.
+        class Phase {
+            public:
+                Phase(TimeReport* report, const char* name);
+                ~Phase();
+                Phase(const Phase&) = delete;
+                Phase& operator=(const Phase&) = delete;
+
+            private:
+                TimeReport* report;
+                const char* name;
+                double wall_start;
+                double cpu_start;
+                uint64_t allocations_start;
+                uint64_t bytes_start;
+        };
+
+        explicit TimeReport(const std::string& input) : input(input) {}
+
+        void count(const std::string& name, uint64_t value);
+        void print(std::ostream& out) const;
+        void print_json(std::ostream& out) const;   // one object per line
+
+    private:
+        struct PhaseTiming {
+            std::string name;
+            double wall_ms;
+            double cpu_ms;
+            uint64_t allocations;
+            uint64_t allocated_bytes;
+        };
+
+        std::string input;
+        std::vector<PhaseTiming> phases;
+        std::vector<std::pair<std::string, uint64_t>> counts;
+};
+
+// Heap allocations made by the calling thread so far (operator new is
+// replaced in time_report.cpp to keep these)
+uint64_t thread_allocation_count();
+uint64_t thread_allocated_bytes();
+
+size_t count_ast_nodes(const ASTNode* node);
+size_t count_instructions(const std::string& assembly);
+
+#endif //TIME_REPORT_H
@@ -1,76 +1,140 @@
 #include "tokenizer.h"
+#include "keywords.h"
+#include "char_scan.h"
 #include <algorithm>
+#include <array>
+#include <future>
 #include <limits>
+#include <mutex>
+#include <thread>
 
 // Constructor
-Tokenizer::Tokenizer(const std::string& source) : src(source), index(0), corrections_made(false) {}
+Tokenizer::Tokenizer(std::string_view source, SymbolTable& symbols, AutocorrectMode mode)
+    : index(0), limit(source.size()), src(source), symbols(symbols), mode(mode) {}
+
+Tokenizer::Tokenizer(std::string_view source, size_t begin, size_t end, SymbolTable& symbols,
+                     AutocorrectMode mode)
+    : index(static_cast<int>(begin)), limit(end), src(source), symbols(symbols), mode(mode) {}
 
 // Destructor
 Tokenizer::~Tokenizer() {}
 
-// Calculate Levenshtein distance between two strings
-int Tokenizer::levenshteinDistance(const std::string& s1, const std::string& s2) {
-    const size_t len1 = s1.size(), len2 = s2.size();
-    std::vector<std::vector<int>> d(len1 + 1, std::vector<int>(len2 + 1));
+// Keywords a misspelt word can be corrected to, in order of preference
+static constexpr std::string_view SUGGESTION_KEYWORDS[] = {
+    "tlc", "mcs", "for", "if", "while", "new", "college", "at",
+    "durham", "newcastle", "york", "edinburgh",
+    "and", "or", "not", "greater", "lesser", "equals",
+    "is", "begin", "end", "front", "back"
+};
+static constexpr size_t SUGGESTION_KEYWORD_COUNT = sizeof(SUGGESTION_KEYWORDS) / sizeof(SUGGESTION_KEYWORDS[0]);
+
+// Per keyword, bit i of letter_masks[c - 'a'] is set where keyword[i] == c
+struct KeywordPattern {
+    uint64_t letter_masks[26];
+    int length;
+};
+
+static constexpr std::array<KeywordPattern, SUGGESTION_KEYWORD_COUNT> build_keyword_patterns() {
+    std::array<KeywordPattern, SUGGESTION_KEYWORD_COUNT> patterns{};
+    for (size_t k = 0; k < SUGGESTION_KEYWORD_COUNT; k++) {
+        std::string_view keyword = SUGGESTION_KEYWORDS[k];
+        patterns[k].length = static_cast<int>(keyword.size());
+        for (size_t i = 0; i < keyword.size(); i++) {
+            patterns[k].letter_masks[keyword[i] - 'a'] |= uint64_t(1) << i;
+        }
+    }
+    return patterns;
+}
 
-    for (size_t i = 0; i <= len1; ++i) d[i][0] = static_cast<int>(i);
-    for (size_t j = 0; j <= len2; ++j) d[0][j] = static_cast<int>(j);
+static constexpr auto KEYWORD_PATTERNS = build_keyword_patterns();
 
-    for (size_t i = 1; i <= len1; ++i) {
-        for (size_t j = 1; j <= len2; ++j) {
-            int cost = (s1[i - 1] == s2[j - 1]) ? 0 : 1;
-            d[i][j] = std::min({d[i - 1][j] + 1, d[i][j - 1] + 1, d[i - 1][j - 1] + cost});
+constexpr bool suggestion_keywords_fit() {
+    for (std::string_view keyword : SUGGESTION_KEYWORDS) {
+        if (keyword.empty() || keyword.size() > 64) return false;
+        for (char c : keyword) {
+            if (c < 'a' || c > 'z') return false;
         }
     }
-    return d[len1][len2];
+    return true;
+}
+static_assert(suggestion_keywords_fit(), "suggestion keywords must be 1-64 lowercase letters");
+
+// Levenshtein distance from word to a keyword, or limit + 1 once it is known
+// to exceed limit. Bit-parallel (Myers/Hyyro): one column of the DP matrix per
+// word character, held in the vertical delta bit vectors vp and vn.
+static int bounded_edit_distance(std::string_view word, const KeywordPattern& keyword, int limit) {
+    int length_difference = static_cast<int>(word.size()) - keyword.length;
+    if (length_difference > limit || -length_difference > limit) return limit + 1;
+
+    const uint64_t last = uint64_t(1) << (keyword.length - 1);
+    uint64_t vp = ~uint64_t(0);
+    uint64_t vn = 0;
+    int distance = keyword.length;
+    for (size_t j = 0; j < word.size(); j++) {
+        unsigned letter = static_cast<unsigned char>(word[j]) - 'a';
+        uint64_t eq = letter < 26 ? keyword.letter_masks[letter] : 0;
+        uint64_t xv = eq | vn;
+        uint64_t xh = (((eq & vp) + vp) ^ vp) | eq;
+        uint64_t hp = vn | ~(xh | vp);
+        uint64_t hn = vp & xh;
+        if (hp & last) distance++;
+        else if (hn & last) distance--;
+        // Each remaining character lowers the distance by at most one
+        if (distance - static_cast<int>(word.size() - j - 1) > limit) return limit + 1;
+        hp = (hp << 1) | 1;
+        hn <<= 1;
+        vp = hn | ~(xv | hp);
+        vn = hp & xv;
+    }
+    return distance <= limit ? distance : limit + 1;
 }
 
 // Suggest a correction for an unknown word
-std::optional<std::string> Tokenizer::suggestCorrection(const std::string& word) {
-    static const std::vector<std::string> keywords = {
-        "tlc", "mcs", "for", "if", "while", "new", "college", "at",
-        "durham", "newcastle", "york", "edinburgh",
-        "and", "or", "not", "greater", "lesser", "equals",
-        "is", "begin", "end", "front", "back"
-    };
-    
+std::optional<std::string> Tokenizer::suggestCorrection(std::string_view word) {
+    // Repeated identifiers are only checked once per compilation
+    auto known = suggestion_memo.find(word);
+    if (known != suggestion_memo.end()) {
+        if (known->second.empty()) return std::nullopt;
+        return std::string(known->second);
+    }
+
+    std::string_view bestMatch;
+
     // Special case for 2-letter words - only suggest if very close to 3-letter keyword
+    // Single letter words are never corrected (definitely variable names)
     if (word.length() == 2) {
-        for (const auto& keyword : keywords) {
-            if (keyword.length() == 3 && levenshteinDistance(word, keyword) == 1) {
-                return keyword;
+        for (size_t k = 0; k < SUGGESTION_KEYWORD_COUNT; k++) {
+            if (KEYWORD_PATTERNS[k].length == 3 && bounded_edit_distance(word, KEYWORD_PATTERNS[k], 1) == 1) {
+                bestMatch = SUGGESTION_KEYWORDS[k];
+                break;
             }
         }
-        return std::nullopt;
-    }
-    
-    // Don't suggest corrections for single letter words (definitely variable names)
-    if (word.length() <= 1) {
-        return std::nullopt;
-    }
-    
-    int minDist = std::numeric_limits<int>::max();
-    std::string bestMatch;
-    
-    for (const auto& keyword : keywords) {
-        int dist = levenshteinDistance(word, keyword);
-        // Only suggest if distance is 1 or 2 (typo or missing/extra char)
-        // AND the word length is similar (within 2 chars)
-        if (dist > 0 && dist <= 2 && dist < minDist && 
-            abs((int)word.length() - (int)keyword.length()) <= 2) {
-            minDist = dist;
-            bestMatch = keyword;
+    } else if (word.length() > 2) {
+        // Only suggest if distance is 1 or 2 (typo or missing/extra char),
+        // which also keeps the lengths within 2 chars
+        int limit = 2;
+        for (size_t k = 0; k < SUGGESTION_KEYWORD_COUNT; k++) {
+            int dist = bounded_edit_distance(word, KEYWORD_PATTERNS[k], limit);
+            if (dist > 0 && dist <= limit) {
+                bestMatch = SUGGESTION_KEYWORDS[k];
+                // Later keywords must be strictly closer to replace this one
+                limit = dist - 1;
+                if (limit == 0) break;
+            }
         }
     }
-    
-    if (!bestMatch.empty()) {
-        return bestMatch;
-    }
-    return std::nullopt;
+
+    suggestion_memo.emplace(word, bestMatch);
+    if (bestMatch.empty()) return std::nullopt;
+    return std::string(bestMatch);
 }
 
 // Prompt user for correction and apply to source
 bool Tokenizer::promptUserForCorrection(const std::string& original, const std::string& suggestion, int position) {
+    // One question at a time when several files are tokenized in parallel
+    static std::mutex prompt_mutex;
+    std::lock_guard<std::mutex> lock(prompt_mutex);
+
     std::cout << "\nUnknown token: '" << original << "'" << std::endl;
     std::cout << "Did you mean: '" << suggestion << "'? (y/n): ";
     
@@ -78,54 +142,49 @@ bool Tokenizer::promptUserForCorrection(const std::string& original, const std::
     std::getline(std::cin, response);
     
     if (!response.empty() && (response[0] == 'y' || response[0] == 'Y')) {
-        // Replace in source string
-        int start_pos = position - original.length();
-        if (start_pos >= 0 && start_pos + original.length() <= src.length()) {
-            src.replace(start_pos, original.length(), suggestion);
-            // Adjust index for the length difference
-            index = index - original.length() + suggestion.length();
-            corrections_made = true;
-        }
-        return true;
+        return recordCorrection(original, suggestion, position);
     }
     return false;
 }
 
+// Record the replacement of the word ending at position; the source itself is
+// never modified
+bool Tokenizer::recordCorrection(const std::string& original, const std::string& suggestion, int position) {
+    int start_pos = position - original.length();
+    if (start_pos >= 0 && start_pos + original.length() <= src.length()) {
+        corrections.push_back({static_cast<size_t>(start_pos), original.length(), suggestion});
+    }
+    return true;
+}
+
+std::string Tokenizer::getCorrectedSource() const {
+    std::string corrected;
+    corrected.reserve(src.size());
+    size_t copied = 0;
+    for (const auto& correction : corrections) {
+        corrected.append(src.substr(copied, correction.offset - copied));
+        corrected.append(correction.replacement);
+        copied = correction.offset + correction.length;
+    }
+    corrected.append(src.substr(copied));
+    return corrected;
+}
+
 std::optional<char> Tokenizer::peek(int offset) {
-    if (index + offset >= src.length()) {
+    if (static_cast<size_t>(index + offset) >= limit) {
         return {}; 
     }
-    return src.at(index + offset);
+    return src[index + offset];
 }
 
 char Tokenizer::consume() {
-    return src.at(index++); 
+    return src[index++]; 
 }
 
 // Returns the decimal value as a string for colleges representing 0-16
 std::optional<std::string> college_to_decimal(const std::string& college) {
-    static const std::map<std::string, std::string> lookup = {
-        {"butler", "0"},
-        {"chads", "1"},
-        {"marys", "2"},
-        {"collingwood", "3"},
-        {"johns", "4"},
-        {"castle", "5"},
-        {"cuths", "6"},
-        {"trevs", "7"},
-        {"aidans", "8"},
-        {"snow", "9"},
-        {"grey", "10"},
-        {"stephenson", "11"},
-        {"hatfield", "12"},
-        {"hildbede", "13"},
-        {"south", "14"},
-        {"vanmildert", "15"},
-        {"ustinov", "16"}
-    };
-    
-    auto it = lookup.find(college);
-    if (it != lookup.end()) return it->second;
+    const KeywordEntry* entry = lookup_keyword(college);
+    if (entry && entry->type == TokenType::int_lit) return std::string(entry->digits);
     return std::nullopt;
 }
 
@@ -138,40 +197,57 @@ std::optional<char> college_to_digit(const std::string& college) {
     return std::nullopt;
 }
 
-std::vector<Token> Tokenizer::tokenize() {
-    std::vector<Token> tokens;
-    
+// Token covering src[start, index)
+static Token make_token(TokenType type, int start, int end) {
+    return {type, static_cast<uint32_t>(start), static_cast<uint32_t>(end - start), NO_SYMBOL};
+}
+
+// value = value * 10 + digit for each decimal digit; false on int64 overflow
+static bool append_decimal_digits(int64_t& value, std::string_view digits) {
+    for (char c : digits) {
+        int digit = c - '0';
+        if (value > (std::numeric_limits<int64_t>::max() - digit) / 10) return false;
+        value = value * 10 + digit;
+    }
+    return true;
+}
+
+Token Tokenizer::identifier_token(int start, int end) {
+    Token token = make_token(TokenType::identifier, start, end);
+    token.symbol = symbols.intern(src.substr(start, end - start));
+    return token;
+}
+
+// Lex the next raw token; end_of_file once the source is exhausted
+Token Tokenizer::scan() {
     while (peek().has_value()) {
         // Skip whitespace
         if (std::isspace(peek().value())) {
-            consume();
+            index = static_cast<int>(skip_whitespace(src.data(), index, limit));
             continue;
         }
         // Single character tokens
         if (peek().value() == '.') {
             consume();
-            tokens.push_back({TokenType::semi});  // Changed: '.' is semicolon equivalent
-            continue;
+            return make_token(TokenType::semi, index - 1, index);  // Changed: '.' is semicolon equivalent
         }
         
         // String literals and comments with quotation marks
         if (peek().value() == '"') {
             // Check if the previous token was 'begin' (for strings: begin "..." end)
-            bool is_string_context = !tokens.empty() && tokens.back().type == TokenType::open_paren;
+            bool is_string_context = last_type == TokenType::open_paren;
             
             consume(); // consume opening quote
-            std::string str_value;
-            
-            while (peek().has_value() && peek().value() != '"') {
-                str_value += consume();
-            }
+            int start = index;
+            index = static_cast<int>(find_quote(src.data(), index, limit));
             
             if (peek().has_value() && peek().value() == '"') {
+                int end = index;
                 consume(); // consume closing quote
                 
                 // String literal: begin "text" end (for print or assignment)
                 if (is_string_context) {
-                    tokens.push_back({TokenType::quotations, str_value});
+                    return make_token(TokenType::quotations, start, end);
                 }
                 // Otherwise, it's a comment - skip it entirely
             } else {
@@ -182,166 +258,83 @@ std::vector<Token> Tokenizer::tokenize() {
         
         // Alphabetic tokens (keywords, identifiers, college names)
         if (std::isalpha(peek().value())) {
-            std::string buffer;
+            int start = index;
             
             // Consume all alphabetic characters
-            while (peek().has_value() && std::isalpha(peek().value())) {
-                buffer += consume();
-            }
+            index = static_cast<int>(skip_letters(src.data(), index, limit));
+            std::string_view word = src.substr(start, index - start);
             
+            const KeywordEntry* keyword = lookup_keyword(word);
+
             // Check if it's a college name (digit)
-            auto decimal_value = college_to_decimal(buffer);
-            if (decimal_value.has_value()) {
-                std::string number_string = decimal_value.value();
+            if (keyword && keyword->type == TokenType::int_lit) {
+                int end = index;
+                // Each college appends its decimal digits: chads,grey is 110
+                int64_t value = 0;
+                bool fits = append_decimal_digits(value, keyword->digits);
                 
                 // Handle multi-digit numbers with ','
                 while (peek().has_value() && peek().value() == ',') {
                     consume(); // consume comma
                     
-                    buffer.clear();
-                    while (peek().has_value() && std::isalpha(peek().value())) {
-                        buffer += consume();
-                    }
+                    int digit_start = index;
+                    index = static_cast<int>(skip_letters(src.data(), index, limit));
                     
-                    decimal_value = college_to_decimal(buffer);
-                    if (decimal_value.has_value()) {
-                        number_string += decimal_value.value();
+                    std::string_view digit_word = src.substr(digit_start, index - digit_start);
+                    const KeywordEntry* digit = lookup_keyword(digit_word);
+                    if (digit && digit->type == TokenType::int_lit) {
+                        end = index;
+                        fits = fits && append_decimal_digits(value, digit->digits);
                     } else {
-                        std::cerr << "Error: Unknown college name '" << buffer << "'" << std::endl;
+                        std::cerr << "Error: Unknown college name '" << digit_word << "'" << std::endl;
                         break;
                     }
                 }
                 
-                tokens.push_back({TokenType::int_lit, number_string});
+                if (!fits) {
+                    errors.push_back({static_cast<size_t>(start),
+                                      "number '" + std::string(src.substr(start, end - start))
+                                      + "' does not fit in 64 bits"});
+                }
+                // The span covers "college,college,..."; the parser reads the
+                // value back from it
+                return make_token(TokenType::int_lit, start, end);
             } 
-            // Check for keywords
-            else if (buffer == "tlc") {
-                tokens.push_back({TokenType::_tlc});
-            } else if (buffer == "mcs") {
-                tokens.push_back({TokenType::_mcs});
-            } else if (buffer == "for") {
-                tokens.push_back({TokenType::_for});
-            } else if (buffer == "if") {
-                tokens.push_back({TokenType::_if});
-            } else if (buffer == "else") {
-                tokens.push_back({TokenType::_else});
-            } else if (buffer == "while") {
-                tokens.push_back({TokenType::_while});
-            } else if (buffer == "function") {
-                tokens.push_back({TokenType::_function});
-            // Type keywords
-            } else if (buffer == "text") {
-                tokens.push_back({TokenType::_text});
-            } else if (buffer == "number") {
-                tokens.push_back({TokenType::_number});
-            // Vector/Array keywords
-            } else if (buffer == "new") {
-                tokens.push_back({TokenType::_new});
-            } else if (buffer == "college") {
-                tokens.push_back({TokenType::_college});
-            } else if (buffer == "at") {
-                tokens.push_back({TokenType::_at});
-            // Arithmetic operators
-            } else if (buffer == "durham") {
-                tokens.push_back({TokenType::_durham});
-            } else if (buffer == "newcastle") {
-                tokens.push_back({TokenType::_newcastle});
-            } else if (buffer == "york") {
-                tokens.push_back({TokenType::_york});
-            } else if (buffer == "edinburgh") {
-                tokens.push_back({TokenType::_edinburgh});
-            // Logical operators
-            } else if (buffer == "and") {
-                tokens.push_back({TokenType::_and});
-            } else if (buffer == "or") {
-                tokens.push_back({TokenType::_or});
-            } else if (buffer == "not") {
-                tokens.push_back({TokenType::_not});
-            // Comparison operators
-            } else if (buffer == "greater") {
-                tokens.push_back({TokenType::_greater});
-            } else if (buffer == "lesser") {
-                tokens.push_back({TokenType::_lesser});
-            } else if (buffer == "equals") {
-                tokens.push_back({TokenType::_equals});
-            } else if (buffer == "not") {
-                tokens.push_back({TokenType::_not});
-            } else if (buffer == "is") {
-                tokens.push_back({TokenType::equals});  // "is" keyword for assignment
-            } else if (buffer == "begin") {
-                tokens.push_back({TokenType::open_paren}); 
-            } else if (buffer == "end") {
-                tokens.push_back({TokenType::close_paren}); 
-            } else if (buffer == "front") {
-                tokens.push_back({TokenType::open_brace}); 
-            } else if (buffer == "back") {
-                tokens.push_back({TokenType::close_brace}); 
+            // Keywords, operators and punctuation words
+            else if (keyword) {
+                return make_token(keyword->type, start, index);
             } else {
-                // Check if this might be a typo
-                auto suggestion = suggestCorrection(buffer);
+                // Check if this might be a typo (the search is skipped entirely when off)
+                std::optional<std::string> suggestion;
+                if (mode != AutocorrectMode::Off) {
+                    suggestion = suggestCorrection(word);
+                }
                 
-                if (suggestion.has_value()) {
-                    if (promptUserForCorrection(buffer, suggestion.value(), index)) {
+                if (suggestion.has_value() && mode == AutocorrectMode::Report) {
+                    // Reported after lexing; the word stays an identifier
+                    suggestions.push_back({static_cast<size_t>(start), std::string(word), suggestion.value()});
+                    return identifier_token(start, index);
+                } else if (suggestion.has_value()) {
+                    bool accepted = mode == AutocorrectMode::Apply
+                        ? recordCorrection(std::string(word), suggestion.value(), index)
+                        : promptUserForCorrection(std::string(word), suggestion.value(), index);
+                    if (accepted) {
                         // User accepted correction - re-tokenize the corrected word
-                        std::string corrected = suggestion.value();
-                        
-                        // Map corrected keywords to tokens
-                        if (corrected == "tlc") {
-                            tokens.push_back({TokenType::_tlc});
-                        } else if (corrected == "mcs") {
-                            tokens.push_back({TokenType::_mcs});
-                        } else if (corrected == "for") {
-                            tokens.push_back({TokenType::_for});
-                        } else if (corrected == "if") {
-                            tokens.push_back({TokenType::_if});
-                        } else if (corrected == "while") {
-                            tokens.push_back({TokenType::_while});
-                        } else if (corrected == "new") {
-                            tokens.push_back({TokenType::_new});
-                        } else if (corrected == "college") {
-                            tokens.push_back({TokenType::_college});
-                        } else if (corrected == "at") {
-                            tokens.push_back({TokenType::_at});
-                        } else if (corrected == "durham") {
-                            tokens.push_back({TokenType::_durham});
-                        } else if (corrected == "newcastle") {
-                            tokens.push_back({TokenType::_newcastle});
-                        } else if (corrected == "york") {
-                            tokens.push_back({TokenType::_york});
-                        } else if (corrected == "edinburgh") {
-                            tokens.push_back({TokenType::_edinburgh});
-                        } else if (corrected == "and") {
-                            tokens.push_back({TokenType::_and});
-                        } else if (corrected == "or") {
-                            tokens.push_back({TokenType::_or});
-                        } else if (corrected == "not") {
-                            tokens.push_back({TokenType::_not});
-                        } else if (corrected == "greater") {
-                            tokens.push_back({TokenType::_greater});
-                        } else if (corrected == "lesser") {
-                            tokens.push_back({TokenType::_lesser});
-                        } else if (corrected == "equals") {
-                            tokens.push_back({TokenType::_equals});
-                        } else if (corrected == "is") {
-                            tokens.push_back({TokenType::equals});
-                        } else if (corrected == "begin") {
-                            tokens.push_back({TokenType::open_paren});
-                        } else if (corrected == "end") {
-                            tokens.push_back({TokenType::close_paren});
-                        } else if (corrected == "front") {
-                            tokens.push_back({TokenType::open_brace});
-                        } else if (corrected == "back") {
-                            tokens.push_back({TokenType::close_brace});
+                        if (mode == AutocorrectMode::Prompt) {
+                            std::cout << "Correction applied in memory. Continuing compilation..." << std::endl;
                         }
                         
-                        std::cout << "Correction applied in memory. Continuing compilation..." << std::endl;
+                        const KeywordEntry* corrected = lookup_keyword(suggestion.value());
+                        if (corrected) {
+                            return make_token(corrected->type, start, index);
+                        }
                     } else {
                         // User rejected - treat as identifier
-                        tokens.push_back({TokenType::identifier, buffer});
+                        return identifier_token(start, index);
                     }
                 } else {
                     // No suggestion found - treat as identifier (variable name)
-                    tokens.push_back({TokenType::identifier, buffer});
+                    return identifier_token(start, index);
                 }
             }
             
@@ -353,20 +346,170 @@ std::vector<Token> Tokenizer::tokenize() {
         consume();
     }
     
-    // Post-processing: combine consecutive tokens
-    std::vector<Token> processed_tokens;
-    for (size_t i = 0; i < tokens.size(); i++) {
-        if (i + 1 < tokens.size() && 
-            tokens[i].type == TokenType::_not && 
-            tokens[i + 1].type == TokenType::_equals) {
-            // Combine into not_equals
-            processed_tokens.push_back({TokenType::_not_equals});
-            i++; // Skip the next token since we combined them
+    return make_token(TokenType::end_of_file, index, index);
+}
+
+Token Tokenizer::next() {
+    // Large files are lexed in chunks on several threads, a few chunks ahead
+    // of the parser. Prompts have to be asked in source order, so not in that
+    // mode.
+    if (chunk_bounds.empty() && lex_threads > 1 && index == 0 && limit >= PARALLEL_LEX_MIN_BYTES
+        && mode != AutocorrectMode::Prompt) {
+        startParallelLex();
+    }
+    if (!chunk_bounds.empty()) {
+        while (chunk_next == chunk_tokens.size()) {
+            if (!takeChunk()) return make_token(TokenType::end_of_file, index, index);
+        }
+        return chunk_tokens[chunk_next++];
+    }
+
+    Token token;
+    if (pending) {
+        token = *pending;
+        pending.reset();
+    } else {
+        token = scan();
+        last_type = token.type;
+    }
+
+    // "not equals" is a single operator; merged with one token of lookahead
+    if (token.type == TokenType::_not) {
+        Token following = scan();
+        last_type = following.type;
+        if (following.type == TokenType::_equals) {
+            uint32_t end = following.offset + following.length;
+            token = {TokenType::_not_equals, token.offset, end - token.offset, NO_SYMBOL};
         } else {
-            processed_tokens.push_back(tokens[i]);
+            pending = following;
         }
     }
-    
-    return processed_tokens;
+
+    if (token.type != TokenType::end_of_file) token_count++;
+    return token;
+}
+
+// Chunk boundaries go just after a '.' outside any string or comment, so no
+// token spans two chunks and each chunk starts in the same state as a fresh
+// statement: nothing in a string, and no "begin" or "not" before it.
+std::vector<size_t> Tokenizer::chunkBounds(size_t chunk_count) const {
+    std::vector<size_t> bounds = {0};
+    size_t cursor = 0;
+    bool in_string = false;
+    for (size_t c = 1; c < chunk_count; c++) {
+        size_t target = limit * c / chunk_count;
+        // Quote parity up to the target
+        while (cursor < target) {
+            size_t quote = find_quote(src.data(), cursor, target);
+            if (quote >= target) {
+                cursor = target;
+                break;
+            }
+            in_string = !in_string;
+            cursor = quote + 1;
+        }
+        // Then on to the next terminator
+        while (cursor < limit && (in_string || src[cursor] != '.')) {
+            if (src[cursor] == '"') in_string = !in_string;
+            cursor++;
+        }
+        if (++cursor >= limit) break;
+        bounds.push_back(cursor);
+    }
+    bounds.push_back(limit);
+    return bounds;
+}
+
+void Tokenizer::startParallelLex() {
+    size_t chunk_count = std::min<size_t>(lex_threads, limit / PARALLEL_LEX_MIN_CHUNK);
+    chunk_count = std::max(chunk_count, (limit + PARALLEL_LEX_MAX_CHUNK - 1) / PARALLEL_LEX_MAX_CHUNK);
+    chunk_bounds = chunkBounds(chunk_count);
+    index = static_cast<int>(limit);
+    while (chunks_in_flight.size() < lex_threads && chunks_started + 1 < chunk_bounds.size()) {
+        startChunk();
+    }
+}
+
+void Tokenizer::startChunk() {
+    size_t begin = chunk_bounds[chunks_started];
+    size_t end = chunk_bounds[chunks_started + 1];
+    chunks_started++;
+    chunks_in_flight.push_back(std::async(std::launch::async, [source = src, begin, end, mode = mode]() {
+        LexedChunk chunk;
+        Tokenizer lexer(source, begin, end, chunk.symbols, mode);
+        chunk.tokens = lexer.tokenize();
+        chunk.corrections = std::move(lexer.corrections);
+        chunk.suggestions = std::move(lexer.suggestions);
+        chunk.errors = std::move(lexer.errors);
+        return chunk;
+    }));
+}
+
+// Hand over the next chunk in source order and start lexing another in its
+// place. Interning each chunk's names in first-use order gives the same ids
+// as lexing sequentially.
+bool Tokenizer::takeChunk() {
+    if (chunks_in_flight.empty()) return false;
+    LexedChunk chunk = chunks_in_flight.front().get();
+    chunks_in_flight.pop_front();
+    if (chunks_started + 1 < chunk_bounds.size()) startChunk();
+
+    std::vector<Symbol> remap(chunk.symbols.size());
+    for (Symbol local = 0; local < remap.size(); local++) {
+        remap[local] = symbols.intern(chunk.symbols.name(local));
+    }
+    for (Token& token : chunk.tokens) {
+        if (token.symbol != NO_SYMBOL) token.symbol = remap[token.symbol];
+    }
+    chunk_tokens = std::move(chunk.tokens);
+    chunk_next = 0;
+    token_count += chunk_tokens.size();
+    corrections.insert(corrections.end(), chunk.corrections.begin(), chunk.corrections.end());
+    suggestions.insert(suggestions.end(), chunk.suggestions.begin(), chunk.suggestions.end());
+    errors.insert(errors.end(), chunk.errors.begin(), chunk.errors.end());
+    return true;
+}
+
+std::vector<Token> Tokenizer::tokenize() {
+    std::vector<Token> tokens;
+    for (Token token = next(); token.type != TokenType::end_of_file; token = next()) {
+        tokens.push_back(token);
+    }
+    return tokens;
+}
+
+TokenStream::TokenStream(Tokenizer& tokenizer)
+    : tokenizer(tokenizer), last{TokenType::end_of_file, 0, 0, NO_SYMBOL} {}
+
+const Token& TokenStream::peek(size_t offset) {
+    while (lookahead.size() <= offset) {
+        // Past the end the tokenizer keeps returning end_of_file
+        lookahead.push_back(tokenizer.next());
+    }
+    return lookahead[offset];
+}
+
+Token TokenStream::advance() {
+    peek();
+    last = lookahead.front();
+    lookahead.pop_front();
+    return last;
+}
+
+std::string_view token_text(std::string_view source, const Token& token) {
+    return source.substr(token.offset, token.length);
 }
 
+int64_t college_number_value(std::string_view text) {
+    int64_t value = 0;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t comma = text.find(',', start);
+        if (comma == std::string_view::npos) comma = text.size();
+        if (const KeywordEntry* digit = lookup_keyword(text.substr(start, comma - start))) {
+            append_decimal_digits(value, digit->digits);
+        }
+        start = comma + 1;
+    }
+    return value;
+}
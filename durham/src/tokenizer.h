@@ -1,12 +1,18 @@
 #ifndef TOKENIZER_H
 #define TOKENIZER_H
 
+#include <cstdint>
+#include <deque>
+#include <future>
 #include <string>
+#include <string_view>
 #include <optional> 
 #include <vector> 
 #include <map>
+#include <unordered_map>
 #include <cctype>
 #include <iostream>
+#include "symbols.h"
 
 enum class TokenType {
     // Numeric colleges -> digits 0-9
@@ -43,6 +49,7 @@ enum class TokenType {
     _else,          //else
     _while,         //while
     _function,      //function
+    _import,        //import
 
     // Type keywords
     _text,          // text (string type)
@@ -79,37 +86,156 @@ enum class TokenType {
     int_lit, 
     comma,          // mulit-digit separator
     dot,            // '
-    identifier      // variable names
+    identifier,     // variable names
+    end_of_file     // returned once the source is exhausted
 };
 
+inline constexpr size_t TOKEN_TYPE_COUNT = static_cast<size_t>(TokenType::end_of_file) + 1;
+
+// 16 bytes and trivially copyable: a token's text is a span of the source,
+// which has to outlive the tokens
 struct Token {
     TokenType type; 
-    std::optional<std::string> value; 
+    uint32_t offset; 
+    uint32_t length; 
+    Symbol symbol;      // identifiers only, else NO_SYMBOL
 }; 
+static_assert(sizeof(Token) <= 16, "tokens are copied by value throughout the lexer and parser");
+
+// Source text of a token (a string literal's span excludes the quotes)
+std::string_view token_text(std::string_view source, const Token& token);
+// Value of an int_lit's "college,college,..." text, e.g. 10 for chads,butler.
+// The tokenizer has already reported any that overflow 64 bits.
+int64_t college_number_value(std::string_view text);
+
+// What to do with a word that looks like a misspelt keyword
+enum class AutocorrectMode {
+    Prompt,     // ask on the terminal, rewrite the file if accepted
+    Off,        // treat it as an identifier without searching for a keyword
+    Report,     // treat it as an identifier and list suggestions after lexing
+    Apply       // accept every suggestion and rewrite the file
+};
+
+// A keyword suggestion that was reported rather than applied
+struct Suggestion {
+    size_t offset;          // of the word in the source
+    std::string word;
+    std::string keyword;
+};
+
+// A malformed token, e.g. a number too large for 64 bits
+struct LexError {
+    size_t offset;          // of the token in the source
+    std::string message;
+};
+
+// Token offsets and the lexer's position are 32-bit; larger sources are
+// rejected before lexing
+inline constexpr size_t MAX_SOURCE_BYTES = INT32_MAX;
+
+// Below this, a file is lexed on one thread whatever setLexThreads says
+inline constexpr size_t PARALLEL_LEX_MIN_BYTES = 1 << 20;
+// Smallest chunk handed to a thread
+inline constexpr size_t PARALLEL_LEX_MIN_CHUNK = 256 << 10;
+// Largest chunk handed to a thread, which bounds the tokens held at once
+inline constexpr size_t PARALLEL_LEX_MAX_CHUNK = 4 << 20;
 
 class Tokenizer {
     public:
         
-        Tokenizer(const std::string& source); // constructor
+        // source is not copied; it must outlive the tokenizer. Identifiers are
+        // interned into symbols.
+        Tokenizer(std::string_view source, SymbolTable& symbols,
+                  AutocorrectMode mode = AutocorrectMode::Prompt); // constructor
         ~Tokenizer(); // destructor
+        // Lex one token on demand; end_of_file from then on once exhausted
+        Token next();
+        // Every remaining token at once
         std::vector<Token> tokenize(); 
+        size_t getTokenCount() const { return token_count; }
+        // Allow files of PARALLEL_LEX_MIN_BYTES or more to be lexed on up to
+        // this many threads (1 by default). Chunks are handed out in order,
+        // at most this many ahead of the caller.
+        void setLexThreads(unsigned threads) { lex_threads = threads; }
         
-        // Get corrected source code
-        std::string getCorrectedSource() const { return src; }
-        bool hasCorrections() const { return corrections_made; }
+        // Get corrected source code (source with the corrections spliced in)
+        std::string getCorrectedSource() const;
+        bool hasCorrections() const { return !corrections.empty(); }
+        // Suggestions collected in AutocorrectMode::Report, in source order
+        const std::vector<Suggestion>& getSuggestions() const { return suggestions; }
+        // Errors that fail the compile once parsing is done, in source order
+        const std::vector<LexError>& getErrors() const { return errors; }
 
     private: 
-        
+        // Accepted autocorrection: replace length bytes at offset
+        struct Correction {
+            size_t offset;
+            size_t length;
+            std::string replacement;
+        };
+
+        // Lex [begin, end) of source only: one chunk of a parallel lex
+        Tokenizer(std::string_view source, size_t begin, size_t end, SymbolTable& symbols,
+                  AutocorrectMode mode);
+
         int index; 
-        std::string src; 
-        bool corrections_made;
+        size_t limit;   // end of the text to lex
+        std::string_view src; 
+        SymbolTable& symbols;
+        AutocorrectMode mode;
+        std::vector<Correction> corrections;  // in source order
+        std::vector<Suggestion> suggestions;
+        std::vector<LexError> errors;
+        std::optional<Token> pending;     // lookahead taken by the "not equals" merge
+        TokenType last_type = TokenType::end_of_file;   // previous raw token
+        size_t token_count = 0;
+        unsigned lex_threads = 1;
+
+        // A parallel lex: each chunk is lexed on its own thread into its own
+        // symbol table, and remapped when next() reaches it
+        struct LexedChunk {
+            SymbolTable symbols;
+            std::vector<Token> tokens;
+            std::vector<Correction> corrections;
+            std::vector<Suggestion> suggestions;
+            std::vector<LexError> errors;
+        };
+        std::vector<size_t> chunk_bounds;     // empty unless lexing in parallel
+        size_t chunks_started = 0;
+        std::deque<std::future<LexedChunk>> chunks_in_flight;   // in source order
+        std::vector<Token> chunk_tokens;      // the chunk being handed out
+        size_t chunk_next = 0;
+        std::vector<size_t> chunkBounds(size_t chunk_count) const;
+        void startParallelLex();
+        void startChunk();
+        bool takeChunk();       // false once every chunk has been handed out
+        Token scan();
+        Token identifier_token(int start, int end);
         std::optional<char> peek(int offset=0);
         char consume();
         
         // Autocorrect helpers
-        int levenshteinDistance(const std::string& s1, const std::string& s2);
-        std::optional<std::string> suggestCorrection(const std::string& word);
+        // Words already checked, with their suggestion ("" for none)
+        std::unordered_map<std::string_view, std::string_view> suggestion_memo;
+        std::optional<std::string> suggestCorrection(std::string_view word);
         bool promptUserForCorrection(const std::string& original, const std::string& suggestion, int position);
+        bool recordCorrection(const std::string& original, const std::string& suggestion, int position);
+};
+
+// Tokens pulled from a Tokenizer as the parser needs them. Memory is bounded
+// by the lookahead (plus, for a parallel lex, the chunks in flight), not the
+// size of the source.
+class TokenStream {
+    public:
+        explicit TokenStream(Tokenizer& tokenizer);
+        const Token& peek(size_t offset = 0);
+        Token advance();
+        const Token& previous() const { return last; }
+
+    private:
+        Tokenizer& tokenizer;
+        std::deque<Token> lookahead;
+        Token last;     // most recently advanced past
 };
 
 std::optional<std::string> college_to_decimal(const std::string& college);